@@ -10,6 +10,7 @@ set( ICE_SOURCES
      "${CMAKE_CURRENT_LIST_DIR}/source/ice_api.c"
      "${CMAKE_CURRENT_LIST_DIR}/source/ice_api_private.c"
      "${CMAKE_CURRENT_LIST_DIR}/source/transaction_id_store.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/ice_crypto.c"
      "${CMAKE_CURRENT_LIST_DIR}/source/dependency/amazon-kinesis-video-streams-stun/source/stun_deserializer.c"
      "${CMAKE_CURRENT_LIST_DIR}/source/dependency/amazon-kinesis-video-streams-stun/source/stun_serializer.c"
      "${CMAKE_CURRENT_LIST_DIR}/source/dependency/amazon-kinesis-video-streams-stun/source/stun_endianness.c" )
@@ -6,6 +6,7 @@
 /* API includes. */
 #include "ice_api.h"
 #include "ice_api_private.h"
+#include "ice_crypto.h"
 
 /* STUN includes. */
 #include "stun_data_types.h"
@@ -17,8 +18,8 @@
 #define ICE_CANDIDATE_ID_START ( 0x7000 )
 
 /* Helper macros. */
-#define ICE_WRITE_UINT16   ( pContext->readWriteFunctions.writeUint16Fn )
-#define ICE_READ_UINT16    ( pContext->readWriteFunctions.readUint16Fn )
+#define ICE_WRITE_UINT16   ( pContext->pConfig->readWriteFunctions.writeUint16Fn )
+#define ICE_READ_UINT16    ( pContext->pConfig->readWriteFunctions.readUint16Fn )
 
 /*----------------------------------------------------------------------------*/
 
@@ -30,14 +31,17 @@ IceResult_t Ice_Init( IceContext_t * pContext,
     if( ( pContext == NULL ) ||
         ( pInitInfo == NULL ) ||
         ( pInitInfo->pLocalCandidatesArray == NULL ) ||
+        ( pInitInfo->localCandidatesArrayLength > ICE_CANDIDATES_ARRAY_MAX_LENGTH ) ||
         ( pInitInfo->pRemoteCandidatesArray == NULL ) ||
+        ( pInitInfo->remoteCandidatesArrayLength > ICE_CANDIDATES_ARRAY_MAX_LENGTH ) ||
         ( pInitInfo->pCandidatePairsArray == NULL ) ||
         ( pInitInfo->pTurnServerArray == NULL ) ||
         ( pInitInfo->pStunBindingRequestTransactionIdStore == NULL ) ||
-        ( pInitInfo->cryptoFunctions.randomFxn == NULL ) ||
-        ( pInitInfo->cryptoFunctions.crc32Fxn == NULL ) ||
-        ( pInitInfo->cryptoFunctions.hmacFxn == NULL ) ||
-        ( pInitInfo->cryptoFunctions.md5Fxn == NULL ) ||
+        ( ( pInitInfo->pSharedConfig == NULL ) &&
+          ( ( pInitInfo->cryptoFunctions.randomFxn == NULL ) ||
+            ( pInitInfo->cryptoFunctions.crc32Fxn == NULL ) ||
+            ( pInitInfo->cryptoFunctions.hmacFxn == NULL ) ||
+            ( pInitInfo->cryptoFunctions.md5Fxn == NULL ) ) ) ||
         ( pInitInfo->creds.pLocalUsername == NULL ) ||
         ( pInitInfo->creds.pLocalPassword == NULL ) ||
         ( pInitInfo->creds.pRemoteUsername == NULL ) ||
@@ -55,48 +59,315 @@ IceResult_t Ice_Init( IceContext_t * pContext,
 
         pContext->creds = pInitInfo->creds;
 
+        /* The arrays are not cleared here. Only the slots below the counters,
+         * or below the high-water marks for the slots which are reused, are
+         * ever read and each slot is initialized when it is first handed
+         * out. */
         pContext->pLocalCandidates = pInitInfo->pLocalCandidatesArray;
         pContext->maxLocalCandidates = pInitInfo->localCandidatesArrayLength;
-        memset( pContext->pLocalCandidates,
-                0,
-                pContext->maxLocalCandidates * sizeof( IceCandidate_t ) );
         pContext->numLocalCandidates = 0;
 
         pContext->pRemoteCandidates = pInitInfo->pRemoteCandidatesArray;
         pContext->maxRemoteCandidates = pInitInfo->remoteCandidatesArrayLength;
-        memset( pContext->pRemoteCandidates,
-                0,
-                pContext->maxRemoteCandidates * sizeof( IceCandidate_t ) );
         pContext->numRemoteCandidates = 0;
 
         pContext->pCandidatePairs = pInitInfo->pCandidatePairsArray;
         pContext->maxCandidatePairs = pInitInfo->candidatePairsArrayLength;
-        memset( pContext->pCandidatePairs,
-                0,
-                pContext->maxCandidatePairs * sizeof( IceCandidatePair_t ) );
         pContext->numCandidatePairs = 0;
 
+        if( ( pInitInfo->candidatePairsLimit != 0 ) &&
+            ( pInitInfo->candidatePairsLimit < pContext->maxCandidatePairs ) )
+        {
+            pContext->maxCandidatePairs = pInitInfo->candidatePairsLimit;
+        }
+
         pContext->pTurnServers = pInitInfo->pTurnServerArray;
         pContext->maxTurnServers = pInitInfo->turnServerArrayLength;
-        memset( pContext->pTurnServers,
-                0,
-                pContext->maxTurnServers * sizeof( IceTurnServer_t ) );
         pContext->numTurnServers = 0;
 
+        pContext->pStunRequestTemplates = pInitInfo->pStunRequestTemplatesArray;
+
+        if( pContext->pStunRequestTemplates != NULL )
+        {
+            pContext->maxStunRequestTemplates = pInitInfo->stunRequestTemplatesArrayLength;
+        }
+
+        pContext->numStunRequestTemplates = 0;
+
+        pContext->pRequestCaches = pInitInfo->pRequestCachesArray;
+
+        if( pContext->pRequestCaches != NULL )
+        {
+            pContext->maxRequestCaches = pInitInfo->requestCachesArrayLength;
+        }
+
+        pContext->numRequestCaches = 0;
+
+        pContext->pResponseCacheEntries = pInitInfo->pResponseCacheArray;
+
+        if( pContext->pResponseCacheEntries != NULL )
+        {
+            pContext->maxResponseCacheEntries = pInitInfo->responseCacheArrayLength;
+        }
+
+        pContext->nextResponseCacheEntry = 0;
+
+        pContext->pCredentialPool = pInitInfo->pCredentialPoolBuffer;
+
+        if( pContext->pCredentialPool != NULL )
+        {
+            pContext->credentialPoolLength = pInitInfo->credentialPoolBufferLength;
+        }
+
+        pContext->credentialPoolUsed = 0;
+        pContext->credentialPoolHighWaterMark = 0;
+
+        /* The random pool is filled on first use. */
+        pContext->pRandomPool = pInitInfo->pRandomPoolBuffer;
+
+        if( pContext->pRandomPool != NULL )
+        {
+            pContext->randomPoolLength = pInitInfo->randomPoolBufferLength;
+        }
+
+        pContext->randomPoolOffset = pContext->randomPoolLength;
+
         pContext->isControlling = pInitInfo->isControlling;
+        pContext->lazyCandidatePairs = pInitInfo->lazyCandidatePairs;
+        pContext->lazyFrontierPriority = UINT64_MAX;
         pContext->pStunBindingRequestTransactionIdStore = pInitInfo->pStunBindingRequestTransactionIdStore;
 
-        pContext->cryptoFunctions = pInitInfo->cryptoFunctions;
+        if( pInitInfo->pSharedConfig != NULL )
+        {
+            pContext->pConfig = pInitInfo->pSharedConfig;
+        }
+        else
+        {
+            /* The cache may be shared with other contexts and is therefore
+             * not reset here. */
+            pContext->config.cryptoFunctions = pInitInfo->cryptoFunctions;
+            pContext->config.pLongTermCredentialCache = pInitInfo->pLongTermCredentialCache;
+            Stun_InitReadWriteFunctions( &( pContext->config.readWriteFunctions ) );
+            pContext->pConfig = &( pContext->config );
+        }
 
         pContext->nextCandidateId = ICE_CANDIDATE_ID_START;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = Ice_GenerateRandom( pContext,
+                                     ( uint8_t * ) &( pContext->tieBreaker ),
+                                     sizeof( pContext->tieBreaker ) );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_GetRequiredMemorySize( const IceArenaSizes_t * pSizes,
+                                       size_t * pMemorySize )
+{
+    IceResult_t result = ICE_RESULT_OK;
+
+    if( ( pSizes == NULL ) ||
+        ( pMemorySize == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = Ice_LayoutArena( pSizes,
+                                  NULL,
+                                  NULL,
+                                  pMemorySize );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_InitFromArena( IceContext_t * pContext,
+                               const IceInitInfo_t * pInitInfo,
+                               const IceArenaSizes_t * pSizes,
+                               uint8_t * pArena,
+                               size_t arenaLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    IceInitInfo_t initInfo;
+    size_t requiredArenaLength = 0;
+
+    if( ( pContext == NULL ) ||
+        ( pInitInfo == NULL ) ||
+        ( pSizes == NULL ) ||
+        ( pSizes->localCandidatesArrayLength > ICE_CANDIDATES_ARRAY_MAX_LENGTH ) ||
+        ( pSizes->remoteCandidatesArrayLength > ICE_CANDIDATES_ARRAY_MAX_LENGTH ) ||
+        ( pSizes->transactionIdSlotsArrayLength == 0 ) ||
+        ( pArena == NULL ) ||
+        ( ( ( uintptr_t ) pArena % ICE_ARENA_ALIGNMENT ) != 0 ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = Ice_LayoutArena( pSizes,
+                                  NULL,
+                                  NULL,
+                                  &( requiredArenaLength ) );
+    }
+
+    if( ( result == ICE_RESULT_OK ) &&
+        ( arenaLength < requiredArenaLength ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        initInfo = *pInitInfo;
+
+        ( void ) Ice_LayoutArena( pSizes,
+                                  pArena,
+                                  &( initInfo ),
+                                  &( requiredArenaLength ) );
+
+        result = Ice_Init( pContext,
+                           &( initInfo ) );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_InitLongTermCredentialCache( IceLongTermCredentialCache_t * pCache,
+                                             IceLongTermCredentialCacheEntry_t * pEntries,
+                                             size_t numEntries,
+                                             IceRandom_t randomFxn,
+                                             IceLock_t lockFxn,
+                                             IceUnlock_t unlockFxn,
+                                             void * pLockContext )
+{
+    IceResult_t result = ICE_RESULT_OK;
+
+    if( ( pCache == NULL ) ||
+        ( pEntries == NULL ) ||
+        ( numEntries == 0 ) ||
+        ( randomFxn == NULL ) ||
+        ( ( lockFxn == NULL ) != ( unlockFxn == NULL ) ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        if( randomFxn( &( pCache->secret[ 0 ] ),
+                       ICE_LONG_TERM_CREDENTIAL_CACHE_SECRET_LENGTH ) != ICE_RESULT_OK )
+        {
+            result = ICE_RESULT_RANDOM_GENERATION_ERROR;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        memset( pEntries,
+                0,
+                numEntries * sizeof( IceLongTermCredentialCacheEntry_t ) );
+
+        pCache->pEntries = pEntries;
+        pCache->maxEntries = numEntries;
+        pCache->nextEntry = 0;
+        pCache->lockFxn = lockFxn;
+        pCache->unlockFxn = unlockFxn;
+        pCache->pLockContext = pLockContext;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_DeinitLongTermCredentialCache( IceLongTermCredentialCache_t * pCache )
+{
+    IceResult_t result = ICE_RESULT_OK;
+
+    if( ( pCache == NULL ) ||
+        ( pCache->pEntries == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        if( pCache->lockFxn != NULL )
+        {
+            pCache->lockFxn( pCache->pLockContext );
+        }
 
-        Stun_InitReadWriteFunctions( &( pContext->readWriteFunctions ) );
+        /* Clear the long-term keys and the secret. */
+        IceCrypto_Zeroize( pCache->pEntries,
+                           pCache->maxEntries * sizeof( IceLongTermCredentialCacheEntry_t ) );
+        IceCrypto_Zeroize( &( pCache->secret[ 0 ] ),
+                           ICE_LONG_TERM_CREDENTIAL_CACHE_SECRET_LENGTH );
+        pCache->nextEntry = 0;
+
+        if( pCache->unlockFxn != NULL )
+        {
+            pCache->unlockFxn( pCache->pLockContext );
+        }
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_InitSharedConfig( IceSharedConfig_t * pSharedConfig,
+                                  const IceCryptoFunctions_t * pCryptoFunctions,
+                                  IceLongTermCredentialCache_t * pLongTermCredentialCache )
+{
+    IceResult_t result = ICE_RESULT_OK;
+
+    if( ( pSharedConfig == NULL ) ||
+        ( pCryptoFunctions == NULL ) ||
+        ( pCryptoFunctions->randomFxn == NULL ) ||
+        ( pCryptoFunctions->crc32Fxn == NULL ) ||
+        ( pCryptoFunctions->hmacFxn == NULL ) ||
+        ( pCryptoFunctions->md5Fxn == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        pSharedConfig->cryptoFunctions = *pCryptoFunctions;
+        pSharedConfig->pLongTermCredentialCache = pLongTermCredentialCache;
+        Stun_InitReadWriteFunctions( &( pSharedConfig->readWriteFunctions ) );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_RefillRandomPool( IceContext_t * pContext )
+{
+    IceResult_t result = ICE_RESULT_OK;
+
+    if( ( pContext == NULL ) ||
+        ( pContext->pRandomPool == NULL ) ||
+        ( pContext->randomPoolLength == 0 ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
     }
 
     if( result == ICE_RESULT_OK )
     {
-        result = pContext->cryptoFunctions.randomFxn( ( uint8_t * ) &( pContext->tieBreaker ),
-                                                      sizeof( pContext->tieBreaker ) );
+        result = Ice_FillRandomPool( pContext );
     }
 
     return result;
@@ -107,7 +378,6 @@ IceResult_t Ice_Init( IceContext_t * pContext,
 IceResult_t Ice_AddHostCandidate( IceContext_t * pContext,
                                   const IceEndpoint_t * pEndpoint )
 {
-    size_t i;
     IceResult_t result = ICE_RESULT_OK;
     IceCandidate_t * pHostCandidate = NULL;
 
@@ -119,7 +389,10 @@ IceResult_t Ice_AddHostCandidate( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pContext->numLocalCandidates == pContext->maxLocalCandidates )
+        pHostCandidate = Ice_GetFreeCandidate( pContext,
+                                               0 );
+
+        if( pHostCandidate == NULL )
         {
             result = ICE_RESULT_MAX_CANDIDATE_THRESHOLD;
         }
@@ -127,8 +400,9 @@ IceResult_t Ice_AddHostCandidate( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        pHostCandidate = &( pContext->pLocalCandidates[ pContext->numLocalCandidates ] );
-        pContext->numLocalCandidates += 1;
+        Ice_ConsumeCandidate( pContext,
+                              pHostCandidate,
+                              0 );
 
         pHostCandidate->candidateType = ICE_CANDIDATE_TYPE_HOST;
         pHostCandidate->isRemote = 0;
@@ -144,12 +418,8 @@ IceResult_t Ice_AddHostCandidate( IceContext_t * pContext,
         pContext->nextCandidateId++;
 
         /* Create candidate pairs with all the existing remote candidates. */
-        for( i = 0; ( i < pContext->numRemoteCandidates ) && ( result == ICE_RESULT_OK ); i++ )
-        {
-            result = Ice_AddCandidatePair( pContext,
-                                           pHostCandidate,
-                                           &( pContext->pRemoteCandidates[ i ] ) );
-        }
+        result = Ice_AddCandidatePairs( pContext,
+                                        pHostCandidate );
     }
 
     return result;
@@ -171,7 +441,10 @@ IceResult_t Ice_AddServerReflexiveCandidate( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pContext->numLocalCandidates == pContext->maxLocalCandidates )
+        pServerReflexiveCandidate = Ice_GetFreeCandidate( pContext,
+                                                          0 );
+
+        if( pServerReflexiveCandidate == NULL )
         {
             result = ICE_RESULT_MAX_CANDIDATE_THRESHOLD;
         }
@@ -179,10 +452,9 @@ IceResult_t Ice_AddServerReflexiveCandidate( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        pServerReflexiveCandidate = &( pContext->pLocalCandidates[ pContext->numLocalCandidates ] );
-
-        result = pContext->cryptoFunctions.randomFxn( &( pServerReflexiveCandidate->transactionId[ 0 ] ),
-                                                      STUN_HEADER_TRANSACTION_ID_LENGTH );
+        result = Ice_GenerateRandom( pContext,
+                                     &( pServerReflexiveCandidate->transactionId[ 0 ] ),
+                                     STUN_HEADER_TRANSACTION_ID_LENGTH );
 
         if( result != ICE_RESULT_OK )
         {
@@ -193,7 +465,9 @@ IceResult_t Ice_AddServerReflexiveCandidate( IceContext_t * pContext,
     if( result == ICE_RESULT_OK )
     {
         /* Consume the candidate form the array. */
-        pContext->numLocalCandidates += 1;
+        Ice_ConsumeCandidate( pContext,
+                              pServerReflexiveCandidate,
+                              0 );
 
         pServerReflexiveCandidate->candidateType = ICE_CANDIDATE_TYPE_SERVER_REFLEXIVE;
         pServerReflexiveCandidate->isRemote = 0;
@@ -224,6 +498,8 @@ IceResult_t Ice_AddRelayCandidate( IceContext_t * pContext,
     IceResult_t result = ICE_RESULT_OK;
     IceCandidate_t * pRelayCandidate = NULL;
     IceTurnServer_t * pTurnServer = NULL;
+    uint32_t credentialsOffset;
+    uint32_t credentialsCapacity;
 
     if( ( pContext == NULL ) ||
         ( pEndpoint == NULL ) ||
@@ -237,7 +513,10 @@ IceResult_t Ice_AddRelayCandidate( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pContext->numLocalCandidates == pContext->maxLocalCandidates )
+        pRelayCandidate = Ice_GetFreeCandidate( pContext,
+                                                0 );
+
+        if( pRelayCandidate == NULL )
         {
             result = ICE_RESULT_MAX_CANDIDATE_THRESHOLD;
         }
@@ -245,7 +524,10 @@ IceResult_t Ice_AddRelayCandidate( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pContext->numTurnServers == pContext->maxTurnServers )
+        /* A reused slot keeps the TURN server of its previous relay
+         * candidate. */
+        if( ( pRelayCandidate->pTurnServer == NULL ) &&
+            ( pContext->numTurnServers == pContext->maxTurnServers ) )
         {
             result = ICE_RESULT_MAX_TURN_SERVER_THRESHOLD;
         }
@@ -253,10 +535,9 @@ IceResult_t Ice_AddRelayCandidate( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        pRelayCandidate = &( pContext->pLocalCandidates[ pContext->numLocalCandidates ] );
-
-        result = pContext->cryptoFunctions.randomFxn( &( pRelayCandidate->transactionId[ 0 ] ),
-                                                      STUN_HEADER_TRANSACTION_ID_LENGTH );
+        result = Ice_GenerateRandom( pContext,
+                                     &( pRelayCandidate->transactionId[ 0 ] ),
+                                     STUN_HEADER_TRANSACTION_ID_LENGTH );
 
         if( result != ICE_RESULT_OK )
         {
@@ -266,24 +547,68 @@ IceResult_t Ice_AddRelayCandidate( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        /* Consume the candidate form the array. */
-        pContext->numLocalCandidates += 1;
+        pTurnServer = pRelayCandidate->pTurnServer;
+
+        if( pTurnServer == NULL )
+        {
+            pTurnServer = &( pContext->pTurnServers[ pContext->numTurnServers ] );
+            memset( pTurnServer, 0, sizeof( IceTurnServer_t ) );
+        }
+        else
+        {
+            /* Keep the space of the previous credentials in the pool. */
+            credentialsOffset = pTurnServer->credentialsOffset;
+            credentialsCapacity = pTurnServer->credentialsCapacity;
+            memset( pTurnServer, 0, sizeof( IceTurnServer_t ) );
+            pTurnServer->credentialsOffset = credentialsOffset;
+            pTurnServer->credentialsCapacity = credentialsCapacity;
+        }
+
+        result = Ice_SetTurnServerCredential( pContext,
+                                              pTurnServer,
+                                              ICE_TURN_SERVER_CREDENTIAL_USER_NAME,
+                                              ( const uint8_t * ) pTurnServerUsername,
+                                              turnServerUsernameLength );
 
-        pTurnServer = &( pContext->pTurnServers[ pContext->numTurnServers ] );
-        pContext->numTurnServers += 1;
-        memset( pTurnServer, 0, sizeof( IceTurnServer_t ) );
+        if( result == ICE_RESULT_OK )
+        {
+            result = Ice_SetTurnServerCredential( pContext,
+                                                  pTurnServer,
+                                                  ICE_TURN_SERVER_CREDENTIAL_PASSWORD,
+                                                  ( const uint8_t * ) pTurnServerPassword,
+                                                  turnServerPasswordLength );
+        }
+
+        /* Give back the space taken by the username, so that retries do not
+         * use up the credential pool. */
+        if( result != ICE_RESULT_OK )
+        {
+            Ice_ReleaseTurnServerCredentials( pContext,
+                                              pTurnServer );
+        }
+    }
 
-        memcpy( &( pTurnServer->userName[ 0 ] ),
-                pTurnServerUsername,
-                turnServerUsernameLength );
-        pTurnServer->userNameLength = turnServerUsernameLength;
+    if( result == ICE_RESULT_OK )
+    {
+        /* Consume the candidate and the TURN server form the arrays. */
+        Ice_ConsumeCandidate( pContext,
+                              pRelayCandidate,
+                              0 );
 
-        memcpy( &( pTurnServer->password[ 0 ] ),
-                pTurnServerPassword,
-                turnServerPasswordLength );
-        pTurnServer->passwordLength = turnServerPasswordLength;
+        if( pRelayCandidate->pTurnServer == NULL )
+        {
+            pContext->numTurnServers += 1;
+            pRelayCandidate->pTurnServer = pTurnServer;
+        }
 
-        pRelayCandidate->pTurnServer = pTurnServer;
+        if( pRelayCandidate->pRequestCache == NULL )
+        {
+            pRelayCandidate->pRequestCache = Ice_AllocateRequestCache( pContext );
+        }
+        else
+        {
+            Ice_InvalidateRequestCache( pRelayCandidate->pRequestCache );
+        }
         pRelayCandidate->candidateType = ICE_CANDIDATE_TYPE_RELAY;
         pRelayCandidate->isRemote = 0;
         memcpy( &( pRelayCandidate->endpoint ),
@@ -318,7 +643,10 @@ IceResult_t Ice_AddRemoteCandidate( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pContext->numRemoteCandidates == pContext->maxRemoteCandidates )
+        pRemoteCandidate = Ice_GetFreeCandidate( pContext,
+                                                 1 );
+
+        if( pRemoteCandidate == NULL )
         {
             result = ICE_RESULT_MAX_CANDIDATE_THRESHOLD;
         }
@@ -330,8 +658,9 @@ IceResult_t Ice_AddRemoteCandidate( IceContext_t * pContext,
          * and port) address? */
         for( i = 0; i < pContext->numRemoteCandidates; i++ )
         {
-            if( Ice_IsSameTransportAddress( &( pContext->pRemoteCandidates[ i ].endpoint.transportAddress ),
-                                            &( pRemoteCandidateInfo->pEndpoint->transportAddress ) ) == 1 )
+            if( ( pContext->pRemoteCandidates[ i ].state != ICE_CANDIDATE_STATE_INVALID ) &&
+                ( Ice_IsSameTransportAddress( &( pContext->pRemoteCandidates[ i ].endpoint.transportAddress ),
+                                              &( pRemoteCandidateInfo->pEndpoint->transportAddress ) ) == 1 ) )
             {
                 break;
             }
@@ -341,8 +670,9 @@ IceResult_t Ice_AddRemoteCandidate( IceContext_t * pContext,
          * the same transport (IP and port) address already. */
         if( i == pContext->numRemoteCandidates )
         {
-            pRemoteCandidate = &( pContext->pRemoteCandidates[ pContext->numRemoteCandidates ] );
-            pContext->numRemoteCandidates += 1;
+            Ice_ConsumeCandidate( pContext,
+                                  pRemoteCandidate,
+                                  1 );
 
             pRemoteCandidate->candidateType = pRemoteCandidateInfo->candidateType;
             pRemoteCandidate->isRemote = 1;
@@ -357,15 +687,8 @@ IceResult_t Ice_AddRemoteCandidate( IceContext_t * pContext,
             pContext->nextCandidateId++;
 
             /* Create candidate pairs with all the existing local candidates. */
-            for( i = 0; ( i < pContext->numLocalCandidates ) && ( result == ICE_RESULT_OK ); i++ )
-            {
-                if( pContext->pLocalCandidates[ i ].state == ICE_CANDIDATE_STATE_VALID )
-                {
-                    result = Ice_AddCandidatePair( pContext,
-                                                   &( pContext->pLocalCandidates[ i ] ),
-                                                   pRemoteCandidate );
-                }
-            }
+            result = Ice_AddCandidatePairs( pContext,
+                                            pRemoteCandidate );
         }
     }
 
@@ -405,6 +728,12 @@ IceResult_t Ice_CloseCandidatePair( IceContext_t * pContext,
     if( result == ICE_RESULT_OK )
     {
         pIceCandidatePair->state = ICE_CANDIDATE_PAIR_STATE_FROZEN;
+
+        /* A retransmitted binding request must not be answered from the
+         * cache for a closed candidate pair. */
+        Ice_MoveResponseCacheEntries( pContext,
+                                      pIceCandidatePair,
+                                      NULL );
     }
 
     return result;
@@ -412,54 +741,95 @@ IceResult_t Ice_CloseCandidatePair( IceContext_t * pContext,
 
 /*----------------------------------------------------------------------------*/
 
-IceResult_t Ice_CloseCandidate( IceContext_t * pContext,
-                                IceCandidate_t * pLocalCandidate )
+/* Ice_CompactCandidatePairs - Visit up to maxCandidatePairsToVisit candidate
+ * pairs and move the live ones down over the closed ones, keeping them sorted
+ * by priority. The closed candidate pairs gather between the write and the read
+ * index, so the array stays valid between calls. When the pass reaches the end
+ * of the array, the closed candidate pairs are dropped and their request
+ * templates and request caches are kept past the end for the next candidate
+ * pairs added. Adding or removing a candidate pair restarts the pass.
+ */
+IceResult_t Ice_CompactCandidatePairs( IceContext_t * pContext,
+                                       size_t maxCandidatePairsToVisit )
 {
     IceResult_t result = ICE_RESULT_OK;
-    size_t i;
+    IceCandidatePair_t * pReadCandidatePair;
+    IceCandidatePair_t * pWriteCandidatePair;
+    IceCandidatePair_t candidatePair;
+    size_t i, numVisited = 0;
 
-    if( ( pContext == NULL ) ||
-        ( pLocalCandidate == NULL ) )
+    if( pContext == NULL )
     {
         result = ICE_RESULT_BAD_PARAM;
     }
 
     if( result == ICE_RESULT_OK )
     {
-        for( i = 0; i < pContext->numLocalCandidates; i++ )
+        while( ( numVisited < maxCandidatePairsToVisit ) &&
+               ( pContext->compactionReadIndex < pContext->numCandidatePairs ) )
         {
-            if( &( pContext->pLocalCandidates[ i ] ) == pLocalCandidate )
+            pReadCandidatePair = &( pContext->pCandidatePairs[ pContext->compactionReadIndex ] );
+            pWriteCandidatePair = &( pContext->pCandidatePairs[ pContext->compactionWriteIndex ] );
+
+            if( ICE_CANDIDATE_PAIR_IS_CLOSED( pReadCandidatePair ) == 0 )
             {
-                break;
+                if( pWriteCandidatePair != pReadCandidatePair )
+                {
+                    /* Swap with the closed candidate pair at the write index
+                     * so that it keeps its request template and request
+                     * cache. */
+                    Ice_MoveResponseCacheEntries( pContext,
+                                                  pWriteCandidatePair,
+                                                  NULL );
+                    Ice_MoveResponseCacheEntries( pContext,
+                                                  pReadCandidatePair,
+                                                  pWriteCandidatePair );
+
+                    if( pContext->pNominatedPair == pReadCandidatePair )
+                    {
+                        pContext->pNominatedPair = pWriteCandidatePair;
+                    }
+                    else if( pContext->pNominatedPair == pWriteCandidatePair )
+                    {
+                        pContext->pNominatedPair = pReadCandidatePair;
+                    }
+                    else
+                    {
+                        /* The nominated candidate pair, if any, does not
+                         * move. */
+                    }
+
+                    candidatePair = *pWriteCandidatePair;
+                    *pWriteCandidatePair = *pReadCandidatePair;
+                    *pReadCandidatePair = candidatePair;
+                }
+
+                pContext->compactionWriteIndex += 1;
             }
-        }
 
-        if( i == pContext->numLocalCandidates )
-        {
-            result = ICE_RESULT_INVALID_CANDIDATE;
+            pContext->compactionReadIndex += 1;
+            numVisited++;
         }
-    }
 
-    if( result == ICE_RESULT_OK )
-    {
-        /* Relay candidates in "Allocating" or "Valid" state need to release
-         * resources on the Turn server. */
-        if( pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY )
+        if( pContext->compactionReadIndex >= pContext->numCandidatePairs )
         {
-            if( ( pLocalCandidate->state == ICE_CANDIDATE_STATE_ALLOCATING ) ||
-                ( pLocalCandidate->state == ICE_CANDIDATE_STATE_VALID ) )
+            for( i = pContext->compactionWriteIndex; i < pContext->numCandidatePairs; i++ )
             {
-                pLocalCandidate->state = ICE_CANDIDATE_STATE_RELEASING;
+                if( pContext->pNominatedPair == &( pContext->pCandidatePairs[ i ] ) )
+                {
+                    pContext->pNominatedPair = NULL;
+                }
 
-                /* Regenerate Transaction Id to be used in the TURN request to
-                 * release resources on the TURN server. */
-                ( void ) pContext->cryptoFunctions.randomFxn( &( pLocalCandidate->transactionId[ 0 ] ),
-                                                              STUN_HEADER_TRANSACTION_ID_LENGTH );
+                Ice_MoveResponseCacheEntries( pContext,
+                                              &( pContext->pCandidatePairs[ i ] ),
+                                              NULL );
+                Ice_ReleaseTurnChannelNumber( &( pContext->pCandidatePairs[ i ] ) );
+                Ice_ClearCandidatePair( &( pContext->pCandidatePairs[ i ] ) );
             }
-        }
-        else
-        {
-            pLocalCandidate->state = ICE_CANDIDATE_STATE_INVALID;
+
+            pContext->numCandidatePairs = pContext->compactionWriteIndex;
+            pContext->compactionReadIndex = 0;
+            pContext->compactionWriteIndex = 0;
         }
     }
 
@@ -468,42 +838,292 @@ IceResult_t Ice_CloseCandidate( IceContext_t * pContext,
 
 /*----------------------------------------------------------------------------*/
 
-/* Ice_CreateResponseForRequest - This API creates Stun Packet for response to a
- * Stun Binding Request.
+/* Ice_AddNextCandidatePair - Create the candidate pair of the highest priority
+ * local x remote combination not handed out yet. The priority of a candidate
+ * pair is ruled by the lower priority of its candidates, so the candidates are
+ * taken from the local and remote lists sorted by priority in the order of
+ * decreasing priority and each one is paired, one call at a time, with the
+ * candidates of the other side taken before it. Each call costs amortised
+ * O(1) on top of adding the candidate pair. Combinations already paired by a
+ * triggered check are skipped.
  */
-IceResult_t Ice_CreateResponseForRequest( IceContext_t * pContext,
-                                          const IceCandidatePair_t * pIceCandidatePair,
-                                          uint8_t * pTransactionId,
-                                          uint8_t * pMessageBuffer,
-                                          size_t * pMessageBufferLength )
+IceResult_t Ice_AddNextCandidatePair( IceContext_t * pContext,
+                                      IceCandidatePair_t ** ppIceCandidatePair )
 {
-    StunContext_t stunCtx;
-    StunHeader_t stunHeader;
     IceResult_t result = ICE_RESULT_OK;
-    StunResult_t stunResult = STUN_RESULT_OK;
-    uint8_t * pStunMessageStart;
-    size_t stunMessageBufferLength;
-    size_t turnMessageBufferLength;
+    IceCandidatePair_t * pIceCandidatePair = NULL;
+    IceCandidate_t * pLocalCandidate;
+    IceCandidate_t * pRemoteCandidate;
+    IceCandidate_t * pCandidate;
+    IceCandidate_t * pPartner;
 
     if( ( pContext == NULL ) ||
-        ( pIceCandidatePair == NULL ) ||
-        ( pTransactionId == NULL ) ||
-        ( pMessageBuffer == NULL ) ||
-        ( pMessageBufferLength == NULL ) ||
-        ( ( pIceCandidatePair->pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY ) &&
-          ( *pMessageBufferLength < ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH ) ) )
+        ( ppIceCandidatePair == NULL ) )
     {
         result = ICE_RESULT_BAD_PARAM;
     }
 
     if( result == ICE_RESULT_OK )
     {
-        /* For Relay candidate, reserve 4 bytes to add TURN channel data message
-         * header. */
-        if( pIceCandidatePair->pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY )
+        if( pContext->lazyCandidatePairs == 0 )
         {
-            pStunMessageStart = &( pMessageBuffer[ ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH ] );
-            stunMessageBufferLength = *pMessageBufferLength - ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH;
+            result = ICE_RESULT_NO_NEXT_ACTION;
+        }
+    }
+
+    while( ( result == ICE_RESULT_OK ) && ( pIceCandidatePair == NULL ) )
+    {
+        if( pContext->lazyCandidate == 0 )
+        {
+            /* Take the next candidate, the local one first on a tie. */
+            pLocalCandidate = Ice_GetLazyCandidate( pContext,
+                                                    0,
+                                                    pContext->lazyNextLocalCandidate );
+            pRemoteCandidate = Ice_GetLazyCandidate( pContext,
+                                                     1,
+                                                     pContext->lazyNextRemoteCandidate );
+
+            if( ( pLocalCandidate == NULL ) && ( pRemoteCandidate == NULL ) )
+            {
+                result = ICE_RESULT_NO_NEXT_ACTION;
+            }
+            else if( ( pRemoteCandidate == NULL ) ||
+                     ( ( pLocalCandidate != NULL ) &&
+                       ( pLocalCandidate->priority >= pRemoteCandidate->priority ) ) )
+            {
+                pContext->lazyCandidate = pContext->lazyNextLocalCandidate;
+                pContext->lazyNextLocalCandidate = pLocalCandidate->nextByPriority;
+                pContext->lazyPartner = pContext->remoteCandidatesByPriority;
+                pContext->lazyFrontierPriority = pLocalCandidate->priority;
+                pContext->lazyFrontierIsRemote = 0;
+            }
+            else
+            {
+                pContext->lazyCandidate = pContext->lazyNextRemoteCandidate;
+                pContext->lazyNextRemoteCandidate = pRemoteCandidate->nextByPriority;
+                pContext->lazyPartner = pContext->localCandidatesByPriority;
+                pContext->lazyFrontierPriority = pRemoteCandidate->priority;
+                pContext->lazyFrontierIsRemote = 1;
+            }
+        }
+        else
+        {
+            pCandidate = Ice_GetLazyCandidate( pContext,
+                                               pContext->lazyFrontierIsRemote,
+                                               pContext->lazyCandidate );
+            pPartner = Ice_GetLazyCandidate( pContext,
+                                             ( pContext->lazyFrontierIsRemote == 0 ) ? 1 : 0,
+                                             pContext->lazyPartner );
+
+            if( ( pPartner == NULL ) ||
+                ( Ice_IsBeforeLazyFrontier( pContext,
+                                            pPartner ) == 0 ) )
+            {
+                /* Paired with all the candidates taken before it. */
+                pContext->lazyCandidate = 0;
+            }
+            else
+            {
+                pLocalCandidate = ( pContext->lazyFrontierIsRemote == 0 ) ? pCandidate : pPartner;
+                pRemoteCandidate = ( pContext->lazyFrontierIsRemote == 0 ) ? pPartner : pCandidate;
+
+                if( ( pLocalCandidate->state == ICE_CANDIDATE_STATE_VALID ) &&
+                    ( ( pContext->lazyTriggeredCandidatePairs == 0 ) ||
+                      ( Ice_FindCandidatePair( pContext,
+                                               pLocalCandidate,
+                                               pRemoteCandidate ) == NULL ) ) )
+                {
+                    result = Ice_AddCandidatePair( pContext,
+                                                   pLocalCandidate,
+                                                   pRemoteCandidate );
+
+                    if( result == ICE_RESULT_OK )
+                    {
+                        pIceCandidatePair = Ice_FindCandidatePair( pContext,
+                                                                   pLocalCandidate,
+                                                                   pRemoteCandidate );
+                    }
+                }
+
+                /* Move on only once the combination is paired, so that a
+                 * failed one is retried by the next call. */
+                if( result == ICE_RESULT_OK )
+                {
+                    pContext->lazyPartner = pPartner->nextByPriority;
+                }
+            }
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        *ppIceCandidatePair = pIceCandidatePair;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_CloseCandidate - Close a local or remote candidate. The slot of the
+ * candidate is reused by the next candidate added once the candidate is
+ * invalid, right away except for relay candidates which first release their
+ * allocation on the TURN server.
+ */
+IceResult_t Ice_CloseCandidate( IceContext_t * pContext,
+                                IceCandidate_t * pIceCandidate )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    size_t i;
+
+    if( ( pContext == NULL ) ||
+        ( pIceCandidate == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        for( i = 0; i < pContext->numLocalCandidates; i++ )
+        {
+            if( &( pContext->pLocalCandidates[ i ] ) == pIceCandidate )
+            {
+                break;
+            }
+        }
+
+        if( i == pContext->numLocalCandidates )
+        {
+            for( i = 0; i < pContext->numRemoteCandidates; i++ )
+            {
+                if( &( pContext->pRemoteCandidates[ i ] ) == pIceCandidate )
+                {
+                    break;
+                }
+            }
+
+            if( i == pContext->numRemoteCandidates )
+            {
+                result = ICE_RESULT_INVALID_CANDIDATE;
+            }
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        /* Relay candidates in "Allocating" or "Valid" state need to release
+         * resources on the Turn server. */
+        if( ( pIceCandidate->isRemote == 0 ) &&
+            ( pIceCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY ) )
+        {
+            if( ( pIceCandidate->state == ICE_CANDIDATE_STATE_ALLOCATING ) ||
+                ( pIceCandidate->state == ICE_CANDIDATE_STATE_VALID ) )
+            {
+                pIceCandidate->state = ICE_CANDIDATE_STATE_RELEASING;
+
+                /* Regenerate Transaction Id to be used in the TURN request to
+                 * release resources on the TURN server. */
+                ( void ) Ice_GenerateRandom( pContext,
+                                             &( pIceCandidate->transactionId[ 0 ] ),
+                                             STUN_HEADER_TRANSACTION_ID_LENGTH );
+                Ice_InvalidateRequestCache( pIceCandidate->pRequestCache );
+            }
+        }
+        else if( pIceCandidate->state != ICE_CANDIDATE_STATE_INVALID )
+        {
+            Ice_ReleaseCandidate( pContext,
+                                  pIceCandidate );
+        }
+        else
+        {
+            /* Already closed. */
+        }
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_CreateResponseForRequest - This API creates Stun Packet for response to a
+ * Stun Binding Request. The message buffer may be the buffer in which the
+ * request was received, i.e. the one pTransactionId points into, so that the
+ * response is written over the request.
+ */
+IceResult_t Ice_CreateResponseForRequest( IceContext_t * pContext,
+                                          const IceCandidatePair_t * pIceCandidatePair,
+                                          const uint8_t * pTransactionId,
+                                          uint8_t * pMessageBuffer,
+                                          size_t * pMessageBufferLength )
+{
+    StunContext_t stunCtx;
+    StunHeader_t stunHeader;
+    IceResult_t result = ICE_RESULT_OK;
+    StunResult_t stunResult = STUN_RESULT_OK;
+    uint8_t * pStunMessageStart;
+    size_t stunMessageBufferLength;
+    size_t turnMessageBufferLength;
+    IceResponseCacheEntry_t * pResponseCacheEntry = NULL;
+    uint8_t isCached = 0;
+    uint8_t isSendIndication = 0;
+    uint8_t stunResponse[ ICE_STUN_BINDING_RESPONSE_MAX_LENGTH ];
+    uint8_t transactionId[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+
+    if( ( pContext == NULL ) ||
+        ( pIceCandidatePair == NULL ) ||
+        ( pTransactionId == NULL ) ||
+        ( pMessageBuffer == NULL ) ||
+        ( pMessageBufferLength == NULL ) ||
+        ( ( pIceCandidatePair->pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY ) &&
+          ( *pMessageBufferLength < ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH ) ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        /* The transaction ID is overwritten if the response is created in the
+         * buffer of the request. */
+        memcpy( &( transactionId[ 0 ] ),
+                pTransactionId,
+                STUN_HEADER_TRANSACTION_ID_LENGTH );
+
+        /* Is this a retransmission of a request we have already responded
+         * to? */
+        pResponseCacheEntry = Ice_FindResponseCacheEntry( pContext,
+                                                          &( transactionId[ 0 ] ),
+                                                          pIceCandidatePair );
+
+        if( ( pResponseCacheEntry != NULL ) &&
+            ( pResponseCacheEntry->responseLength != 0 ) &&
+            ( pResponseCacheEntry->responseLength <= *pMessageBufferLength ) )
+        {
+            memcpy( pMessageBuffer,
+                    &( pResponseCacheEntry->response[ 0 ] ),
+                    pResponseCacheEntry->responseLength );
+            *pMessageBufferLength = pResponseCacheEntry->responseLength;
+            isCached = 1;
+        }
+    }
+
+    if( ( result == ICE_RESULT_OK ) && ( isCached == 0 ) )
+    {
+        /* Until the channel is bound, the TURN server only relays Send
+         * indications. The response is then created separately and carried in
+         * the DATA attribute. For a bound channel, reserve 4 bytes to add TURN
+         * channel data message header. */
+        if( ( pIceCandidatePair->pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY ) &&
+            ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_CHANNEL_BIND ) )
+        {
+            pStunMessageStart = &( stunResponse[ 0 ] );
+            stunMessageBufferLength = sizeof( stunResponse );
+            turnMessageBufferLength = *pMessageBufferLength;
+            isSendIndication = 1;
+        }
+        else if( pIceCandidatePair->pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY )
+        {
+            pStunMessageStart = &( pMessageBuffer[ ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH ] );
+            stunMessageBufferLength = *pMessageBufferLength - ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH;
             turnMessageBufferLength = *pMessageBufferLength;
         }
         else
@@ -513,10 +1133,10 @@ IceResult_t Ice_CreateResponseForRequest( IceContext_t * pContext,
         }
     }
 
-    if( result == ICE_RESULT_OK )
+    if( ( result == ICE_RESULT_OK ) && ( isCached == 0 ) )
     {
         stunHeader.messageType = STUN_MESSAGE_TYPE_BINDING_SUCCESS_RESPONSE;
-        stunHeader.pTransactionId = pTransactionId;
+        stunHeader.pTransactionId = &( transactionId[ 0 ] );
 
         stunResult = StunSerializer_Init( &( stunCtx ),
                                           pStunMessageStart,
@@ -558,17 +1178,29 @@ IceResult_t Ice_CreateResponseForRequest( IceContext_t * pContext,
     }
 
     if( ( result == ICE_RESULT_OK ) &&
+        ( isCached == 0 ) &&
         ( pIceCandidatePair->pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY ) )
     {
-        result = Ice_CreateTurnChannelDataMessage( pContext,
+        if( isSendIndication == 1 )
+        {
+            result = Ice_CreateTurnSendIndication( pContext,
                                                    pIceCandidatePair,
                                                    pStunMessageStart,
                                                    stunMessageBufferLength,
+                                                   pMessageBuffer,
                                                    &( turnMessageBufferLength ) );
+        }
+        else
+        {
+            result = Ice_CreateTurnChannelDataMessage( pContext,
+                                                       pIceCandidatePair,
+                                                       pStunMessageStart,
+                                                       stunMessageBufferLength,
+                                                       &( turnMessageBufferLength ) );
+        }
     }
 
-
-    if( result == ICE_RESULT_OK )
+    if( ( result == ICE_RESULT_OK ) && ( isCached == 0 ) )
     {
         if( pIceCandidatePair->pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY )
         {
@@ -578,6 +1210,15 @@ IceResult_t Ice_CreateResponseForRequest( IceContext_t * pContext,
         {
             *pMessageBufferLength = stunMessageBufferLength;
         }
+
+        if( ( pResponseCacheEntry != NULL ) &&
+            ( *pMessageBufferLength <= ICE_RESPONSE_CACHE_MAX_LENGTH ) )
+        {
+            memcpy( &( pResponseCacheEntry->response[ 0 ] ),
+                    pMessageBuffer,
+                    *pMessageBufferLength );
+            pResponseCacheEntry->responseLength = *pMessageBufferLength;
+        }
     }
 
     return result;
@@ -641,7 +1282,8 @@ IceResult_t Ice_HandleTurnPacket( IceContext_t * pContext,
     {
         for( i = 0; i < pContext->numCandidatePairs; i++ )
         {
-            if( ( Ice_IsSameTransportAddress( &( pContext->pCandidatePairs[ i ].pLocalCandidate->endpoint.transportAddress ),
+            if( ( ICE_CANDIDATE_PAIR_IS_CLOSED( &( pContext->pCandidatePairs[ i ] ) ) == 0 ) &&
+                ( Ice_IsSameTransportAddress( &( pContext->pCandidatePairs[ i ].pLocalCandidate->endpoint.transportAddress ),
                                               &( pLocalCandidate->endpoint.transportAddress ) ) == 1 ) &&
                 ( channelNumber == pContext->pCandidatePairs[ i ].turnChannelNumber ) )
             {
@@ -669,78 +1311,278 @@ IceResult_t Ice_HandleTurnPacket( IceContext_t * pContext,
 
 /*----------------------------------------------------------------------------*/
 
-/* Ice_HandleStunPacket - This API handles the processing of Stun Packet. */
-IceHandleStunPacketResult_t Ice_HandleStunPacket( IceContext_t * pContext,
-                                                  uint8_t * pReceivedStunMessage,
-                                                  size_t receivedStunMessageLength,
-                                                  IceCandidate_t * pLocalCandidate,
-                                                  const IceEndpoint_t * pRemoteCandidateEndpoint,
-                                                  uint64_t currentTimeSeconds,
-                                                  uint8_t ** ppTransactionId,
-                                                  IceCandidatePair_t ** ppIceCandidatePair )
+IceResult_t Ice_HandleTurnPacketSegments( IceContext_t * pContext,
+                                          const uint8_t * pReceivedBuffer,
+                                          size_t receivedBufferLength,
+                                          size_t segmentSize,
+                                          IceCandidate_t * pLocalCandidate,
+                                          IceTurnPacketSegment_t * pSegments,
+                                          size_t maxSegments,
+                                          size_t * pNumSegments )
 {
-    IceHandleStunPacketResult_t handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_OK;
-    TransactionIdStoreResult_t transactionIdStoreResult;
-    StunResult_t stunResult = STUN_RESULT_BASE;
+    IceResult_t result = ICE_RESULT_OK;
+    size_t i;
+    size_t numSegments = 0;
+    size_t offset = 0;
+    IceTurnPacketSegment_t * pSegment;
+
+    if( ( pContext == NULL ) ||
+        ( pReceivedBuffer == NULL ) ||
+        ( segmentSize == 0 ) ||
+        ( pLocalCandidate == NULL ) ||
+        ( pSegments == NULL ) ||
+        ( pNumSegments == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        numSegments = ( receivedBufferLength + segmentSize - 1 ) / segmentSize;
+
+        if( numSegments > maxSegments )
+        {
+            result = ICE_RESULT_BAD_PARAM;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        for( i = 0; i < numSegments; i++ )
+        {
+            pSegment = &( pSegments[ i ] );
+
+            pSegment->pSegment = &( pReceivedBuffer[ offset ] );
+            pSegment->segmentLength = receivedBufferLength - offset;
+
+            if( pSegment->segmentLength > segmentSize )
+            {
+                pSegment->segmentLength = segmentSize;
+            }
+
+            pSegment->pTurnPayload = NULL;
+            pSegment->turnPayloadLength = 0;
+            pSegment->pIceCandidatePair = NULL;
+            pSegment->result = Ice_HandleTurnPacket( pContext,
+                                                     pSegment->pSegment,
+                                                     pSegment->segmentLength,
+                                                     pLocalCandidate,
+                                                     &( pSegment->pTurnPayload ),
+                                                     &( pSegment->turnPayloadLength ),
+                                                     &( pSegment->pIceCandidatePair ) );
+
+            offset += pSegment->segmentLength;
+        }
+
+        *pNumSegments = numSegments;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_HandleTurnDataIndication( IceContext_t * pContext,
+                                          const uint8_t * pReceivedStunMessage,
+                                          size_t receivedStunMessageLength,
+                                          IceCandidate_t * pLocalCandidate,
+                                          const uint8_t ** ppTurnPayload,
+                                          uint16_t * pTurnPayloadLength,
+                                          IceCandidatePair_t ** ppIceCandidatePair )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    StunResult_t stunResult = STUN_RESULT_OK;
     StunContext_t stunCtx;
     StunHeader_t stunHeader;
+    StunAttribute_t stunAttribute;
+    IceTransportAddress_t peerTransportAddress;
+    uint8_t foundPeerAddress = 0, foundData = 0;
+    const uint8_t * pTurnPayload = NULL;
+    uint16_t turnPayloadLength = 0;
+    size_t i;
+    IceCandidatePair_t * pCandidatePair = NULL;
 
     if( ( pContext == NULL ) ||
         ( pReceivedStunMessage == NULL ) ||
         ( pLocalCandidate == NULL ) ||
-        ( pRemoteCandidateEndpoint == NULL ) ||
-        ( ppTransactionId == NULL ) ||
+        ( ppTurnPayload == NULL ) ||
+        ( pTurnPayloadLength == NULL ) ||
         ( ppIceCandidatePair == NULL ) )
     {
-        handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_BAD_PARAM;
+        result = ICE_RESULT_BAD_PARAM;
     }
 
-    if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
+    if( result == ICE_RESULT_OK )
     {
+        /* StunDeserializer_Init takes a non-const pointer but never writes
+         * through it; the cast only drops const. */
         stunResult = StunDeserializer_Init( &( stunCtx ),
-                                            pReceivedStunMessage,
+                                            ( uint8_t * ) pReceivedStunMessage,
                                             receivedStunMessageLength,
                                             &( stunHeader ) );
 
-        if( stunResult == STUN_RESULT_OK )
+        if( ( stunResult != STUN_RESULT_OK ) ||
+            ( stunHeader.messageType != STUN_MESSAGE_TYPE_DATA_INDICATION ) )
         {
-            switch( stunHeader.messageType )
-            {
-                case STUN_MESSAGE_TYPE_BINDING_REQUEST:
-                {
-                    handleStunPacketResult = Ice_HandleStunBindingRequest( pContext,
-                                                                           &( stunCtx ),
-                                                                           pLocalCandidate,
-                                                                           pRemoteCandidateEndpoint,
-                                                                           ppIceCandidatePair );
-                }
-                break;
-
-                case STUN_MESSAGE_TYPE_BINDING_SUCCESS_RESPONSE:
-                {
-                    transactionIdStoreResult = TransactionIdStore_HasId( pContext->pStunBindingRequestTransactionIdStore,
-                                                                         stunHeader.pTransactionId );
+            result = ICE_RESULT_TURN_INVALID_MESSAGE;
+        }
+    }
 
-                    if( transactionIdStoreResult == TRANSACTION_ID_STORE_RESULT_OK )
-                    {
-                        handleStunPacketResult = Ice_HandleServerReflexiveResponse( pContext,
-                                                                                    &( stunCtx ),
-                                                                                    pLocalCandidate );
+    if( result == ICE_RESULT_OK )
+    {
+        if( ( pLocalCandidate->candidateType != ICE_CANDIDATE_TYPE_RELAY ) ||
+            ( pLocalCandidate->state != ICE_CANDIDATE_STATE_VALID ) )
+        {
+            result = ICE_RESULT_TURN_UNEXPECTED_MESSAGE;
+        }
+    }
 
-                        ( void ) TransactionIdStore_Remove( pContext->pStunBindingRequestTransactionIdStore,
-                                                            stunHeader.pTransactionId );
-                    }
-                    else
-                    {
-                        handleStunPacketResult = Ice_HandleConnectivityCheckResponse( pContext,
-                                                                                      &( stunCtx ),
-                                                                                      &( stunHeader ),
-                                                                                      pLocalCandidate,
-                                                                                      pRemoteCandidateEndpoint,
-                                                                                      ppIceCandidatePair );
-                    }
-                }
-                break;
+    if( result == ICE_RESULT_OK )
+    {
+        /* Data indications are not authenticated - only the XOR-PEER-ADDRESS
+         * and DATA attributes are of interest. */
+        while( stunResult == STUN_RESULT_OK )
+        {
+            stunResult = StunDeserializer_GetNextAttribute( &( stunCtx ),
+                                                            &( stunAttribute ) );
+
+            if( ( stunResult == STUN_RESULT_OK ) &&
+                ( stunAttribute.attributeType == STUN_ATTRIBUTE_TYPE_XOR_PEER_ADDRESS ) )
+            {
+                stunResult = StunDeserializer_ParseAttributeAddress( &( stunCtx ),
+                                                                     &( stunAttribute ),
+                                                                     &( peerTransportAddress ) );
+                foundPeerAddress = 1;
+            }
+            else if( ( stunResult == STUN_RESULT_OK ) &&
+                     ( stunAttribute.attributeType == STUN_ATTRIBUTE_TYPE_DATA ) )
+            {
+                pTurnPayload = stunAttribute.pAttributeValue;
+                turnPayloadLength = stunAttribute.attributeValueLength;
+                foundData = 1;
+            }
+            else
+            {
+                /* Skip other attributes. */
+            }
+        }
+
+        if( ( stunResult != STUN_RESULT_NO_MORE_ATTRIBUTE_FOUND ) ||
+            ( foundPeerAddress == 0 ) ||
+            ( foundData == 0 ) )
+        {
+            result = ICE_RESULT_TURN_INVALID_MESSAGE;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        for( i = 0; i < pContext->numCandidatePairs; i++ )
+        {
+            if( ( ICE_CANDIDATE_PAIR_IS_CLOSED( &( pContext->pCandidatePairs[ i ] ) ) == 0 ) &&
+                ( Ice_IsSameTransportAddress( &( pContext->pCandidatePairs[ i ].pLocalCandidate->endpoint.transportAddress ),
+                                              &( pLocalCandidate->endpoint.transportAddress ) ) == 1 ) &&
+                ( Ice_IsSameTransportAddress( &( pContext->pCandidatePairs[ i ].pRemoteCandidate->endpoint.transportAddress ),
+                                              &( peerTransportAddress ) ) == 1 ) )
+            {
+                pCandidatePair = &( pContext->pCandidatePairs[ i ] );
+                break;
+            }
+        }
+
+        if( pCandidatePair == NULL )
+        {
+            result = ICE_RESULT_TURN_CANDIDATE_PAIR_NOT_FOUND;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        /* Update output parameters. */
+        *ppTurnPayload = pTurnPayload;
+        *pTurnPayloadLength = turnPayloadLength;
+        *ppIceCandidatePair = pCandidatePair;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_HandleStunPacket - This API handles the processing of Stun Packet. */
+IceHandleStunPacketResult_t Ice_HandleStunPacket( IceContext_t * pContext,
+                                                  const uint8_t * pReceivedStunMessage,
+                                                  size_t receivedStunMessageLength,
+                                                  IceCandidate_t * pLocalCandidate,
+                                                  const IceEndpoint_t * pRemoteCandidateEndpoint,
+                                                  uint64_t currentTimeSeconds,
+                                                  const uint8_t ** ppTransactionId,
+                                                  IceCandidatePair_t ** ppIceCandidatePair )
+{
+    IceHandleStunPacketResult_t handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_OK;
+    TransactionIdStoreResult_t transactionIdStoreResult;
+    StunResult_t stunResult = STUN_RESULT_BASE;
+    StunContext_t stunCtx;
+    StunHeader_t stunHeader;
+
+    if( ( pContext == NULL ) ||
+        ( pReceivedStunMessage == NULL ) ||
+        ( pLocalCandidate == NULL ) ||
+        ( pRemoteCandidateEndpoint == NULL ) ||
+        ( ppTransactionId == NULL ) ||
+        ( ppIceCandidatePair == NULL ) )
+    {
+        handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_BAD_PARAM;
+    }
+
+    if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
+    {
+        /* StunDeserializer_Init takes a non-const pointer but never writes
+         * through it; the cast only drops const. */
+        stunResult = StunDeserializer_Init( &( stunCtx ),
+                                            ( uint8_t * ) pReceivedStunMessage,
+                                            receivedStunMessageLength,
+                                            &( stunHeader ) );
+
+        if( stunResult == STUN_RESULT_OK )
+        {
+            switch( stunHeader.messageType )
+            {
+                case STUN_MESSAGE_TYPE_BINDING_REQUEST:
+                {
+                    handleStunPacketResult = Ice_HandleStunBindingRequest( pContext,
+                                                                           &( stunCtx ),
+                                                                           pLocalCandidate,
+                                                                           pRemoteCandidateEndpoint,
+                                                                           ppIceCandidatePair );
+                }
+                break;
+
+                case STUN_MESSAGE_TYPE_BINDING_SUCCESS_RESPONSE:
+                {
+                    transactionIdStoreResult = TransactionIdStore_HasId( pContext->pStunBindingRequestTransactionIdStore,
+                                                                         stunHeader.pTransactionId );
+
+                    if( transactionIdStoreResult == TRANSACTION_ID_STORE_RESULT_OK )
+                    {
+                        handleStunPacketResult = Ice_HandleServerReflexiveResponse( pContext,
+                                                                                    &( stunCtx ),
+                                                                                    pLocalCandidate );
+
+                        ( void ) TransactionIdStore_Remove( pContext->pStunBindingRequestTransactionIdStore,
+                                                            stunHeader.pTransactionId );
+                    }
+                    else
+                    {
+                        handleStunPacketResult = Ice_HandleConnectivityCheckResponse( pContext,
+                                                                                      &( stunCtx ),
+                                                                                      &( stunHeader ),
+                                                                                      pLocalCandidate,
+                                                                                      pRemoteCandidateEndpoint,
+                                                                                      ppIceCandidatePair );
+                    }
+                }
+                break;
 
                 case STUN_MESSAGE_TYPE_ALLOCATE_SUCCESS_RESPONSE:
                 {
@@ -916,6 +1758,109 @@ IceResult_t Ice_GetCandidatePairCount( IceContext_t * pContext,
 
 /*----------------------------------------------------------------------------*/
 
+/* Ice_GetMemoryStats - Report the capacity, current use and high-water mark of
+ * the tables of the context. Candidate slots are taken from the free list
+ * first and transaction ID slots are taken first fit, so the slots ever used
+ * are also the most used at a time. TURN servers, request templates and
+ * request caches are never given back, so their current use is their
+ * high-water mark.
+ */
+IceResult_t Ice_GetMemoryStats( IceContext_t * pContext,
+                                IceMemoryStats_t * pMemoryStats )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    TransactionIdStore_t * pStore;
+    size_t i, used;
+
+    if( ( pContext == NULL ) ||
+        ( pMemoryStats == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        Ice_SetTableStats( &( pMemoryStats->localCandidates ),
+                           pContext->maxLocalCandidates,
+                           Ice_CountUsedCandidates( pContext->pLocalCandidates,
+                                                    pContext->numLocalCandidates ),
+                           pContext->numLocalCandidates,
+                           sizeof( IceCandidate_t ) );
+
+        Ice_SetTableStats( &( pMemoryStats->remoteCandidates ),
+                           pContext->maxRemoteCandidates,
+                           Ice_CountUsedCandidates( pContext->pRemoteCandidates,
+                                                    pContext->numRemoteCandidates ),
+                           pContext->numRemoteCandidates,
+                           sizeof( IceCandidate_t ) );
+
+        Ice_SetTableStats( &( pMemoryStats->candidatePairs ),
+                           pContext->maxCandidatePairs,
+                           pContext->numCandidatePairs,
+                           pContext->candidatePairsHighWaterMark,
+                           sizeof( IceCandidatePair_t ) );
+
+        Ice_SetTableStats( &( pMemoryStats->turnServers ),
+                           pContext->maxTurnServers,
+                           pContext->numTurnServers,
+                           pContext->numTurnServers,
+                           sizeof( IceTurnServer_t ) );
+
+        pStore = pContext->pStunBindingRequestTransactionIdStore;
+        used = 0;
+        for( i = 0; i < pStore->highWaterMark; i++ )
+        {
+            if( pStore->pTransactionIdSlots[ i ].inUse == 1 )
+            {
+                used++;
+            }
+        }
+
+        Ice_SetTableStats( &( pMemoryStats->transactionIdSlots ),
+                           pStore->numTransactionIdSlots,
+                           used,
+                           pStore->highWaterMark,
+                           sizeof( TransactionIdSlot_t ) );
+
+        Ice_SetTableStats( &( pMemoryStats->stunRequestTemplates ),
+                           pContext->maxStunRequestTemplates,
+                           pContext->numStunRequestTemplates,
+                           pContext->numStunRequestTemplates,
+                           sizeof( IceStunRequestTemplate_t ) );
+
+        Ice_SetTableStats( &( pMemoryStats->requestCaches ),
+                           pContext->maxRequestCaches,
+                           pContext->numRequestCaches,
+                           pContext->numRequestCaches,
+                           sizeof( IceRequestCache_t ) );
+
+        used = 0;
+        for( i = 0; i < pContext->responseCacheHighWaterMark; i++ )
+        {
+            if( pContext->pResponseCacheEntries[ i ].pCandidatePair != NULL )
+            {
+                used++;
+            }
+        }
+
+        Ice_SetTableStats( &( pMemoryStats->responseCache ),
+                           pContext->maxResponseCacheEntries,
+                           used,
+                           pContext->responseCacheHighWaterMark,
+                           sizeof( IceResponseCacheEntry_t ) );
+
+        Ice_SetTableStats( &( pMemoryStats->credentialPool ),
+                           pContext->credentialPoolLength,
+                           pContext->credentialPoolUsed,
+                           pContext->credentialPoolHighWaterMark,
+                           1 );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
 IceResult_t Ice_CreateNextCandidateRequest( IceContext_t * pContext,
                                             IceCandidate_t * pIceCandidate,
                                             uint64_t currentTimeSeconds,
@@ -923,6 +1868,7 @@ IceResult_t Ice_CreateNextCandidateRequest( IceContext_t * pContext,
                                             size_t * pStunMessageBufferLength )
 {
     IceResult_t result = ICE_RESULT_OK;
+    uint8_t isCached = 0;
 
     if( ( pContext == NULL ) ||
         ( pIceCandidate == NULL ) ||
@@ -935,27 +1881,35 @@ IceResult_t Ice_CreateNextCandidateRequest( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pIceCandidate->candidateType == ICE_CANDIDATE_TYPE_SERVER_REFLEXIVE )
+        if( Ice_IsCandidateRequestDue( pIceCandidate,
+                                       currentTimeSeconds ) == 0 )
+        {
+            /* Host candidates, server reflexive candidates which already have
+             * the external IP address and relay candidates whose allocation
+             * does not need a refresh yet need no action. */
+            result = ICE_RESULT_NO_NEXT_ACTION;
+        }
+        else if( pIceCandidate->candidateType == ICE_CANDIDATE_TYPE_SERVER_REFLEXIVE )
         {
             /* Generate STUN request for server reflexive candidate to query
              * external IP address. */
-            if( pIceCandidate->state == ICE_CANDIDATE_STATE_NEW )
-            {
-                result = Ice_CreateServerReflexiveBindingRequest( pContext,
-                                                                  pIceCandidate,
-                                                                  pStunMessageBuffer,
-                                                                  pStunMessageBufferLength );
-            }
-            else
-            {
-                /* If the server reflexive candidate already has the external IP
-                 * address, no action is needed. */
-                result = ICE_RESULT_NO_NEXT_ACTION;
-            }
+            result = Ice_CreateServerReflexiveBindingRequest( pContext,
+                                                              pIceCandidate,
+                                                              pStunMessageBuffer,
+                                                              pStunMessageBufferLength );
         }
-        else if( pIceCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY )
+        else
         {
-            if( pIceCandidate->state == ICE_CANDIDATE_STATE_ALLOCATING )
+            isCached = Ice_ReadRequestCache( pIceCandidate->pRequestCache,
+                                             &( pIceCandidate->transactionId[ 0 ] ),
+                                             pStunMessageBuffer,
+                                             pStunMessageBufferLength );
+
+            if( isCached != 0 )
+            {
+                /* Retransmission of the cached request. */
+            }
+            else if( pIceCandidate->state == ICE_CANDIDATE_STATE_ALLOCATING )
             {
                 /* Generate TURN allocation request for relay candidate to
                  * allocate resources on the TURN server. */
@@ -974,7 +1928,7 @@ IceResult_t Ice_CreateNextCandidateRequest( IceContext_t * pContext,
                                                    pStunMessageBuffer,
                                                    pStunMessageBufferLength );
             }
-            else if( ( currentTimeSeconds + ICE_TURN_ALLOCATION_REFRESH_GRACE_PERIOD_SECONDS ) >= pIceCandidate->pTurnServer->turnAllocationExpirationTimeSeconds )
+            else
             {
                 /* Generate request for relay candidate to refresh allocation on
                  * the TURN server. */
@@ -984,17 +1938,19 @@ IceResult_t Ice_CreateNextCandidateRequest( IceContext_t * pContext,
                                                    pStunMessageBuffer,
                                                    pStunMessageBufferLength );
             }
-            else
-            {
-                result = ICE_RESULT_NO_NEXT_ACTION;
-            }
-        }
-        else
-        {
-            result = ICE_RESULT_NO_NEXT_ACTION;
         }
     }
 
+    /* Keep the created request for retransmissions of the same transaction. */
+    if( ( result == ICE_RESULT_OK ) &&
+        ( isCached == 0 ) )
+    {
+        Ice_WriteRequestCache( pIceCandidate->pRequestCache,
+                               &( pIceCandidate->transactionId[ 0 ] ),
+                               pStunMessageBuffer,
+                               *pStunMessageBufferLength );
+    }
+
     return result;
 }
 
@@ -1007,6 +1963,7 @@ IceResult_t Ice_CreateNextPairRequest( IceContext_t * pContext,
                                        size_t * pStunMessageBufferLength )
 {
     IceResult_t result = ICE_RESULT_OK;
+    uint8_t isCached = 0;
 
     if( ( pContext == NULL ) ||
         ( pIceCandidatePair == NULL ) ||
@@ -1027,90 +1984,84 @@ IceResult_t Ice_CreateNextPairRequest( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        switch( pIceCandidatePair->state )
+        if( Ice_IsCandidatePairRequestDue( pIceCandidatePair,
+                                           currentTimeSeconds ) == 0 )
+        {
+            /* Nothing to send for valid or frozen pairs and for succeeded pairs
+             * whose permission does not need a refresh yet. */
+            result = ICE_RESULT_NO_NEXT_ACTION;
+        }
+        else
+        {
+            isCached = Ice_ReadRequestCache( pIceCandidatePair->pRequestCache,
+                                             &( pIceCandidatePair->transactionId[ 0 ] ),
+                                             pStunMessageBuffer,
+                                             pStunMessageBufferLength );
+        }
+    }
+
+    if( ( result == ICE_RESULT_OK ) &&
+        ( isCached == 0 ) )
+    {
+        if( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_WAITING )
         {
-            case ICE_CANDIDATE_PAIR_STATE_WAITING:
+            /* Generate STUN request for connectivity check. */
+            result = Ice_CreateRequestForConnectivityCheck( pContext,
+                                                            pIceCandidatePair,
+                                                            pStunMessageBuffer,
+                                                            pStunMessageBufferLength );
+        }
+        else if( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_NOMINATED )
+        {
+            if( pContext->isControlling == 1 )
+            {
+                /* Generate request for nominating a candidate pair. */
+                result = Ice_CreateRequestForNominatingCandidatePair( pContext,
+                                                                      pIceCandidatePair,
+                                                                      pStunMessageBuffer,
+                                                                      pStunMessageBufferLength );
+            }
+            else
             {
-                /* Generate STUN request for connectivity check. */
+                /* Controlled ICE agent might receive USE-CANDIDATE in
+                 * connectivity check stage which would transition the
+                 * pair's state to nominated. We still keep sending
+                 * connectivity checks requests until connectivity check is
+                 * successful at which point the pair's state would
+                 * transition to succeeded. */
                 result = Ice_CreateRequestForConnectivityCheck( pContext,
                                                                 pIceCandidatePair,
                                                                 pStunMessageBuffer,
                                                                 pStunMessageBufferLength );
             }
-            break;
-
-            case ICE_CANDIDATE_PAIR_STATE_NOMINATED:
-            {
-                if( pContext->isControlling == 1 )
-                {
-                    /* Generate request for nominating a candidate pair. */
-                    result = Ice_CreateRequestForNominatingCandidatePair( pContext,
-                                                                          pIceCandidatePair,
-                                                                          pStunMessageBuffer,
-                                                                          pStunMessageBufferLength );
-                }
-                else
-                {
-                    /* Controlled ICE agent might receive USE-CANDIDATE in
-                     * connectivity check stage which would transition the
-                     * pair's state to nominated. We still keep sending
-                     * connectivity checks requests until connectivity check is
-                     * successful at which point the pair's state would
-                     * transition to succeeded. */
-                    result = Ice_CreateRequestForConnectivityCheck( pContext,
-                                                                    pIceCandidatePair,
-                                                                    pStunMessageBuffer,
-                                                                    pStunMessageBufferLength );
-                }
-            }
-            break;
-
-            case ICE_CANDIDATE_PAIR_STATE_CREATE_PERMISSION:
-            {
-                /* Generate request to create permission on the TURN server. */
-                result = Ice_CreatePermissionRequest( pContext,
-                                                      pIceCandidatePair,
-                                                      pStunMessageBuffer,
-                                                      pStunMessageBufferLength );
-            }
-            break;
-
-            case ICE_CANDIDATE_PAIR_STATE_CHANNEL_BIND:
-            {
-                /* Generate request for binding a channel number to a remote peer. */
-                result = Ice_CreateChannelBindRequest( pContext,
-                                                       pIceCandidatePair,
-                                                       pStunMessageBuffer,
-                                                       pStunMessageBufferLength );
-            }
-            break;
-
-            case ICE_CANDIDATE_PAIR_STATE_SUCCEEDED:
-            {
-                result = ICE_RESULT_NO_NEXT_ACTION;
-
-                if( ( pIceCandidatePair->pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY ) &&
-                    ( pIceCandidatePair->pLocalCandidate->state == ICE_CANDIDATE_STATE_VALID ) &&
-                    ( ( currentTimeSeconds + ICE_TURN_PERMISSION_REFRESH_GRACE_PERIOD_SECONDS ) >= pIceCandidatePair->turnPermissionExpirationSeconds ) )
-                {
-                    result = Ice_CreatePermissionRequest( pContext,
-                                                          pIceCandidatePair,
-                                                          pStunMessageBuffer,
-                                                          pStunMessageBufferLength );
-                }
-            }
-            break;
-
-            /* Intentional fall through. */
-            case ICE_CANDIDATE_PAIR_STATE_VALID:
-            case ICE_CANDIDATE_PAIR_STATE_FROZEN:
-            default:
-            {
-                /* Do nothing. */
-                result = ICE_RESULT_NO_NEXT_ACTION;
-            }
-            break;
         }
+        else if( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_CHANNEL_BIND )
+        {
+            /* Generate request for binding a channel number to a remote peer. */
+            result = Ice_CreateChannelBindRequest( pContext,
+                                                   pIceCandidatePair,
+                                                   pStunMessageBuffer,
+                                                   pStunMessageBufferLength );
+        }
+        else
+        {
+            /* Generate request to create or refresh the permission on the TURN
+             * server. */
+            result = Ice_CreatePermissionRequest( pContext,
+                                                  pIceCandidatePair,
+                                                  pStunMessageBuffer,
+                                                  pStunMessageBufferLength );
+        }
+    }
+
+    /* Keep the created request for retransmissions of the same transaction. */
+    if( ( result == ICE_RESULT_OK ) &&
+        ( isCached == 0 ) )
+    {
+        Ice_WriteRequestCache( pIceCandidatePair->pRequestCache,
+                               &( pIceCandidatePair->transactionId[ 0 ] ),
+                               pStunMessageBuffer,
+                               *pStunMessageBufferLength );
     }
 
     return result;
@@ -1118,56 +2069,418 @@ IceResult_t Ice_CreateNextPairRequest( IceContext_t * pContext,
 
 /*----------------------------------------------------------------------------*/
 
-IceResult_t Ice_CreateTurnChannelDataMessage( IceContext_t * pContext,
-                                              const IceCandidatePair_t * pIceCandidatePair,
-                                              uint8_t * pTurnPayload,
-                                              size_t turnPayloadLength,
-                                              size_t * pTotalBufferLength )
+IceResult_t Ice_CreateEarlyConnectivityCheck( IceContext_t * pContext,
+                                              IceCandidatePair_t * pIceCandidatePair,
+                                              uint8_t * pStunMessageBuffer,
+                                              size_t * pStunMessageBufferLength )
 {
     IceResult_t result = ICE_RESULT_OK;
-    uint8_t * pChannelDataHeader = NULL;
-    uint16_t padding;
+    uint8_t stunRequest[ ICE_REQUEST_CACHE_MAX_LENGTH ];
+    size_t stunRequestLength = sizeof( stunRequest );
 
     if( ( pContext == NULL ) ||
         ( pIceCandidatePair == NULL ) ||
-        ( pTurnPayload == NULL ) ||
-        ( pTotalBufferLength == NULL ) )
+        ( pStunMessageBuffer == NULL ) ||
+        ( pStunMessageBufferLength == NULL ) )
     {
         result = ICE_RESULT_BAD_PARAM;
     }
 
     if( result == ICE_RESULT_OK )
     {
-        /* Calculate the padding by rounding up to 4. */
-        padding = ( ( turnPayloadLength + 3 ) & ~3 ) - turnPayloadLength;
-
-        if( *pTotalBufferLength < ( ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH + turnPayloadLength + padding ) )
+        if( ( pIceCandidatePair->pLocalCandidate == NULL ) ||
+            ( pIceCandidatePair->pRemoteCandidate == NULL ) )
         {
-            result = ICE_RESULT_OUT_OF_MEMORY;
+            result = ICE_RESULT_INVALID_CANDIDATE_PAIR;
         }
     }
 
     if( result == ICE_RESULT_OK )
     {
-        if( ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_INVALID ) ||
-            ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_FROZEN ) )
+        /* A ChannelBind refresh of a succeeded pair needs no check. */
+        if( ( pIceCandidatePair->pLocalCandidate->candidateType != ICE_CANDIDATE_TYPE_RELAY ) ||
+            ( pIceCandidatePair->state != ICE_CANDIDATE_PAIR_STATE_CHANNEL_BIND ) ||
+            ( ( pIceCandidatePair->flags & ( ICE_STUN_RESPONSE_RECEIVED_FLAG | ICE_CANDIDATE_PAIR_SUCCEEDED_FLAG ) ) != 0U ) )
         {
-            result = ICE_RESULT_TURN_CHANNEL_DATA_HEADER_NOT_REQUIRED;
+            result = ICE_RESULT_NO_NEXT_ACTION;
         }
     }
 
     if( result == ICE_RESULT_OK )
     {
-        pChannelDataHeader = pTurnPayload - ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH;
+        result = Ice_CreateRequestForEarlyConnectivityCheck( pContext,
+                                                             pIceCandidatePair,
+                                                             &( stunRequest[ 0 ] ),
+                                                             &( stunRequestLength ) );
+    }
 
-        ICE_WRITE_UINT16( &( pChannelDataHeader[ ICE_TURN_CHANNEL_DATA_MESSAGE_CHANNEL_NUMBER_OFFSET ] ),
-                          pIceCandidatePair->turnChannelNumber );
-        ICE_WRITE_UINT16( &( pChannelDataHeader[ ICE_TURN_CHANNEL_DATA_MESSAGE_LENGTH_OFFSET ] ),
-                          turnPayloadLength );
+    if( result == ICE_RESULT_OK )
+    {
+        result = Ice_CreateTurnSendIndication( pContext,
+                                               pIceCandidatePair,
+                                               &( stunRequest[ 0 ] ),
+                                               stunRequestLength,
+                                               pStunMessageBuffer,
+                                               pStunMessageBufferLength );
+    }
 
-        if( padding > 0 )
-        {
-            memset( &( pTurnPayload[ turnPayloadLength ] ), 0, padding );
+    if( result == ICE_RESULT_OK )
+    {
+        pIceCandidatePair->flags |= ICE_STUN_REQUEST_SENT_FLAG;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_GetNextCandidateRequest( IceContext_t * pContext,
+                                         IceCandidate_t * pIceCandidate,
+                                         uint64_t currentTimeSeconds,
+                                         const uint8_t ** ppStunMessage,
+                                         size_t * pStunMessageLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    size_t stunMessageLength = ICE_REQUEST_CACHE_MAX_LENGTH;
+
+    if( ( pContext == NULL ) ||
+        ( pIceCandidate == NULL ) ||
+        ( ppStunMessage == NULL ) ||
+        ( pStunMessageLength == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        if( pIceCandidate->pRequestCache == NULL )
+        {
+            result = ICE_RESULT_BAD_PARAM;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = Ice_CreateNextCandidateRequest( pContext,
+                                                 pIceCandidate,
+                                                 currentTimeSeconds,
+                                                 &( pIceCandidate->pRequestCache->message[ 0 ] ),
+                                                 &( stunMessageLength ) );
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        *ppStunMessage = &( pIceCandidate->pRequestCache->message[ 0 ] );
+        *pStunMessageLength = stunMessageLength;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_GetNextPairRequest( IceContext_t * pContext,
+                                    IceCandidatePair_t * pIceCandidatePair,
+                                    uint64_t currentTimeSeconds,
+                                    const uint8_t ** ppStunMessage,
+                                    size_t * pStunMessageLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    size_t stunMessageLength = ICE_REQUEST_CACHE_MAX_LENGTH;
+
+    if( ( pContext == NULL ) ||
+        ( pIceCandidatePair == NULL ) ||
+        ( ppStunMessage == NULL ) ||
+        ( pStunMessageLength == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        if( pIceCandidatePair->pRequestCache == NULL )
+        {
+            result = ICE_RESULT_BAD_PARAM;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = Ice_CreateNextPairRequest( pContext,
+                                            pIceCandidatePair,
+                                            currentTimeSeconds,
+                                            &( pIceCandidatePair->pRequestCache->message[ 0 ] ),
+                                            &( stunMessageLength ) );
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        *ppStunMessage = &( pIceCandidatePair->pRequestCache->message[ 0 ] );
+        *pStunMessageLength = stunMessageLength;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_CreateNextRequestsBatch( IceContext_t * pContext,
+                                         uint64_t currentTimeSeconds,
+                                         uint8_t * pArena,
+                                         size_t arenaLength,
+                                         IceRequestDescriptor_t * pDescriptors,
+                                         size_t maxDescriptors,
+                                         size_t * pNumDescriptors )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    IceResult_t firstErrorResult = ICE_RESULT_OK;
+    IceResult_t requestResult;
+    size_t i;
+    size_t index;
+    size_t numDescriptors = 0;
+    size_t arenaOffset = 0;
+    size_t requestLength;
+    uint8_t isFull = 0;
+    IceCandidate_t * pLocalCandidate;
+    IceCandidatePair_t * pIceCandidatePair;
+
+    if( ( pContext == NULL ) ||
+        ( pArena == NULL ) ||
+        ( pDescriptors == NULL ) ||
+        ( pNumDescriptors == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    /* Requests for the STUN and TURN servers of the local candidates. The
+     * visit starts where the previous full batch stopped so that the
+     * candidates at the end get their turn. Local candidate slots are never
+     * given back, so the cursor stays within numLocalCandidates. */
+    if( result == ICE_RESULT_OK )
+    {
+        index = pContext->batchNextLocalCandidate;
+
+        for( i = 0; ( isFull == 0 ) && ( i < pContext->numLocalCandidates ); i++ )
+        {
+            pLocalCandidate = &( pContext->pLocalCandidates[ index ] );
+            requestResult = ICE_RESULT_NO_NEXT_ACTION;
+
+            if( Ice_IsCandidateRequestDue( pLocalCandidate,
+                                           currentTimeSeconds ) == 0 )
+            {
+                /* Nothing to send for this candidate. */
+            }
+            else if( ( numDescriptors == maxDescriptors ) ||
+                     ( ( arenaLength - arenaOffset ) < ICE_REQUEST_CACHE_MAX_LENGTH ) )
+            {
+                isFull = 1;
+                pContext->batchNextLocalCandidate = index;
+            }
+            else
+            {
+                requestLength = arenaLength - arenaOffset;
+                requestResult = Ice_CreateNextCandidateRequest( pContext,
+                                                                pLocalCandidate,
+                                                                currentTimeSeconds,
+                                                                &( pArena[ arenaOffset ] ),
+                                                                &( requestLength ) );
+            }
+
+            if( requestResult == ICE_RESULT_OK )
+            {
+                pDescriptors[ numDescriptors ].offset = arenaOffset;
+                pDescriptors[ numDescriptors ].length = requestLength;
+                pDescriptors[ numDescriptors ].pLocalCandidate = pLocalCandidate;
+                pDescriptors[ numDescriptors ].pDestination = NULL;
+                numDescriptors++;
+                arenaOffset += requestLength;
+            }
+            else if( ( requestResult != ICE_RESULT_NO_NEXT_ACTION ) &&
+                     ( firstErrorResult == ICE_RESULT_OK ) )
+            {
+                /* Keep going, the other candidates are not affected. */
+                firstErrorResult = requestResult;
+            }
+            else
+            {
+                /* Empty else marker. */
+            }
+
+            index = ( ( index + 1U ) < pContext->numLocalCandidates ) ? ( index + 1U ) : 0U;
+        }
+    }
+
+    /* With lazy candidate pairs, one more candidate pair is created per batch
+     * so that the checks are paced in the order of priority. */
+    if( ( result == ICE_RESULT_OK ) &&
+        ( pContext->lazyCandidatePairs != 0 ) )
+    {
+        requestResult = Ice_AddNextCandidatePair( pContext,
+                                                  &( pIceCandidatePair ) );
+
+        /* A full candidate pair array is not an error here, the next
+         * candidate pair is created once a slot is closed. */
+        if( ( requestResult != ICE_RESULT_OK ) &&
+            ( requestResult != ICE_RESULT_NO_NEXT_ACTION ) &&
+            ( requestResult != ICE_RESULT_MAX_CANDIDATE_PAIR_THRESHOLD ) &&
+            ( firstErrorResult == ICE_RESULT_OK ) )
+        {
+            firstErrorResult = requestResult;
+        }
+    }
+
+    /* Requests for the candidate pairs. Requests of a relay candidate are
+     * sent to its TURN server. */
+    if( result == ICE_RESULT_OK )
+    {
+        index = pContext->batchNextCandidatePair;
+
+        /* Closed candidate pairs may have been removed since. */
+        if( index >= pContext->numCandidatePairs )
+        {
+            index = 0;
+        }
+
+        for( i = 0; ( isFull == 0 ) && ( i < pContext->numCandidatePairs ); i++ )
+        {
+            pIceCandidatePair = &( pContext->pCandidatePairs[ index ] );
+            requestResult = ICE_RESULT_NO_NEXT_ACTION;
+
+            if( ( pIceCandidatePair->pLocalCandidate == NULL ) ||
+                ( pIceCandidatePair->pRemoteCandidate == NULL ) )
+            {
+                requestResult = ICE_RESULT_INVALID_CANDIDATE_PAIR;
+            }
+            else if( Ice_IsCandidatePairRequestDue( pIceCandidatePair,
+                                                    currentTimeSeconds ) == 0 )
+            {
+                /* Nothing to send for this candidate pair. */
+            }
+            else if( ( numDescriptors == maxDescriptors ) ||
+                     ( ( arenaLength - arenaOffset ) < ICE_REQUEST_CACHE_MAX_LENGTH ) )
+            {
+                isFull = 1;
+                pContext->batchNextCandidatePair = index;
+            }
+            else
+            {
+                requestLength = arenaLength - arenaOffset;
+                requestResult = Ice_CreateNextPairRequest( pContext,
+                                                           pIceCandidatePair,
+                                                           currentTimeSeconds,
+                                                           &( pArena[ arenaOffset ] ),
+                                                           &( requestLength ) );
+            }
+
+            if( requestResult == ICE_RESULT_OK )
+            {
+                pDescriptors[ numDescriptors ].offset = arenaOffset;
+                pDescriptors[ numDescriptors ].length = requestLength;
+                pDescriptors[ numDescriptors ].pLocalCandidate = pIceCandidatePair->pLocalCandidate;
+
+                if( pIceCandidatePair->pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY )
+                {
+                    pDescriptors[ numDescriptors ].pDestination = NULL;
+                }
+                else
+                {
+                    pDescriptors[ numDescriptors ].pDestination = &( pIceCandidatePair->pRemoteCandidate->endpoint );
+                }
+
+                numDescriptors++;
+                arenaOffset += requestLength;
+            }
+            else if( ( requestResult != ICE_RESULT_NO_NEXT_ACTION ) &&
+                     ( firstErrorResult == ICE_RESULT_OK ) )
+            {
+                /* Keep going, the other candidate pairs are not affected. */
+                firstErrorResult = requestResult;
+            }
+            else
+            {
+                /* Empty else marker. */
+            }
+
+            index = ( ( index + 1U ) < pContext->numCandidatePairs ) ? ( index + 1U ) : 0U;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        if( firstErrorResult != ICE_RESULT_OK )
+        {
+            result = firstErrorResult;
+        }
+        else if( isFull != 0 )
+        {
+            result = ICE_RESULT_REQUESTS_BATCH_FULL;
+        }
+        else
+        {
+            /* All the requests due are in the batch. */
+        }
+    }
+
+    if( pNumDescriptors != NULL )
+    {
+        *pNumDescriptors = numDescriptors;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_CreateTurnChannelDataMessage( IceContext_t * pContext,
+                                              const IceCandidatePair_t * pIceCandidatePair,
+                                              uint8_t * pTurnPayload,
+                                              size_t turnPayloadLength,
+                                              size_t * pTotalBufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    uint8_t * pChannelDataHeader = NULL;
+    uint16_t padding;
+
+    if( ( pContext == NULL ) ||
+        ( pIceCandidatePair == NULL ) ||
+        ( pTurnPayload == NULL ) ||
+        ( pTotalBufferLength == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        /* Calculate the padding by rounding up to 4. */
+        padding = ( ( turnPayloadLength + 3 ) & ~3 ) - turnPayloadLength;
+
+        if( *pTotalBufferLength < ( ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH + turnPayloadLength + padding ) )
+        {
+            result = ICE_RESULT_OUT_OF_MEMORY;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        if( ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_INVALID ) ||
+            ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_FROZEN ) )
+        {
+            result = ICE_RESULT_TURN_CHANNEL_DATA_HEADER_NOT_REQUIRED;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        pChannelDataHeader = pTurnPayload - ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH;
+
+        ICE_WRITE_UINT16( &( pChannelDataHeader[ ICE_TURN_CHANNEL_DATA_MESSAGE_CHANNEL_NUMBER_OFFSET ] ),
+                          pIceCandidatePair->turnChannelNumber );
+        ICE_WRITE_UINT16( &( pChannelDataHeader[ ICE_TURN_CHANNEL_DATA_MESSAGE_LENGTH_OFFSET ] ),
+                          turnPayloadLength );
+
+        if( padding > 0 )
+        {
+            memset( &( pTurnPayload[ turnPayloadLength ] ), 0, padding );
         }
 
         *pTotalBufferLength = turnPayloadLength + ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH + padding;
@@ -1177,3 +2490,459 @@ IceResult_t Ice_CreateTurnChannelDataMessage( IceContext_t * pContext,
 }
 
 /*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_CreateTurnChannelDataSegments( IceContext_t * pContext,
+                                               const IceCandidatePair_t * pIceCandidatePair,
+                                               const uint8_t * pTurnPayload,
+                                               size_t turnPayloadLength,
+                                               IceTurnChannelDataFraming_t * pFraming,
+                                               IceBufferSegment_t * pSegments,
+                                               size_t * pNumSegments )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    size_t numSegments;
+    uint16_t padding;
+
+    if( ( pContext == NULL ) ||
+        ( pIceCandidatePair == NULL ) ||
+        ( pTurnPayload == NULL ) ||
+        ( turnPayloadLength > UINT16_MAX ) ||
+        ( pFraming == NULL ) ||
+        ( pSegments == NULL ) ||
+        ( pNumSegments == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        /* Calculate the padding by rounding up to 4. */
+        padding = ( ( turnPayloadLength + 3 ) & ~3 ) - turnPayloadLength;
+        numSegments = ( padding > 0 ) ? 3 : 2;
+
+        if( *pNumSegments < numSegments )
+        {
+            result = ICE_RESULT_OUT_OF_MEMORY;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        if( ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_INVALID ) ||
+            ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_FROZEN ) )
+        {
+            result = ICE_RESULT_TURN_CHANNEL_DATA_HEADER_NOT_REQUIRED;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        ICE_WRITE_UINT16( &( pFraming->header[ ICE_TURN_CHANNEL_DATA_MESSAGE_CHANNEL_NUMBER_OFFSET ] ),
+                          pIceCandidatePair->turnChannelNumber );
+        ICE_WRITE_UINT16( &( pFraming->header[ ICE_TURN_CHANNEL_DATA_MESSAGE_LENGTH_OFFSET ] ),
+                          turnPayloadLength );
+
+        pSegments[ 0 ].pBuffer = &( pFraming->header[ 0 ] );
+        pSegments[ 0 ].bufferLength = ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH;
+        pSegments[ 1 ].pBuffer = pTurnPayload;
+        pSegments[ 1 ].bufferLength = turnPayloadLength;
+
+        if( padding > 0 )
+        {
+            memset( &( pFraming->padding[ 0 ] ),
+                    0,
+                    padding );
+
+            pSegments[ 2 ].pBuffer = &( pFraming->padding[ 0 ] );
+            pSegments[ 2 ].bufferLength = padding;
+        }
+
+        *pNumSegments = numSegments;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_CreateTurnChannelDataBurst( IceContext_t * pContext,
+                                            const IceCandidatePair_t * pIceCandidatePair,
+                                            const IceBufferSegment_t * pTurnPayloads,
+                                            size_t numTurnPayloads,
+                                            IceTurnChannelDataBurstMessage_t * pMessages )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    IceTurnChannelDataBurstMessage_t * pMessage;
+    uint8_t channelNumber[ 2 ];
+    size_t i, turnPayloadLength, padding;
+
+    if( ( pContext == NULL ) ||
+        ( pIceCandidatePair == NULL ) ||
+        ( pTurnPayloads == NULL ) ||
+        ( pMessages == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        for( i = 0; i < numTurnPayloads; i++ )
+        {
+            if( ( pTurnPayloads[ i ].pBuffer == NULL ) ||
+                ( pTurnPayloads[ i ].bufferLength > UINT16_MAX ) )
+            {
+                result = ICE_RESULT_BAD_PARAM;
+                break;
+            }
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        if( ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_INVALID ) ||
+            ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_FROZEN ) )
+        {
+            result = ICE_RESULT_TURN_CHANNEL_DATA_HEADER_NOT_REQUIRED;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        /* The channel number is the same for all the messages. */
+        ICE_WRITE_UINT16( &( channelNumber[ 0 ] ),
+                          pIceCandidatePair->turnChannelNumber );
+
+        for( i = 0; i < numTurnPayloads; i++ )
+        {
+            pMessage = &( pMessages[ i ] );
+            turnPayloadLength = pTurnPayloads[ i ].bufferLength;
+
+            /* The length is written in network byte order directly. */
+            pMessage->framing.header[ ICE_TURN_CHANNEL_DATA_MESSAGE_CHANNEL_NUMBER_OFFSET ] = channelNumber[ 0 ];
+            pMessage->framing.header[ ICE_TURN_CHANNEL_DATA_MESSAGE_CHANNEL_NUMBER_OFFSET + 1 ] = channelNumber[ 1 ];
+            pMessage->framing.header[ ICE_TURN_CHANNEL_DATA_MESSAGE_LENGTH_OFFSET ] = ( uint8_t ) ( turnPayloadLength >> 8 );
+            pMessage->framing.header[ ICE_TURN_CHANNEL_DATA_MESSAGE_LENGTH_OFFSET + 1 ] = ( uint8_t ) ( turnPayloadLength & 0xFF );
+
+            pMessage->segments[ 0 ].pBuffer = &( pMessage->framing.header[ 0 ] );
+            pMessage->segments[ 0 ].bufferLength = ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH;
+            pMessage->segments[ 1 ] = pTurnPayloads[ i ];
+            pMessage->numSegments = 2;
+
+            /* Calculate the padding by rounding up to 4. */
+            padding = ( ( turnPayloadLength + 3 ) & ~3 ) - turnPayloadLength;
+
+            if( padding > 0 )
+            {
+                memset( &( pMessage->framing.padding[ 0 ] ),
+                        0,
+                        ICE_TURN_CHANNEL_DATA_MESSAGE_MAX_PADDING_LENGTH );
+
+                pMessage->segments[ 2 ].pBuffer = &( pMessage->framing.padding[ 0 ] );
+                pMessage->segments[ 2 ].bufferLength = padding;
+                pMessage->numSegments = 3;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_CreateTurnSendIndication( IceContext_t * pContext,
+                                          const IceCandidatePair_t * pIceCandidatePair,
+                                          const uint8_t * pTurnPayload,
+                                          size_t turnPayloadLength,
+                                          uint8_t * pBuffer,
+                                          size_t * pBufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    StunResult_t stunResult = STUN_RESULT_OK;
+    StunContext_t stunCtx;
+    StunHeader_t stunHeader;
+    uint8_t transactionId[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+
+    if( ( pContext == NULL ) ||
+        ( pIceCandidatePair == NULL ) ||
+        ( pTurnPayload == NULL ) ||
+        ( turnPayloadLength > UINT16_MAX ) ||
+        ( pBuffer == NULL ) ||
+        ( pBufferLength == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        if( pIceCandidatePair->pLocalCandidate->candidateType != ICE_CANDIDATE_TYPE_RELAY )
+        {
+            result = ICE_RESULT_INVALID_CANDIDATE;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        /* The TURN server drops Send indications to peers without a
+         * permission. */
+        if( ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_INVALID ) ||
+            ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_FROZEN ) ||
+            ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_CREATE_PERMISSION ) )
+        {
+            result = ICE_RESULT_TURN_PERMISSION_NOT_INSTALLED;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        /* Indications are neither retransmitted nor answered, so each one gets
+         * a fresh transaction ID. */
+        result = Ice_GenerateRandom( pContext,
+                                     &( transactionId[ 0 ] ),
+                                     STUN_HEADER_TRANSACTION_ID_LENGTH );
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        stunHeader.messageType = STUN_MESSAGE_TYPE_SEND_INDICATION;
+        stunHeader.pTransactionId = &( transactionId[ 0 ] );
+
+        stunResult = StunSerializer_Init( &( stunCtx ),
+                                          pBuffer,
+                                          *pBufferLength,
+                                          &( stunHeader ) );
+    }
+
+    if( ( result == ICE_RESULT_OK ) && ( stunResult == STUN_RESULT_OK ) )
+    {
+        stunResult = StunSerializer_AddAttributeAddress( &( stunCtx ),
+                                                         &( pIceCandidatePair->pRemoteCandidate->endpoint.transportAddress ),
+                                                         STUN_ATTRIBUTE_TYPE_XOR_PEER_ADDRESS );
+
+        if( stunResult != STUN_RESULT_OK )
+        {
+            result = ICE_RESULT_STUN_ERROR_ADD_XOR_PEER_ADDRESS;
+        }
+    }
+
+    if( ( result == ICE_RESULT_OK ) && ( stunResult == STUN_RESULT_OK ) )
+    {
+        /* Send indications carry no MESSAGE-INTEGRITY or FINGERPRINT. */
+        stunResult = StunSerializer_AddAttributeData( &( stunCtx ),
+                                                      pTurnPayload,
+                                                      ( uint16_t ) turnPayloadLength );
+
+        if( stunResult != STUN_RESULT_OK )
+        {
+            result = ICE_RESULT_STUN_ERROR_ADD_DATA;
+        }
+    }
+
+    if( ( result == ICE_RESULT_OK ) && ( stunResult == STUN_RESULT_OK ) )
+    {
+        stunResult = StunSerializer_Finalize( &( stunCtx ),
+                                              pBufferLength );
+    }
+
+    if( ( result == ICE_RESULT_OK ) && ( stunResult != STUN_RESULT_OK ) )
+    {
+        result = ICE_RESULT_STUN_ERROR;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_InitTurnStreamDeframer( IceTurnStreamDeframer_t * pDeframer,
+                                        IceCandidate_t * pLocalCandidate,
+                                        uint8_t * pBuffer,
+                                        size_t bufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+
+    if( ( pDeframer == NULL ) ||
+        ( pLocalCandidate == NULL ) ||
+        ( pBuffer == NULL ) ||
+        ( bufferLength < ICE_TURN_STREAM_FRAME_HEADER_LENGTH ) ||
+        ( pLocalCandidate->candidateType != ICE_CANDIDATE_TYPE_RELAY ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        pDeframer->pLocalCandidate = pLocalCandidate;
+        pDeframer->pBuffer = pBuffer;
+        pDeframer->bufferLength = bufferLength;
+        pDeframer->bufferedLength = 0;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t Ice_DeframeTurnStream( IceContext_t * pContext,
+                                   IceTurnStreamDeframer_t * pDeframer,
+                                   const uint8_t * pChunk,
+                                   size_t chunkLength,
+                                   size_t * pConsumedLength,
+                                   IceTurnStreamFrame_t * pFrame )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    const uint8_t * pFrameStart = NULL;
+    size_t availableLength = 0;
+    size_t copyLength;
+    size_t consumedLength = 0;
+    size_t frameLength = 0;
+    size_t paddedFrameLength = 0;
+
+    if( ( pContext == NULL ) ||
+        ( pDeframer == NULL ) ||
+        ( pChunk == NULL ) ||
+        ( pConsumedLength == NULL ) ||
+        ( pFrame == NULL ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        if( pDeframer->bufferedLength == 0 )
+        {
+            /* Return the frame in place if the chunk contains all of it. */
+            pFrameStart = pChunk;
+            availableLength = chunkLength;
+        }
+        else if( pDeframer->bufferedLength < ICE_TURN_STREAM_FRAME_HEADER_LENGTH )
+        {
+            /* Complete the header to learn the frame length. */
+            copyLength = ICE_TURN_STREAM_FRAME_HEADER_LENGTH - pDeframer->bufferedLength;
+            copyLength = ( copyLength < chunkLength ) ? copyLength : chunkLength;
+
+            memcpy( &( pDeframer->pBuffer[ pDeframer->bufferedLength ] ),
+                    pChunk,
+                    copyLength );
+            pDeframer->bufferedLength += copyLength;
+            consumedLength = copyLength;
+
+            pFrameStart = pDeframer->pBuffer;
+            availableLength = pDeframer->bufferedLength;
+        }
+        else
+        {
+            pFrameStart = pDeframer->pBuffer;
+            availableLength = pDeframer->bufferedLength;
+        }
+    }
+
+    if( ( result == ICE_RESULT_OK ) &&
+        ( availableLength >= ICE_TURN_STREAM_FRAME_HEADER_LENGTH ) )
+    {
+        frameLength = ICE_READ_UINT16( &( pFrameStart[ ICE_TURN_STREAM_FRAME_LENGTH_OFFSET ] ) );
+
+        /* The first 2 bits are 0b00 for STUN messages and 0b01 for ChannelData
+         * messages. */
+        if( ( pFrameStart[ 0 ] & 0xC0 ) == 0x00 )
+        {
+            pFrame->frameType = ICE_TURN_STREAM_FRAME_TYPE_STUN;
+            frameLength += ICE_STUN_HEADER_LENGTH;
+            paddedFrameLength = frameLength;
+        }
+        else if( ( pFrameStart[ 0 ] & 0xC0 ) == 0x40 )
+        {
+            /* ChannelData messages are padded to a multiple of 4 over TCP. */
+            pFrame->frameType = ICE_TURN_STREAM_FRAME_TYPE_CHANNEL_DATA;
+            frameLength += ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH;
+            paddedFrameLength = ( frameLength + 3 ) & ~( ( size_t ) 3 );
+        }
+        else
+        {
+            result = ICE_RESULT_TURN_INVALID_MESSAGE;
+        }
+
+        if( ( result == ICE_RESULT_OK ) &&
+            ( pFrameStart == pDeframer->pBuffer ) )
+        {
+            if( paddedFrameLength > pDeframer->bufferLength )
+            {
+                result = ICE_RESULT_OUT_OF_MEMORY;
+            }
+            else
+            {
+                /* Copy as much of the rest of the frame as available. */
+                copyLength = paddedFrameLength - pDeframer->bufferedLength;
+                copyLength = ( copyLength < ( chunkLength - consumedLength ) ) ? copyLength :
+                             ( chunkLength - consumedLength );
+
+                memcpy( &( pDeframer->pBuffer[ pDeframer->bufferedLength ] ),
+                        &( pChunk[ consumedLength ] ),
+                        copyLength );
+                pDeframer->bufferedLength += copyLength;
+                consumedLength += copyLength;
+                availableLength = pDeframer->bufferedLength;
+            }
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        if( ( availableLength >= ICE_TURN_STREAM_FRAME_HEADER_LENGTH ) &&
+            ( availableLength >= paddedFrameLength ) )
+        {
+            pFrame->pFrame = pFrameStart;
+            pFrame->frameLength = frameLength;
+
+            if( pFrameStart == pDeframer->pBuffer )
+            {
+                /* The frame stays in the buffer until the next call. */
+                pDeframer->bufferedLength = 0;
+            }
+            else
+            {
+                consumedLength = paddedFrameLength;
+            }
+        }
+        else
+        {
+            /* Keep the start of the frame for the next chunk. */
+            if( pFrameStart != pDeframer->pBuffer )
+            {
+                /* The chunk is shorter than the frame, and shorter than the
+                 * buffer if the frame length is not known yet. */
+                if( paddedFrameLength > pDeframer->bufferLength )
+                {
+                    result = ICE_RESULT_OUT_OF_MEMORY;
+                }
+                else
+                {
+                    memcpy( pDeframer->pBuffer,
+                            pChunk,
+                            chunkLength );
+                    pDeframer->bufferedLength = chunkLength;
+                    consumedLength = chunkLength;
+                }
+            }
+
+            if( result == ICE_RESULT_OK )
+            {
+                result = ICE_RESULT_TURN_STREAM_NEED_MORE_DATA;
+            }
+        }
+    }
+
+    if( ( result == ICE_RESULT_TURN_INVALID_MESSAGE ) ||
+        ( result == ICE_RESULT_OUT_OF_MEMORY ) )
+    {
+        pDeframer->bufferedLength = 0;
+    }
+
+    if( pConsumedLength != NULL )
+    {
+        *pConsumedLength = consumedLength;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -6,6 +6,7 @@
 /* API includes. */
 #include "ice_api.h"
 #include "ice_api_private.h"
+#include "ice_crypto.h"
 
 /* STUN API includes. */
 #include "stun_data_types.h"
@@ -21,11 +22,46 @@
 #define ICE_PRIORITY_RELAY_CANDIDATE_TYPE_PREFERENCE               0
 #define ICE_PRIORITY_LOCAL_PREFERENCE                              65535
 
+/* Tables carved out of the memory block passed to Ice_InitFromArena: the
+ * transaction ID store, its slots, local candidates, remote candidates,
+ * candidate pairs, TURN servers, request templates, request caches, the
+ * response cache and the credential pool. */
+#define ICE_ARENA_TABLE_COUNT                                      10
+
 /*----------------------------------------------------------------------------*/
 
+static void TagLongTermCredential( const IceContext_t * pContext,
+                                   const IceTurnServer_t * pTurnServer,
+                                   uint8_t * pCredentialTag );
+
+static uint8_t ReadLongTermCredentialCache( IceContext_t * pContext,
+                                            IceTurnServer_t * pTurnServer,
+                                            const uint8_t * pCredentialTag );
+
+static void WriteLongTermCredentialCache( IceContext_t * pContext,
+                                          const IceTurnServer_t * pTurnServer,
+                                          const uint8_t * pCredentialTag );
+
+static IceResult_t FormatLongTermCredential( IceContext_t * pContext,
+                                             IceTurnServer_t * pTurnServer,
+                                             uint16_t * pLongTermPasswordLength );
+
 static IceResult_t CalculateLongTermCredential( IceContext_t * pContext,
                                                 IceTurnServer_t * pTurnServer );
 
+static IceResult_t CalculateMessageIntegrity( IceContext_t * pContext,
+                                              const uint8_t * pStunMessage,
+                                              size_t integrityOffset,
+                                              const uint8_t * pPassword,
+                                              size_t passwordLength,
+                                              uint8_t * pMessageIntegrity,
+                                              uint16_t * pMessageIntegrityLength );
+
+static IceResult_t CalculateFingerprint( IceContext_t * pContext,
+                                         const uint8_t * pStunMessage,
+                                         size_t fingerprintOffset,
+                                         uint32_t * pFingerprint );
+
 static IceHandleStunPacketResult_t UpdateIceServerInfo( IceContext_t * pContext,
                                                         IceCandidate_t * pLocalCandidate,
                                                         IceStunDeserializedPacketInfo_t * pDeserializePacketInfo );
@@ -36,12 +72,187 @@ static IceHandleStunPacketResult_t DeserializeStunPacket( IceContext_t * pContex
                                                           size_t passwordLength,
                                                           IceStunDeserializedPacketInfo_t * pDeserializedPacketInfo );
 
+static uint8_t IsStunRequestTemplateUsable( IceContext_t * pContext,
+                                            const IceStunRequestTemplate_t * pStunRequestTemplate,
+                                            uint8_t isNomination,
+                                            size_t stunMessageBufferLength );
+
+static IceResult_t CreateStunRequestFromTemplate( IceContext_t * pContext,
+                                                  const IceStunRequestTemplate_t * pStunRequestTemplate,
+                                                  const uint8_t * pTransactionId,
+                                                  uint8_t * pStunMessageBuffer,
+                                                  size_t * pStunMessageBufferLength );
+
+static void SaveStunRequestTemplate( IceContext_t * pContext,
+                                     IceStunRequestTemplate_t * pStunRequestTemplate,
+                                     uint8_t isNomination,
+                                     const uint8_t * pStunMessage,
+                                     size_t stunMessageLength );
+
+static IceResult_t SerializeConnectivityCheck( IceContext_t * pContext,
+                                               const IceCandidatePair_t * pIceCandidatePair,
+                                               uint8_t * pTransactionId,
+                                               uint8_t * pStunMessageBuffer,
+                                               size_t * pStunMessageBufferLength );
+
+static size_t GetTurnServerCredentialsLength( const IceTurnServer_t * pTurnServer );
+
+static size_t GetGrownCredentialsOffset( const IceContext_t * pContext,
+                                         const IceTurnServer_t * pTurnServer );
+
+static void CompactCredentialPool( IceContext_t * pContext,
+                                   IceTurnServer_t * pTurnServer );
+
+static IceResponseCacheEntry_t * FindRetransmittedStunBindingRequest( IceContext_t * pContext,
+                                                                      const StunContext_t * pStunCtx,
+                                                                      const IceCandidate_t * pLocalCandidate,
+                                                                      const IceEndpoint_t * pRemoteCandidateEndpoint );
+
+static void SaveStunBindingRequest( IceContext_t * pContext,
+                                    const StunContext_t * pStunCtx,
+                                    const IceStunDeserializedPacketInfo_t * pDeserializePacketInfo,
+                                    const IceCandidate_t * pLocalCandidate,
+                                    const IceEndpoint_t * pRemoteCandidateEndpoint,
+                                    IceCandidatePair_t * pIceCandidatePair );
+
+static IceCandidatePair_t * AddTriggeredCandidatePair( IceContext_t * pContext,
+                                                       const IceCandidate_t * pLocalCandidate,
+                                                       const IceEndpoint_t * pRemoteCandidateEndpoint );
+
 /*----------------------------------------------------------------------------*/
 
-/* Follow https://datatracker.ietf.org/doc/html/rfc5389#section-15.4 to get the
- * long-term credential string. */
-static IceResult_t CalculateLongTermCredential( IceContext_t * pContext,
-                                                IceTurnServer_t * pTurnServer )
+/* TagLongTermCredential - HMAC-SHA1 of the username, realm and password of
+ * the TURN server under the secret of the long-term credential cache, each
+ * field preceded by its length so that the field boundaries count. It keys
+ * the cache, which then holds no plaintext credential. */
+static void TagLongTermCredential( const IceContext_t * pContext,
+                                   const IceTurnServer_t * pTurnServer,
+                                   uint8_t * pCredentialTag )
+{
+    static const IceTurnServerCredential_t fields[] =
+    {
+        ICE_TURN_SERVER_CREDENTIAL_USER_NAME,
+        ICE_TURN_SERVER_CREDENTIAL_REALM,
+        ICE_TURN_SERVER_CREDENTIAL_PASSWORD
+    };
+    const IceLongTermCredentialCache_t * pCache = pContext->pConfig->pLongTermCredentialCache;
+    IceCryptoHmacSha1Context_t hmacContext;
+    uint8_t fieldLength[ 2 ];
+    uint16_t tagLength = ICE_LONG_TERM_CREDENTIAL_CACHE_TAG_LENGTH;
+    size_t i;
+
+    ( void ) IceCrypto_HmacSha1Init( &( hmacContext ),
+                                     &( pCache->secret[ 0 ] ),
+                                     ICE_LONG_TERM_CREDENTIAL_CACHE_SECRET_LENGTH );
+
+    for( i = 0; i < sizeof( fields ) / sizeof( fields[ 0 ] ); i++ )
+    {
+        fieldLength[ 0 ] = ( uint8_t ) ( pTurnServer->credentialLengths[ fields[ i ] ] >> 8 );
+        fieldLength[ 1 ] = ( uint8_t ) pTurnServer->credentialLengths[ fields[ i ] ];
+
+        ( void ) IceCrypto_HmacSha1Update( &( hmacContext ),
+                                           &( fieldLength[ 0 ] ),
+                                           sizeof( fieldLength ) );
+        ( void ) IceCrypto_HmacSha1Update( &( hmacContext ),
+                                           Ice_GetTurnServerCredential( pContext, pTurnServer, fields[ i ] ),
+                                           pTurnServer->credentialLengths[ fields[ i ] ] );
+    }
+
+    ( void ) IceCrypto_HmacSha1Final( &( hmacContext ),
+                                      pCredentialTag,
+                                      &( tagLength ) );
+
+    IceCrypto_Zeroize( &( hmacContext ),
+                       sizeof( hmacContext ) );
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* ReadLongTermCredentialCache - Copy the long-term key of the entry with the
+ * same credential tag to the TURN server. */
+static uint8_t ReadLongTermCredentialCache( IceContext_t * pContext,
+                                            IceTurnServer_t * pTurnServer,
+                                            const uint8_t * pCredentialTag )
+{
+    uint8_t isCached = 0;
+    size_t i;
+    IceLongTermCredentialCache_t * pCache = pContext->pConfig->pLongTermCredentialCache;
+    const IceLongTermCredentialCacheEntry_t * pEntry;
+
+    if( pCache->lockFxn != NULL )
+    {
+        pCache->lockFxn( pCache->pLockContext );
+    }
+
+    for( i = 0; i < pCache->maxEntries; i++ )
+    {
+        pEntry = &( pCache->pEntries[ i ] );
+
+        if( ( pEntry->isUsed != 0 ) &&
+            ( memcmp( &( pEntry->credentialTag[ 0 ] ),
+                      pCredentialTag,
+                      ICE_LONG_TERM_CREDENTIAL_CACHE_TAG_LENGTH ) == 0 ) )
+        {
+            memcpy( &( pTurnServer->longTermPassword[ 0 ] ),
+                    &( pEntry->longTermPassword[ 0 ] ),
+                    ICE_SERVER_CONFIG_LONG_TERM_PASSWORD_LENGTH );
+            isCached = 1;
+            break;
+        }
+    }
+
+    if( pCache->unlockFxn != NULL )
+    {
+        pCache->unlockFxn( pCache->pLockContext );
+    }
+
+    return isCached;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* WriteLongTermCredentialCache - Remember the long-term key of the TURN
+ * server, replacing the entries in round robin order once the cache is
+ * full. The replaced entry is cleared first. */
+static void WriteLongTermCredentialCache( IceContext_t * pContext,
+                                          const IceTurnServer_t * pTurnServer,
+                                          const uint8_t * pCredentialTag )
+{
+    IceLongTermCredentialCache_t * pCache = pContext->pConfig->pLongTermCredentialCache;
+    IceLongTermCredentialCacheEntry_t * pEntry;
+
+    if( pCache->lockFxn != NULL )
+    {
+        pCache->lockFxn( pCache->pLockContext );
+    }
+
+    pEntry = &( pCache->pEntries[ pCache->nextEntry ] );
+    pCache->nextEntry = ( pCache->nextEntry + 1 ) % pCache->maxEntries;
+
+    memset( pEntry,
+            0,
+            sizeof( IceLongTermCredentialCacheEntry_t ) );
+    memcpy( &( pEntry->credentialTag[ 0 ] ),
+            pCredentialTag,
+            ICE_LONG_TERM_CREDENTIAL_CACHE_TAG_LENGTH );
+    memcpy( &( pEntry->longTermPassword[ 0 ] ),
+            &( pTurnServer->longTermPassword[ 0 ] ),
+            ICE_SERVER_CONFIG_LONG_TERM_PASSWORD_LENGTH );
+    pEntry->isUsed = 1;
+
+    if( pCache->unlockFxn != NULL )
+    {
+        pCache->unlockFxn( pCache->pLockContext );
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* FormatLongTermCredential - Format username:realm:password into a buffer
+ * and hash it with the MD5 function of the application. */
+static IceResult_t FormatLongTermCredential( IceContext_t * pContext,
+                                             IceTurnServer_t * pTurnServer,
+                                             uint16_t * pLongTermPasswordLength )
 {
     IceResult_t result = ICE_RESULT_OK;
     const int bufferLength = ICE_SERVER_CONFIG_MAX_USER_NAME_LENGTH +
@@ -50,17 +261,16 @@ static IceResult_t CalculateLongTermCredential( IceContext_t * pContext,
                              2; /* 2 for two ":" between each value. */
     char buffer[ bufferLength ];
     int snprintfRetVal;
-    uint16_t longTermPasswordLength;
 
     snprintfRetVal = snprintf( &( buffer[ 0 ] ),
                                bufferLength,
                                "%.*s:%.*s:%.*s",
-                               ( int ) pTurnServer->userNameLength,
-                               &( pTurnServer->userName[ 0 ] ),
-                               ( int ) pTurnServer->realmLength,
-                               &( pTurnServer->realm[ 0 ] ),
-                               ( int ) pTurnServer->passwordLength,
-                               &( pTurnServer->password[ 0 ] ) );
+                               ( int ) pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_USER_NAME ],
+                               ( const char * ) Ice_GetTurnServerCredential( pContext, pTurnServer, ICE_TURN_SERVER_CREDENTIAL_USER_NAME ),
+                               ( int ) pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_REALM ],
+                               ( const char * ) Ice_GetTurnServerCredential( pContext, pTurnServer, ICE_TURN_SERVER_CREDENTIAL_REALM ),
+                               ( int ) pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_PASSWORD ],
+                               ( const char * ) Ice_GetTurnServerCredential( pContext, pTurnServer, ICE_TURN_SERVER_CREDENTIAL_PASSWORD ) );
 
     /* LCOV_EXCL_START */
     if( snprintfRetVal < 0 )
@@ -72,13 +282,91 @@ static IceResult_t CalculateLongTermCredential( IceContext_t * pContext,
     {
         /* LCOV_EXCL_STOP  */
 
-        longTermPasswordLength = ICE_SERVER_CONFIG_LONG_TERM_PASSWORD_LENGTH;
-        result = pContext->cryptoFunctions.md5Fxn( ( const uint8_t * ) &( buffer[ 0 ] ),
-                                                   snprintfRetVal,
-                                                   &( pTurnServer->longTermPassword[ 0 ] ),
-                                                   &( longTermPasswordLength ) );
+        result = pContext->pConfig->cryptoFunctions.md5Fxn( ( const uint8_t * ) &( buffer[ 0 ] ),
+                                                            snprintfRetVal,
+                                                            &( pTurnServer->longTermPassword[ 0 ] ),
+                                                            pLongTermPasswordLength );
+    }
+
+    /* The buffer holds the plaintext password. */
+    IceCrypto_Zeroize( &( buffer[ 0 ] ),
+                       bufferLength );
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Follow https://datatracker.ietf.org/doc/html/rfc5389#section-15.4 to get the
+ * long-term credential string. */
+static IceResult_t CalculateLongTermCredential( IceContext_t * pContext,
+                                                IceTurnServer_t * pTurnServer )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    uint16_t longTermPasswordLength = ICE_SERVER_CONFIG_LONG_TERM_PASSWORD_LENGTH;
+    uint8_t isCached = 0;
+    uint8_t credentialTag[ ICE_LONG_TERM_CREDENTIAL_CACHE_TAG_LENGTH ];
+    IceCryptoMd5Context_t md5Context;
+
+    if( pContext->pConfig->pLongTermCredentialCache != NULL )
+    {
+        TagLongTermCredential( pContext,
+                               pTurnServer,
+                               &( credentialTag[ 0 ] ) );
+        isCached = ReadLongTermCredentialCache( pContext,
+                                                pTurnServer,
+                                                &( credentialTag[ 0 ] ) );
+    }
+
+    if( ( isCached == 0 ) &&
+        ( pContext->pConfig->cryptoFunctions.md5Fxn == IceCrypto_Md5 ) )
+    {
+        /* The built-in MD5 hashes the fields one after another without
+         * formatting them into a buffer first. */
+        ( void ) IceCrypto_Md5Init( &( md5Context ) );
+        ( void ) IceCrypto_Md5Update( &( md5Context ),
+                                      Ice_GetTurnServerCredential( pContext, pTurnServer, ICE_TURN_SERVER_CREDENTIAL_USER_NAME ),
+                                      pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_USER_NAME ] );
+        ( void ) IceCrypto_Md5Update( &( md5Context ),
+                                      ( const uint8_t * ) ":",
+                                      1 );
+        ( void ) IceCrypto_Md5Update( &( md5Context ),
+                                      Ice_GetTurnServerCredential( pContext, pTurnServer, ICE_TURN_SERVER_CREDENTIAL_REALM ),
+                                      pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_REALM ] );
+        ( void ) IceCrypto_Md5Update( &( md5Context ),
+                                      ( const uint8_t * ) ":",
+                                      1 );
+        ( void ) IceCrypto_Md5Update( &( md5Context ),
+                                      Ice_GetTurnServerCredential( pContext, pTurnServer, ICE_TURN_SERVER_CREDENTIAL_PASSWORD ),
+                                      pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_PASSWORD ] );
+        result = IceCrypto_Md5Final( &( md5Context ),
+                                     &( pTurnServer->longTermPassword[ 0 ] ),
+                                     &( longTermPasswordLength ) );
+
+        /* The block buffer holds username:realm:password. */
+        IceCrypto_Zeroize( &( md5Context ),
+                           sizeof( md5Context ) );
+    }
+    else if( isCached == 0 )
+    {
+        result = FormatLongTermCredential( pContext,
+                                           pTurnServer,
+                                           &( longTermPasswordLength ) );
+    }
+    else
+    {
+        /* The key of another TURN server with the same credentials was copied
+         * from the cache. */
     }
 
+    if( ( result == ICE_RESULT_OK ) &&
+        ( isCached == 0 ) &&
+        ( pContext->pConfig->pLongTermCredentialCache != NULL ) )
+    {
+        WriteLongTermCredentialCache( pContext,
+                                      pTurnServer,
+                                      &( credentialTag[ 0 ] ) );
+    }
 
     if( result == ICE_RESULT_OK )
     {
@@ -110,19 +398,36 @@ static IceHandleStunPacketResult_t UpdateIceServerInfo( IceContext_t * pContext,
     {
         if( pDeserializePacketInfo->nonceLength > 0 )
         {
-            memcpy( &( pLocalCandidate->pTurnServer->nonce[ 0 ] ),
-                    pDeserializePacketInfo->pNonce,
-                    pDeserializePacketInfo->nonceLength );
-            pLocalCandidate->pTurnServer->nonceLength = pDeserializePacketInfo->nonceLength;
+            iceResult = Ice_SetTurnServerCredential( pContext,
+                                                     pLocalCandidate->pTurnServer,
+                                                     ICE_TURN_SERVER_CREDENTIAL_NONCE,
+                                                     pDeserializePacketInfo->pNonce,
+                                                     pDeserializePacketInfo->nonceLength );
+
+            if( iceResult != ICE_RESULT_OK )
+            {
+                handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_CREDENTIAL_POOL_FULL;
+            }
         }
 
-        if( pDeserializePacketInfo->realmLength > 0 )
+        if( ( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK ) &&
+            ( pDeserializePacketInfo->realmLength > 0 ) )
         {
-            memcpy( &( pLocalCandidate->pTurnServer->realm[ 0 ] ),
-                    pDeserializePacketInfo->pRealm,
-                    pDeserializePacketInfo->realmLength );
-            pLocalCandidate->pTurnServer->realmLength = pDeserializePacketInfo->realmLength;
+            iceResult = Ice_SetTurnServerCredential( pContext,
+                                                     pLocalCandidate->pTurnServer,
+                                                     ICE_TURN_SERVER_CREDENTIAL_REALM,
+                                                     pDeserializePacketInfo->pRealm,
+                                                     pDeserializePacketInfo->realmLength );
+
+            if( iceResult != ICE_RESULT_OK )
+            {
+                handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_CREDENTIAL_POOL_FULL;
+            }
+        }
 
+        if( ( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK ) &&
+            ( pDeserializePacketInfo->realmLength > 0 ) )
+        {
             iceResult = CalculateLongTermCredential( pContext,
                                                      pLocalCandidate->pTurnServer );
 
@@ -138,6 +443,125 @@ static IceHandleStunPacketResult_t UpdateIceServerInfo( IceContext_t * pContext,
 
 /*----------------------------------------------------------------------------*/
 
+/* CalculateMessageIntegrity - Compute the MESSAGE-INTEGRITY of a received
+ * message whose MESSAGE-INTEGRITY attribute starts at integrityOffset. The
+ * HMAC covers the message up to that attribute, with the length in the header
+ * set as if the message ended after it. The received message may be read-only
+ * and is not modified, the header is hashed from a copy instead. */
+static IceResult_t CalculateMessageIntegrity( IceContext_t * pContext,
+                                              const uint8_t * pStunMessage,
+                                              size_t integrityOffset,
+                                              const uint8_t * pPassword,
+                                              size_t passwordLength,
+                                              uint8_t * pMessageIntegrity,
+                                              uint16_t * pMessageIntegrityLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    uint16_t messageLength;
+    uint8_t stunHeader[ ICE_STUN_HEADER_LENGTH ];
+    uint8_t integrityCheckBuffer[ ICE_STUN_INTEGRITY_CHECK_MAX_LENGTH ];
+    IceHmacSegments_t hmacSegmentsFxn = pContext->pConfig->cryptoFunctions.hmacSegmentsFxn;
+
+    messageLength = ( uint16_t ) ( integrityOffset + ICE_STUN_INTEGRITY_ATTRIBUTE_LENGTH - ICE_STUN_HEADER_LENGTH );
+
+    if( ( hmacSegmentsFxn == NULL ) &&
+        ( pContext->pConfig->cryptoFunctions.hmacFxn == IceCrypto_HmacSha1 ) )
+    {
+        hmacSegmentsFxn = IceCrypto_HmacSha1Segments;
+    }
+
+    if( hmacSegmentsFxn != NULL )
+    {
+        memcpy( &( stunHeader[ 0 ] ),
+                pStunMessage,
+                ICE_STUN_HEADER_LENGTH );
+        pContext->pConfig->readWriteFunctions.writeUint16Fn( &( stunHeader[ ICE_STUN_HEADER_MESSAGE_LENGTH_OFFSET ] ),
+                                                             messageLength );
+
+        result = hmacSegmentsFxn( pPassword,
+                                  passwordLength,
+                                  &( stunHeader[ 0 ] ),
+                                  ICE_STUN_HEADER_LENGTH,
+                                  &( pStunMessage[ ICE_STUN_HEADER_LENGTH ] ),
+                                  integrityOffset - ICE_STUN_HEADER_LENGTH,
+                                  pMessageIntegrity,
+                                  pMessageIntegrityLength );
+    }
+    else if( pContext->pConfig->readWriteFunctions.readUint16Fn( &( pStunMessage[ ICE_STUN_HEADER_MESSAGE_LENGTH_OFFSET ] ) ) == messageLength )
+    {
+        /* MESSAGE-INTEGRITY is the last attribute, the header is already
+         * right. */
+        result = pContext->pConfig->cryptoFunctions.hmacFxn( pPassword,
+                                                             passwordLength,
+                                                             pStunMessage,
+                                                             integrityOffset,
+                                                             pMessageIntegrity,
+                                                             pMessageIntegrityLength );
+    }
+    else if( integrityOffset <= ICE_STUN_INTEGRITY_CHECK_MAX_LENGTH )
+    {
+        /* The HMAC function of the application needs the data in one
+         * buffer. */
+        memcpy( &( integrityCheckBuffer[ 0 ] ),
+                pStunMessage,
+                integrityOffset );
+        pContext->pConfig->readWriteFunctions.writeUint16Fn( &( integrityCheckBuffer[ ICE_STUN_HEADER_MESSAGE_LENGTH_OFFSET ] ),
+                                                             messageLength );
+
+        result = pContext->pConfig->cryptoFunctions.hmacFxn( pPassword,
+                                                             passwordLength,
+                                                             &( integrityCheckBuffer[ 0 ] ),
+                                                             integrityOffset,
+                                                             pMessageIntegrity,
+                                                             pMessageIntegrityLength );
+    }
+    else
+    {
+        result = ICE_RESULT_OUT_OF_MEMORY;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* CalculateFingerprint - Compute the CRC32 of a received message whose
+ * FINGERPRINT attribute starts at fingerprintOffset, with the length in the
+ * header set as if the message ended after it. The header is hashed from a
+ * copy and the CRC32 is continued over the rest of the message. */
+static IceResult_t CalculateFingerprint( IceContext_t * pContext,
+                                         const uint8_t * pStunMessage,
+                                         size_t fingerprintOffset,
+                                         uint32_t * pFingerprint )
+{
+    IceResult_t result;
+    uint8_t stunHeader[ ICE_STUN_HEADER_LENGTH ];
+    uint32_t crc32;
+
+    memcpy( &( stunHeader[ 0 ] ),
+            pStunMessage,
+            ICE_STUN_HEADER_LENGTH );
+    pContext->pConfig->readWriteFunctions.writeUint16Fn( &( stunHeader[ ICE_STUN_HEADER_MESSAGE_LENGTH_OFFSET ] ),
+                                                         ( uint16_t ) ( fingerprintOffset + ICE_STUN_FINGERPRINT_ATTRIBUTE_LENGTH - ICE_STUN_HEADER_LENGTH ) );
+
+    result = pContext->pConfig->cryptoFunctions.crc32Fxn( 0,
+                                                          &( stunHeader[ 0 ] ),
+                                                          ICE_STUN_HEADER_LENGTH,
+                                                          &( crc32 ) );
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = pContext->pConfig->cryptoFunctions.crc32Fxn( crc32,
+                                                              &( pStunMessage[ ICE_STUN_HEADER_LENGTH ] ),
+                                                              fingerprintOffset - ICE_STUN_HEADER_LENGTH,
+                                                              pFingerprint );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
 /* DeserializeStunPacket - This API deserializes a received STUN packet. */
 static IceHandleStunPacketResult_t DeserializeStunPacket( IceContext_t * pContext,
                                                           StunContext_t * pStunCtx,
@@ -151,12 +575,8 @@ static IceHandleStunPacketResult_t DeserializeStunPacket( IceContext_t * pContex
     StunAttribute_t stunAttribute;
     uint8_t * pErrorPhase = NULL;
     uint16_t errorPhaseLength = 0;
-    uint8_t * pIntegrityCalculationData = NULL;
-    uint16_t integrityCalculationDataLength = 0;
     uint8_t messageIntegrity[ STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH ];
     uint16_t messageIntegrityLength = STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH;
-    uint8_t * pFingerprintCalculationData = NULL;
-    uint16_t fingerprintCalculationDataLength = 0;
     uint32_t fingerprint;
     uint32_t computedFingerprint;
 
@@ -216,27 +636,25 @@ static IceHandleStunPacketResult_t DeserializeStunPacket( IceContext_t * pContex
                 {
                     if( ( pPassword != NULL ) && ( passwordLength != 0 ) )
                     {
-                        stunResult = StunDeserializer_GetIntegrityBuffer( pStunCtx,
-                                                                          &( pIntegrityCalculationData ),
-                                                                          &( integrityCalculationDataLength ) );
+                        iceResult = CalculateMessageIntegrity( pContext,
+                                                               pStunCtx->pStart,
+                                                               ( size_t ) ( stunAttribute.pAttributeValue - pStunCtx->pStart ) - ICE_STUN_ATTRIBUTE_HEADER_LENGTH,
+                                                               pPassword,
+                                                               passwordLength,
+                                                               &( messageIntegrity[ 0 ] ),
+                                                               &( messageIntegrityLength ) );
 
-                        if( stunResult == STUN_RESULT_OK )
+                        if( ( iceResult != ICE_RESULT_OK ) ||
+                            ( messageIntegrityLength != STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH ) ||
+                            ( memcmp( &( messageIntegrity[ 0 ] ),
+                                      stunAttribute.pAttributeValue,
+                                      stunAttribute.attributeValueLength ) != 0 ) )
+                        {
+                            result = ICE_HANDLE_STUN_PACKET_RESULT_INTEGRITY_MISMATCH;
+                        }
+                        else
                         {
-                            iceResult = pContext->cryptoFunctions.hmacFxn( pPassword,
-                                                                           passwordLength,
-                                                                           pIntegrityCalculationData,
-                                                                           ( size_t ) integrityCalculationDataLength,
-                                                                           &( messageIntegrity[ 0 ] ),
-                                                                           &( messageIntegrityLength ) );
-
-                            if( ( iceResult != ICE_RESULT_OK ) ||
-                                ( messageIntegrityLength != STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH ) ||
-                                ( memcmp( &( messageIntegrity[ 0 ] ),
-                                          stunAttribute.pAttributeValue,
-                                          stunAttribute.attributeValueLength ) != 0 ) )
-                            {
-                                result = ICE_HANDLE_STUN_PACKET_RESULT_INTEGRITY_MISMATCH;
-                            }
+                            pDeserializedPacketInfo->pMessageIntegrity = stunAttribute.pAttributeValue;
                         }
                     }
                     else
@@ -254,17 +672,10 @@ static IceHandleStunPacketResult_t DeserializeStunPacket( IceContext_t * pContex
 
                     if( stunResult == STUN_RESULT_OK )
                     {
-                        stunResult = StunDeserializer_GetFingerprintBuffer( pStunCtx,
-                                                                            &( pFingerprintCalculationData ),
-                                                                            &( fingerprintCalculationDataLength ) );
-                    }
-
-                    if( stunResult == STUN_RESULT_OK )
-                    {
-                        iceResult = pContext->cryptoFunctions.crc32Fxn( 0,
-                                                                        pFingerprintCalculationData,
-                                                                        ( size_t ) fingerprintCalculationDataLength,
-                                                                        &( computedFingerprint ) );
+                        iceResult = CalculateFingerprint( pContext,
+                                                          pStunCtx->pStart,
+                                                          ( size_t ) ( stunAttribute.pAttributeValue - pStunCtx->pStart ) - ICE_STUN_ATTRIBUTE_HEADER_LENGTH,
+                                                          &( computedFingerprint ) );
 
                         if( ( iceResult != ICE_RESULT_OK ) ||
                             ( fingerprint != computedFingerprint ) )
@@ -371,7 +782,12 @@ IceResult_t Ice_AddCandidatePair( IceContext_t * pContext,
     IceResult_t result = ICE_RESULT_OK;
     uint64_t candidatePairPriority;
     size_t i, candidatePairIndex;
+    size_t victimIndex = 0;
+    uint8_t hasVictim = 0;
     uint8_t transactionId[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+    uint16_t turnChannelNumber = 0;
+    IceStunRequestTemplate_t * pStunRequestTemplate = NULL;
+    IceRequestCache_t * pRequestCache = NULL;
 
     if( ( pContext == NULL ) ||
         ( pLocalCandidate == NULL ) ||
@@ -382,35 +798,92 @@ IceResult_t Ice_AddCandidatePair( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
+        candidatePairPriority = Ice_ComputeCandidatePairPriority( pLocalCandidate->priority,
+                                                                  pRemoteCandidate->priority,
+                                                                  pContext->isControlling );
+
         if( pContext->numCandidatePairs == pContext->maxCandidatePairs )
         {
-            result = ICE_RESULT_MAX_CANDIDATE_PAIR_THRESHOLD;
+            /* Reclaim the slot of the lowest priority closed candidate pair,
+             * if there is one. The victim is only removed once nothing else
+             * can fail. */
+            for( i = pContext->numCandidatePairs; i > 0; i-- )
+            {
+                if( ICE_CANDIDATE_PAIR_IS_CLOSED( &( pContext->pCandidatePairs[ i - 1 ] ) ) )
+                {
+                    victimIndex = i - 1;
+                    hasVictim = 1;
+                    break;
+                }
+            }
+
+            /* Otherwise, evict the lowest priority candidate pair still
+             * waiting for its connectivity check if the new candidate pair
+             * beats it. The array is sorted by priority, so it is the last
+             * waiting one. */
+            if( i == 0 )
+            {
+                for( i = pContext->numCandidatePairs; i > 0; i-- )
+                {
+                    if( pContext->pCandidatePairs[ i - 1 ].state == ICE_CANDIDATE_PAIR_STATE_WAITING )
+                    {
+                        break;
+                    }
+                }
+
+                if( ( i > 0 ) &&
+                    ( pContext->pCandidatePairs[ i - 1 ].priority < candidatePairPriority ) )
+                {
+                    victimIndex = i - 1;
+                    hasVictim = 1;
+                }
+                else
+                {
+                    result = ICE_RESULT_MAX_CANDIDATE_PAIR_THRESHOLD;
+                }
+            }
         }
     }
 
     if( result == ICE_RESULT_OK )
     {
-        if( ( pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY ) &&
-            ( pLocalCandidate->pTurnServer->nextAvailableTurnChannelNumber > ICE_DEFAULT_TURN_CHANNEL_NUMBER_MAX ) )
+        result = Ice_GenerateRandom( pContext,
+                                     &( transactionId[ 0 ] ),
+                                     STUN_HEADER_TRANSACTION_ID_LENGTH );
+    }
+
+    if( ( result == ICE_RESULT_OK ) &&
+        ( pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY ) )
+    {
+        turnChannelNumber = Ice_AllocateTurnChannelNumber( pLocalCandidate->pTurnServer );
+
+        if( turnChannelNumber == 0 )
         {
             result = ICE_RESULT_MAX_CHANNEL_NUMBER_THRESHOLD;
         }
     }
 
-    if( result == ICE_RESULT_OK )
+    if( ( result == ICE_RESULT_OK ) &&
+        ( hasVictim != 0 ) )
     {
-        result = pContext->cryptoFunctions.randomFxn( &( transactionId[ 0 ] ),
-                                                      STUN_HEADER_TRANSACTION_ID_LENGTH );
+        Ice_RemoveCandidatePair( pContext,
+                                 victimIndex );
     }
 
     if( result == ICE_RESULT_OK )
     {
-        candidatePairPriority = Ice_ComputeCandidatePairPriority( pLocalCandidate->priority,
-                                                                  pRemoteCandidate->priority,
-                                                                  pContext->isControlling );
-
         candidatePairIndex = pContext->numCandidatePairs;
 
+        /* The slot past the end keeps the request template and the request
+         * cache of a removed candidate pair. Take them over before the slot is
+         * overwritten by the move below. A slot never used is not
+         * initialized. */
+        if( candidatePairIndex < pContext->candidatePairsHighWaterMark )
+        {
+            pStunRequestTemplate = pContext->pCandidatePairs[ candidatePairIndex ].pStunRequestTemplate;
+            pRequestCache = pContext->pCandidatePairs[ candidatePairIndex ].pRequestCache;
+        }
+
         /* ICE Candidate pairs are sorted by priority. Find the correct location
          * of the new candidate pair in the candidate pair array. */
         for( i = 0; i < pContext->numCandidatePairs; i++ )
@@ -429,25 +902,73 @@ IceResult_t Ice_AddCandidatePair( IceContext_t * pContext,
             pContext->pCandidatePairs[ i ] = pContext->pCandidatePairs[ i - 1 ];
         }
 
+        if( ( pContext->pNominatedPair != NULL ) &&
+            ( pContext->pNominatedPair >= &( pContext->pCandidatePairs[ candidatePairIndex ] ) ) )
+        {
+            pContext->pNominatedPair += 1;
+        }
+
+        /* Cached responses refer to candidate pairs by address. */
+        if( candidatePairIndex < pContext->numCandidatePairs )
+        {
+            Ice_ClearResponseCache( pContext );
+        }
+
+        /* Restart an ongoing compaction pass. */
+        pContext->compactionReadIndex = 0;
+        pContext->compactionWriteIndex = 0;
+
         /* Insert the candidate pair at candidatePairIndex. */
         if( pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY )
         {
             pContext->pCandidatePairs[ candidatePairIndex ].state = ICE_CANDIDATE_PAIR_STATE_CREATE_PERMISSION;
-            pContext->pCandidatePairs[ candidatePairIndex ].turnChannelNumber = pLocalCandidate->pTurnServer->nextAvailableTurnChannelNumber;
-            pLocalCandidate->pTurnServer->nextAvailableTurnChannelNumber++;
+            pContext->pCandidatePairs[ candidatePairIndex ].turnChannelNumber = turnChannelNumber;
         }
         else
         {
             pContext->pCandidatePairs[ candidatePairIndex ].state = ICE_CANDIDATE_PAIR_STATE_WAITING;
+            pContext->pCandidatePairs[ candidatePairIndex ].turnChannelNumber = 0;
         }
         pContext->pCandidatePairs[ candidatePairIndex ].pLocalCandidate = pLocalCandidate;
         pContext->pCandidatePairs[ candidatePairIndex ].pRemoteCandidate = pRemoteCandidate;
         pContext->pCandidatePairs[ candidatePairIndex ].priority = candidatePairPriority;
-        pContext->pCandidatePairs[ candidatePairIndex ].connectivityCheckFlags = 0;
+        pContext->pCandidatePairs[ candidatePairIndex ].flags = 0;
+        pContext->pCandidatePairs[ candidatePairIndex ].turnPermissionExpirationSeconds = 0;
         memcpy( &( pContext->pCandidatePairs[ candidatePairIndex ].transactionId[ 0 ] ),
                 &( transactionId[ 0 ] ),
                 STUN_HEADER_TRANSACTION_ID_LENGTH );
+
+        if( pRequestCache != NULL )
+        {
+            Ice_InvalidateRequestCache( pRequestCache );
+        }
+        else
+        {
+            pRequestCache = Ice_AllocateRequestCache( pContext );
+        }
+        pContext->pCandidatePairs[ candidatePairIndex ].pRequestCache = pRequestCache;
+
+        /* Assign a request template if the application provided storage for
+         * them. */
+        if( ( pStunRequestTemplate == NULL ) &&
+            ( pContext->numStunRequestTemplates < pContext->maxStunRequestTemplates ) )
+        {
+            pStunRequestTemplate = &( pContext->pStunRequestTemplates[ pContext->numStunRequestTemplates ] );
+            pContext->numStunRequestTemplates += 1;
+        }
+
+        if( pStunRequestTemplate != NULL )
+        {
+            pStunRequestTemplate->messageLength = 0;
+        }
+        pContext->pCandidatePairs[ candidatePairIndex ].pStunRequestTemplate = pStunRequestTemplate;
+
         pContext->numCandidatePairs += 1;
+
+        if( pContext->numCandidatePairs > pContext->candidatePairsHighWaterMark )
+        {
+            pContext->candidatePairsHighWaterMark = pContext->numCandidatePairs;
+        }
     }
 
     return result;
@@ -455,87 +976,1371 @@ IceResult_t Ice_AddCandidatePair( IceContext_t * pContext,
 
 /*----------------------------------------------------------------------------*/
 
-/* Ice_ComputeCandidatePriority - Compute the candidate priority.
+/* Ice_RemoveCandidatePair - Remove the candidate pair at the given index and
+ * move the following ones down to keep the array sorted by priority. The
+ * request template and the request cache of the removed candidate pair are
+ * left in the slot past the end for the next candidate pair added.
  */
-uint32_t Ice_ComputeCandidatePriority( IceCandidateType_t candidateType,
-                                       uint8_t isPointToPoint )
+void Ice_RemoveCandidatePair( IceContext_t * pContext,
+                              size_t candidatePairIndex )
 {
-    uint32_t typePreference = 0;
-    uint32_t localPreference = 0;
-    uint32_t candidatePriority = 0;
-
-    switch( candidateType )
-    {
-        case ICE_CANDIDATE_TYPE_HOST:
-            typePreference = ICE_PRIORITY_HOST_CANDIDATE_TYPE_PREFERENCE;
-            break;
-
-        case ICE_CANDIDATE_TYPE_SERVER_REFLEXIVE:
-            typePreference = ICE_PRIORITY_SERVER_REFLEXIVE_CANDIDATE_TYPE_PREFERENCE;
-            break;
-
-        case ICE_CANDIDATE_TYPE_PEER_REFLEXIVE:
-            typePreference = ICE_PRIORITY_PEER_REFLEXIVE_CANDIDATE_TYPE_PREFERENCE;
-            break;
+    size_t i;
+    IceStunRequestTemplate_t * pStunRequestTemplate = pContext->pCandidatePairs[ candidatePairIndex ].pStunRequestTemplate;
+    IceRequestCache_t * pRequestCache = pContext->pCandidatePairs[ candidatePairIndex ].pRequestCache;
 
-        case ICE_CANDIDATE_TYPE_RELAY:
-            typePreference = ICE_PRIORITY_RELAY_CANDIDATE_TYPE_PREFERENCE;
-            break;
+    Ice_ReleaseTurnChannelNumber( &( pContext->pCandidatePairs[ candidatePairIndex ] ) );
 
-        default:
-            break;
+    for( i = candidatePairIndex + 1; i < pContext->numCandidatePairs; i++ )
+    {
+        pContext->pCandidatePairs[ i - 1 ] = pContext->pCandidatePairs[ i ];
     }
 
-    if( isPointToPoint == 0 )
+    /* Follow the nominated candidate pair if it moved. */
+    if( pContext->pNominatedPair == &( pContext->pCandidatePairs[ candidatePairIndex ] ) )
     {
-        localPreference = ICE_PRIORITY_LOCAL_PREFERENCE;
+        pContext->pNominatedPair = NULL;
+    }
+    else if( pContext->pNominatedPair > &( pContext->pCandidatePairs[ candidatePairIndex ] ) )
+    {
+        pContext->pNominatedPair -= 1;
+    }
+    else
+    {
+        /* The nominated candidate pair, if any, did not move. */
     }
 
-    /* Reference: https://tools.ietf.org/html/rfc5245#section-4.1.2.1
-     * priority = (2^24)*(type preference) +
-     *   (2^8)*(local preference) +
-     *   (2^0)*(256 - component ID)
-     *
-     * Since type preference <= 126 and local preference <= 65535, the maximum possible
-     * priority is (2^24) * (126) + (2^8) * (65535) + 255 = 2130706431. So, it's safe
-     * to use UINT32 since 2130706431 < 2 ^ 32. */
-    candidatePriority = ( ( 1 << 24 ) * ( typePreference ) + ( 1 << 8 ) * ( localPreference ) + 255 );
+    pContext->numCandidatePairs -= 1;
 
-    return candidatePriority;
+    pContext->pCandidatePairs[ pContext->numCandidatePairs ].pStunRequestTemplate = pStunRequestTemplate;
+    pContext->pCandidatePairs[ pContext->numCandidatePairs ].pRequestCache = pRequestCache;
+    Ice_ClearCandidatePair( &( pContext->pCandidatePairs[ pContext->numCandidatePairs ] ) );
+
+    /* Cached responses refer to candidate pairs by address. */
+    Ice_ClearResponseCache( pContext );
+
+    /* Restart an ongoing compaction pass. */
+    pContext->compactionReadIndex = 0;
+    pContext->compactionWriteIndex = 0;
 }
 
 /*----------------------------------------------------------------------------*/
 
-/* Ice_ComputeCandidatePairPriority - Compute the candidate pair priority. */
-
-uint64_t Ice_ComputeCandidatePairPriority( uint32_t localCandidatePriority,
-                                           uint32_t remoteCandidatePriority,
-                                           uint32_t isControlling )
+/* Ice_ClearCandidatePair - Clear a candidate pair slot past the end of the
+ * candidate pair array but keep its request template and request cache for
+ * the next candidate pair added in the slot.
+ */
+void Ice_ClearCandidatePair( IceCandidatePair_t * pIceCandidatePair )
 {
-    uint64_t controllingAgentCandidatePriority;
-    uint64_t controlledAgentCandidatePriority;
-    uint64_t candidatePairPriority = 0;
+    IceStunRequestTemplate_t * pStunRequestTemplate = pIceCandidatePair->pStunRequestTemplate;
+    IceRequestCache_t * pRequestCache = pIceCandidatePair->pRequestCache;
 
-    if( isControlling == 0 )
-    {
-        controllingAgentCandidatePriority = remoteCandidatePriority;
-        controlledAgentCandidatePriority = localCandidatePriority;
-    }
+    memset( pIceCandidatePair,
+            0,
+            sizeof( IceCandidatePair_t ) );
+    pIceCandidatePair->pStunRequestTemplate = pStunRequestTemplate;
+    pIceCandidatePair->pRequestCache = pRequestCache;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_GetFreeCandidate - Return the slot for the next local or remote
+ * candidate without consuming it: the first slot on the free list or else the
+ * first slot never used, cleared. Returns NULL if the array is full.
+ */
+IceCandidate_t * Ice_GetFreeCandidate( IceContext_t * pContext,
+                                       uint8_t isRemote )
+{
+    IceCandidate_t * pFreeCandidate = NULL;
+    IceCandidate_t * pCandidates = pContext->pLocalCandidates;
+    size_t maxCandidates = pContext->maxLocalCandidates;
+    size_t numCandidates = pContext->numLocalCandidates;
+    size_t freeList = pContext->localCandidatesFreeList;
+
+    if( isRemote != 0 )
+    {
+        pCandidates = pContext->pRemoteCandidates;
+        maxCandidates = pContext->maxRemoteCandidates;
+        numCandidates = pContext->numRemoteCandidates;
+        freeList = pContext->remoteCandidatesFreeList;
+    }
+
+    if( freeList != 0 )
+    {
+        pFreeCandidate = &( pCandidates[ freeList - 1 ] );
+    }
+    else if( numCandidates < maxCandidates )
+    {
+        /* Slots are not cleared by Ice_Init. */
+        pFreeCandidate = &( pCandidates[ numCandidates ] );
+        memset( pFreeCandidate,
+                0,
+                sizeof( IceCandidate_t ) );
+    }
+    else
+    {
+        /* The array is full. */
+    }
+
+    return pFreeCandidate;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_ConsumeCandidate - Consume the slot returned by Ice_GetFreeCandidate.
+ */
+void Ice_ConsumeCandidate( IceContext_t * pContext,
+                           IceCandidate_t * pCandidate,
+                           uint8_t isRemote )
+{
+    size_t * pNumCandidates = &( pContext->numLocalCandidates );
+    size_t * pFreeList = &( pContext->localCandidatesFreeList );
+
+    if( isRemote != 0 )
+    {
+        pNumCandidates = &( pContext->numRemoteCandidates );
+        pFreeList = &( pContext->remoteCandidatesFreeList );
+    }
+
+    if( *pFreeList != 0 )
+    {
+        *pFreeList = pCandidate->nextFreeCandidate;
+    }
+    else
+    {
+        *pNumCandidates += 1;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_ReleaseCandidate - Invalidate the candidate, close its candidate pairs
+ * so that they are not mistaken for the ones of the next candidate in the same
+ * slot and put the slot on the free list. The slot keeps its TURN server and
+ * request cache for reuse.
+ */
+void Ice_ReleaseCandidate( IceContext_t * pContext,
+                           IceCandidate_t * pCandidate )
+{
+    size_t i;
+    IceCandidate_t * pCandidates = pContext->pLocalCandidates;
+    size_t * pFreeList = &( pContext->localCandidatesFreeList );
+
+    if( pCandidate->isRemote != 0 )
+    {
+        pCandidates = pContext->pRemoteCandidates;
+        pFreeList = &( pContext->remoteCandidatesFreeList );
+    }
+
+    for( i = 0; i < pContext->numCandidatePairs; i++ )
+    {
+        if( pContext->pCandidatePairs[ i ].pLocalCandidate == pCandidate )
+        {
+            /* The channel numbers go away with the allocation. */
+            pContext->pCandidatePairs[ i ].state = ICE_CANDIDATE_PAIR_STATE_INVALID;
+            pContext->pCandidatePairs[ i ].turnChannelNumber = 0;
+            Ice_MoveResponseCacheEntries( pContext,
+                                          &( pContext->pCandidatePairs[ i ] ),
+                                          NULL );
+        }
+        else if( pContext->pCandidatePairs[ i ].pRemoteCandidate == pCandidate )
+        {
+            pContext->pCandidatePairs[ i ].state = ICE_CANDIDATE_PAIR_STATE_INVALID;
+            Ice_ReleaseTurnChannelNumber( &( pContext->pCandidatePairs[ i ] ) );
+            Ice_MoveResponseCacheEntries( pContext,
+                                          &( pContext->pCandidatePairs[ i ] ),
+                                          NULL );
+        }
+        else
+        {
+            /* Candidate pair of other candidates. */
+        }
+    }
+
+    Ice_RemoveLazyCandidate( pContext,
+                             pCandidate );
+    pCandidate->state = ICE_CANDIDATE_STATE_INVALID;
+
+    /* Ice_Init bounds the candidate arrays so that the slot index fits. */
+    pCandidate->nextFreeCandidate = ( uint16_t ) *pFreeList;
+    *pFreeList = ( size_t ) ( pCandidate - pCandidates ) + 1;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_AllocateTurnChannelNumber - Take the first free channel number of the
+ * TURN server at or after nextAvailableTurnChannelNumber, wrapping around, so
+ * that a released channel number is not bound to another peer again right
+ * away. Returns 0 if all the channel numbers are in use.
+ */
+uint16_t Ice_AllocateTurnChannelNumber( IceTurnServer_t * pTurnServer )
+{
+    uint16_t turnChannelNumber = 0;
+    size_t i, wordIndex, startIndex, channelIndex;
+    uint64_t freeBits;
+
+    startIndex = 0;
+    if( ( pTurnServer->nextAvailableTurnChannelNumber >= ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN ) &&
+        ( pTurnServer->nextAvailableTurnChannelNumber <= ICE_TURN_CHANNEL_NUMBER_LAST ) )
+    {
+        startIndex = pTurnServer->nextAvailableTurnChannelNumber - ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN;
+    }
+
+    /* The word of startIndex is visited twice, first from startIndex and
+     * after wrapping around, below it. */
+    for( i = 0; i <= ICE_TURN_CHANNEL_NUMBER_BITMAP_WORDS; i++ )
+    {
+        wordIndex = ( ( startIndex / 64 ) + i ) % ICE_TURN_CHANNEL_NUMBER_BITMAP_WORDS;
+        freeBits = ~( pTurnServer->turnChannelNumbersInUse[ wordIndex ] );
+
+        if( i == 0 )
+        {
+            freeBits &= ~( ( uint64_t ) 0 ) << ( startIndex % 64 );
+        }
+
+        if( freeBits != 0 )
+        {
+            channelIndex = ( wordIndex * 64 ) + Ice_CountTrailingZeros( freeBits );
+            pTurnServer->turnChannelNumbersInUse[ wordIndex ] |= ( ( uint64_t ) 1 ) << ( channelIndex % 64 );
+            turnChannelNumber = ( uint16_t ) ( ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN + channelIndex );
+            pTurnServer->nextAvailableTurnChannelNumber = turnChannelNumber + 1;
+            break;
+        }
+    }
+
+    return turnChannelNumber;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_ReleaseTurnChannelNumber - Give the channel number of a relay candidate
+ * pair back to its TURN server.
+ */
+void Ice_ReleaseTurnChannelNumber( IceCandidatePair_t * pIceCandidatePair )
+{
+    size_t index;
+    IceTurnServer_t * pTurnServer;
+
+    if( ( pIceCandidatePair->turnChannelNumber >= ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN ) &&
+        ( pIceCandidatePair->turnChannelNumber <= ICE_TURN_CHANNEL_NUMBER_LAST ) &&
+        ( pIceCandidatePair->pLocalCandidate != NULL ) &&
+        ( pIceCandidatePair->pLocalCandidate->pTurnServer != NULL ) )
+    {
+        pTurnServer = pIceCandidatePair->pLocalCandidate->pTurnServer;
+        index = pIceCandidatePair->turnChannelNumber - ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN;
+        pTurnServer->turnChannelNumbersInUse[ index / 64 ] &= ~( ( ( uint64_t ) 1 ) << ( index % 64 ) );
+    }
+
+    pIceCandidatePair->turnChannelNumber = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_CountTrailingZeros - Number of trailing zero bits of a non-zero value.
+ */
+uint32_t Ice_CountTrailingZeros( uint64_t value )
+{
+    uint32_t count;
+
+    #if defined( __GNUC__ )
+        count = ( uint32_t ) __builtin_ctzll( value );
+    #else
+        for( count = 0; ( value & 1 ) == 0; count++ )
+        {
+            value >>= 1;
+        }
+    #endif
+
+    return count;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_GetLazyCandidate - Get the local or remote candidate of a link of the
+ * lazy candidate pair lists, NULL for link 0.
+ */
+IceCandidate_t * Ice_GetLazyCandidate( const IceContext_t * pContext,
+                                       uint8_t isRemote,
+                                       size_t link )
+{
+    IceCandidate_t * pCandidate = NULL;
+
+    if( link != 0 )
+    {
+        pCandidate = ( isRemote == 0 ) ? &( pContext->pLocalCandidates[ link - 1 ] ) :
+                     &( pContext->pRemoteCandidates[ link - 1 ] );
+    }
+
+    return pCandidate;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_IsBeforeLazyFrontier - Check whether the candidate comes before the last
+ * candidate visited by Ice_AddNextCandidatePair, i.e. it has a higher priority
+ * or the same priority and it is a local candidate while the last one visited
+ * is a remote one.
+ */
+uint8_t Ice_IsBeforeLazyFrontier( const IceContext_t * pContext,
+                                  const IceCandidate_t * pCandidate )
+{
+    uint8_t isBefore = 0;
+
+    if( ( pCandidate->priority > pContext->lazyFrontierPriority ) ||
+        ( ( pCandidate->priority == pContext->lazyFrontierPriority ) &&
+          ( pCandidate->isRemote == 0 ) &&
+          ( pContext->lazyFrontierIsRemote != 0 ) ) )
+    {
+        isBefore = 1;
+    }
+
+    return isBefore;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_InsertLazyCandidate - Insert a candidate in the lazy candidate pair list
+ * of its side, after the candidates of higher or equal priority. Returns 1 if
+ * Ice_AddNextCandidatePair already went past it, in which case its
+ * combinations with the candidates visited so far must be paired right away.
+ * *pIsPairedWithCurrent is then 0 if the candidate being paired has still to
+ * get to it. A candidate already in the list is left alone and 0 is returned.
+ */
+uint8_t Ice_InsertLazyCandidate( IceContext_t * pContext,
+                                 IceCandidate_t * pCandidate,
+                                 uint8_t * pIsPairedWithCurrent )
+{
+    IceCandidate_t * pCandidates = pContext->pLocalCandidates;
+    size_t * pHead = &( pContext->localCandidatesByPriority );
+    size_t * pNextToVisit = &( pContext->lazyNextLocalCandidate );
+    size_t link, previousLink = 0, currentLink;
+    uint8_t isVisited, isPartnerBefore = 0;
+
+    if( pCandidate->isRemote != 0 )
+    {
+        pCandidates = pContext->pRemoteCandidates;
+        pHead = &( pContext->remoteCandidatesByPriority );
+        pNextToVisit = &( pContext->lazyNextRemoteCandidate );
+    }
+
+    link = ( size_t ) ( pCandidate - pCandidates ) + 1;
+    isVisited = Ice_IsBeforeLazyFrontier( pContext,
+                                          pCandidate );
+    *pIsPairedWithCurrent = 1;
+
+    /* A candidate already in the list has the same priority as before, so
+     * the walk stops on it. */
+    currentLink = *pHead;
+
+    while( ( currentLink != 0 ) &&
+           ( currentLink != link ) &&
+           ( pCandidates[ currentLink - 1 ].priority >= pCandidate->priority ) )
+    {
+        if( currentLink == pContext->lazyPartner )
+        {
+            isPartnerBefore = 1;
+        }
+
+        previousLink = currentLink;
+        currentLink = pCandidates[ currentLink - 1 ].nextByPriority;
+    }
+
+    if( currentLink == link )
+    {
+        isVisited = 0;
+    }
+    else
+    {
+        pCandidate->nextByPriority = ( uint16_t ) currentLink;
+
+        if( previousLink == 0 )
+        {
+            *pHead = link;
+        }
+        else
+        {
+            pCandidates[ previousLink - 1 ].nextByPriority = ( uint16_t ) link;
+        }
+
+        if( isVisited == 0 )
+        {
+            /* It comes after the frontier, right before the first candidate
+             * not visited yet, or at the end if all of them are visited. */
+            if( *pNextToVisit == currentLink )
+            {
+                *pNextToVisit = link;
+            }
+        }
+        else if( ( pContext->lazyCandidate != 0 ) &&
+                 ( pContext->lazyFrontierIsRemote != pCandidate->isRemote ) )
+        {
+            /* It is a partner of the candidate being paired. Unless the
+             * candidate being paired went past it, it is visited in turn. */
+            if( pContext->lazyPartner == currentLink )
+            {
+                pContext->lazyPartner = link;
+                *pIsPairedWithCurrent = 0;
+            }
+            else if( isPartnerBefore == 1 )
+            {
+                *pIsPairedWithCurrent = 0;
+            }
+            else
+            {
+                /* Gone past it. */
+            }
+        }
+        else
+        {
+            /* Not a partner of the candidate being paired. */
+        }
+    }
+
+    return isVisited;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_RemoveLazyCandidate - Take a candidate out of the lazy candidate pair
+ * list of its side, moving on whatever pointed at it.
+ */
+void Ice_RemoveLazyCandidate( IceContext_t * pContext,
+                              const IceCandidate_t * pCandidate )
+{
+    IceCandidate_t * pCandidates = pContext->pLocalCandidates;
+    size_t * pHead = &( pContext->localCandidatesByPriority );
+    size_t * pNextToVisit = &( pContext->lazyNextLocalCandidate );
+    size_t link, previousLink = 0, currentLink;
+
+    if( pCandidate->isRemote != 0 )
+    {
+        pCandidates = pContext->pRemoteCandidates;
+        pHead = &( pContext->remoteCandidatesByPriority );
+        pNextToVisit = &( pContext->lazyNextRemoteCandidate );
+    }
+
+    link = ( size_t ) ( pCandidate - pCandidates ) + 1;
+    currentLink = *pHead;
+
+    while( ( currentLink != 0 ) &&
+           ( currentLink != link ) )
+    {
+        previousLink = currentLink;
+        currentLink = pCandidates[ currentLink - 1 ].nextByPriority;
+    }
+
+    if( currentLink == link )
+    {
+        if( previousLink == 0 )
+        {
+            *pHead = pCandidate->nextByPriority;
+        }
+        else
+        {
+            pCandidates[ previousLink - 1 ].nextByPriority = pCandidate->nextByPriority;
+        }
+
+        if( *pNextToVisit == link )
+        {
+            *pNextToVisit = pCandidate->nextByPriority;
+        }
+
+        if( pContext->lazyCandidate != 0 )
+        {
+            if( pContext->lazyFrontierIsRemote == pCandidate->isRemote )
+            {
+                if( pContext->lazyCandidate == link )
+                {
+                    /* The frontier stays, the next call moves on to the next
+                     * candidate. */
+                    pContext->lazyCandidate = 0;
+                }
+            }
+            else if( pContext->lazyPartner == link )
+            {
+                pContext->lazyPartner = pCandidate->nextByPriority;
+            }
+            else
+            {
+                /* Not the next partner. */
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_AddCandidatePairIfUsable - Pair a candidate with a candidate of the
+ * other side if the local one is valid and the remote one is not closed.
+ */
+IceResult_t Ice_AddCandidatePairIfUsable( IceContext_t * pContext,
+                                          IceCandidate_t * pCandidate,
+                                          IceCandidate_t * pOtherCandidate )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    IceCandidate_t * pLocalCandidate = pCandidate;
+    IceCandidate_t * pRemoteCandidate = pOtherCandidate;
+
+    if( pCandidate->isRemote != 0 )
+    {
+        pLocalCandidate = pOtherCandidate;
+        pRemoteCandidate = pCandidate;
+    }
+
+    if( ( pLocalCandidate->state == ICE_CANDIDATE_STATE_VALID ) &&
+        ( pRemoteCandidate->state != ICE_CANDIDATE_STATE_INVALID ) )
+    {
+        result = Ice_AddCandidatePair( pContext,
+                                       pLocalCandidate,
+                                       pRemoteCandidate );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_AddCandidatePairs - Pair a new local or remote candidate with all the
+ * usable candidates of the other side. With lazy candidate pairs, the
+ * candidate is inserted in the list of its side instead and only paired with
+ * the candidates Ice_AddNextCandidatePair visited already if it went past the
+ * candidate, the rest are created when Ice_AddNextCandidatePair gets to them.
+ */
+IceResult_t Ice_AddCandidatePairs( IceContext_t * pContext,
+                                   IceCandidate_t * pCandidate )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    size_t i, link, nextToVisit;
+    IceCandidate_t * pOtherCandidates = pContext->pLocalCandidates;
+    size_t numOtherCandidates = pContext->numLocalCandidates;
+    IceCandidate_t * pOtherCandidate;
+    uint8_t isPairedWithCurrent;
+    uint8_t otherIsRemote = ( pCandidate->isRemote == 0 ) ? 1 : 0;
+
+    if( pCandidate->isRemote == 0 )
+    {
+        pOtherCandidates = pContext->pRemoteCandidates;
+        numOtherCandidates = pContext->numRemoteCandidates;
+    }
+
+    if( pContext->lazyCandidatePairs == 0 )
+    {
+        for( i = 0; ( i < numOtherCandidates ) && ( result == ICE_RESULT_OK ); i++ )
+        {
+            result = Ice_AddCandidatePairIfUsable( pContext,
+                                                   pCandidate,
+                                                   &( pOtherCandidates[ i ] ) );
+        }
+    }
+    else if( Ice_InsertLazyCandidate( pContext,
+                                      pCandidate,
+                                      &( isPairedWithCurrent ) ) == 1 )
+    {
+        /* The candidates visited so far are the ones before the first one not
+         * visited yet in the list of the other side. */
+        link = ( otherIsRemote == 0 ) ? pContext->localCandidatesByPriority : pContext->remoteCandidatesByPriority;
+        nextToVisit = ( otherIsRemote == 0 ) ? pContext->lazyNextLocalCandidate : pContext->lazyNextRemoteCandidate;
+
+        while( ( link != nextToVisit ) &&
+               ( result == ICE_RESULT_OK ) )
+        {
+            pOtherCandidate = Ice_GetLazyCandidate( pContext,
+                                                    otherIsRemote,
+                                                    link );
+
+            if( ( link != pContext->lazyCandidate ) ||
+                ( isPairedWithCurrent == 1 ) )
+            {
+                result = Ice_AddCandidatePairIfUsable( pContext,
+                                                       pCandidate,
+                                                       pOtherCandidate );
+            }
+
+            link = pOtherCandidate->nextByPriority;
+        }
+    }
+    else
+    {
+        /* Paired by Ice_AddNextCandidatePair. */
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_FindCandidatePair - Find the candidate pair of the local and remote
+ * candidate. Candidate pairs left behind by a closed candidate are skipped.
+ */
+IceCandidatePair_t * Ice_FindCandidatePair( IceContext_t * pContext,
+                                            const IceCandidate_t * pLocalCandidate,
+                                            const IceCandidate_t * pRemoteCandidate )
+{
+    IceCandidatePair_t * pIceCandidatePair = NULL;
+    size_t i;
+
+    for( i = 0; i < pContext->numCandidatePairs; i++ )
+    {
+        if( ( pContext->pCandidatePairs[ i ].state != ICE_CANDIDATE_PAIR_STATE_INVALID ) &&
+            ( pContext->pCandidatePairs[ i ].pLocalCandidate == pLocalCandidate ) &&
+            ( pContext->pCandidatePairs[ i ].pRemoteCandidate == pRemoteCandidate ) )
+        {
+            pIceCandidatePair = &( pContext->pCandidatePairs[ i ] );
+            break;
+        }
+    }
+
+    return pIceCandidatePair;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_ComputeCandidatePriority - Compute the candidate priority.
+ */
+uint32_t Ice_ComputeCandidatePriority( IceCandidateType_t candidateType,
+                                       uint8_t isPointToPoint )
+{
+    uint32_t typePreference = 0;
+    uint32_t localPreference = 0;
+    uint32_t candidatePriority = 0;
+
+    switch( candidateType )
+    {
+        case ICE_CANDIDATE_TYPE_HOST:
+            typePreference = ICE_PRIORITY_HOST_CANDIDATE_TYPE_PREFERENCE;
+            break;
+
+        case ICE_CANDIDATE_TYPE_SERVER_REFLEXIVE:
+            typePreference = ICE_PRIORITY_SERVER_REFLEXIVE_CANDIDATE_TYPE_PREFERENCE;
+            break;
+
+        case ICE_CANDIDATE_TYPE_PEER_REFLEXIVE:
+            typePreference = ICE_PRIORITY_PEER_REFLEXIVE_CANDIDATE_TYPE_PREFERENCE;
+            break;
+
+        case ICE_CANDIDATE_TYPE_RELAY:
+            typePreference = ICE_PRIORITY_RELAY_CANDIDATE_TYPE_PREFERENCE;
+            break;
+
+        default:
+            break;
+    }
+
+    if( isPointToPoint == 0 )
+    {
+        localPreference = ICE_PRIORITY_LOCAL_PREFERENCE;
+    }
+
+    /* Reference: https://tools.ietf.org/html/rfc5245#section-4.1.2.1
+     * priority = (2^24)*(type preference) +
+     *   (2^8)*(local preference) +
+     *   (2^0)*(256 - component ID)
+     *
+     * Since type preference <= 126 and local preference <= 65535, the maximum possible
+     * priority is (2^24) * (126) + (2^8) * (65535) + 255 = 2130706431. So, it's safe
+     * to use UINT32 since 2130706431 < 2 ^ 32. */
+    candidatePriority = ( ( 1 << 24 ) * ( typePreference ) + ( 1 << 8 ) * ( localPreference ) + 255 );
+
+    return candidatePriority;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_ComputeCandidatePairPriority - Compute the candidate pair priority. */
+
+uint64_t Ice_ComputeCandidatePairPriority( uint32_t localCandidatePriority,
+                                           uint32_t remoteCandidatePriority,
+                                           uint32_t isControlling )
+{
+    uint64_t controllingAgentCandidatePriority;
+    uint64_t controlledAgentCandidatePriority;
+    uint64_t candidatePairPriority = 0;
+
+    if( isControlling == 0 )
+    {
+        controllingAgentCandidatePriority = remoteCandidatePriority;
+        controlledAgentCandidatePriority = localCandidatePriority;
+    }
+    else
+    {
+        controllingAgentCandidatePriority = localCandidatePriority;
+        controlledAgentCandidatePriority = remoteCandidatePriority;
+    }
+
+    /* https://tools.ietf.org/html/rfc5245#appendix-B.5 */
+    candidatePairPriority = ( ( ( uint64_t ) 1 << 32 ) *
+                              ( controllingAgentCandidatePriority >= controlledAgentCandidatePriority ?
+                                controlledAgentCandidatePriority : controllingAgentCandidatePriority ) +
+                              ( 2 * ( controllingAgentCandidatePriority >= controlledAgentCandidatePriority ?
+                                      controllingAgentCandidatePriority : controlledAgentCandidatePriority ) ) +
+                              ( controllingAgentCandidatePriority > controlledAgentCandidatePriority ? 1 : 0 ) );
+
+    return candidatePairPriority;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_AllocateRequestCache - Take the next request cache from the array
+ * provided by the application. Returns NULL if none is left.
+ */
+IceRequestCache_t * Ice_AllocateRequestCache( IceContext_t * pContext )
+{
+    IceRequestCache_t * pRequestCache = NULL;
+
+    if( pContext->numRequestCaches < pContext->maxRequestCaches )
+    {
+        pRequestCache = &( pContext->pRequestCaches[ pContext->numRequestCaches ] );
+        pContext->numRequestCaches += 1;
+        Ice_InvalidateRequestCache( pRequestCache );
+    }
+
+    return pRequestCache;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_FindResponseCacheEntry - Find the response cache entry of the binding
+ * request with the given transaction ID received on the given candidate pair.
+ */
+IceResponseCacheEntry_t * Ice_FindResponseCacheEntry( IceContext_t * pContext,
+                                                      const uint8_t * pTransactionId,
+                                                      const IceCandidatePair_t * pIceCandidatePair )
+{
+    IceResponseCacheEntry_t * pResponseCacheEntry = NULL;
+    size_t i;
+
+    for( i = 0; i < pContext->responseCacheHighWaterMark; i++ )
+    {
+        if( ( pContext->pResponseCacheEntries[ i ].pCandidatePair == pIceCandidatePair ) &&
+            ( memcmp( &( pContext->pResponseCacheEntries[ i ].transactionId[ 0 ] ),
+                      pTransactionId,
+                      STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 ) )
+        {
+            pResponseCacheEntry = &( pContext->pResponseCacheEntries[ i ] );
+            break;
+        }
+    }
+
+    return pResponseCacheEntry;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_ClearResponseCache - Drop all the response cache entries. Needs to be
+ * called whenever candidate pairs move in the candidate pair array.
+ */
+void Ice_ClearResponseCache( IceContext_t * pContext )
+{
+    size_t i;
+
+    for( i = 0; i < pContext->responseCacheHighWaterMark; i++ )
+    {
+        pContext->pResponseCacheEntries[ i ].pCandidatePair = NULL;
+    }
+
+    pContext->nextResponseCacheEntry = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_MoveResponseCacheEntries - Point the response cache entries of a
+ * candidate pair which moved in the candidate pair array to its new location,
+ * or drop them if pToCandidatePair is NULL.
+ */
+void Ice_MoveResponseCacheEntries( IceContext_t * pContext,
+                                   const IceCandidatePair_t * pFromCandidatePair,
+                                   IceCandidatePair_t * pToCandidatePair )
+{
+    size_t i;
+
+    for( i = 0; i < pContext->responseCacheHighWaterMark; i++ )
+    {
+        if( pContext->pResponseCacheEntries[ i ].pCandidatePair == pFromCandidatePair )
+        {
+            pContext->pResponseCacheEntries[ i ].pCandidatePair = pToCandidatePair;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_LayoutArena - Lay out the tables described by pSizes one after another,
+ * each starting at a multiple of ICE_ARENA_ALIGNMENT, and return the total
+ * length in pArenaLength. If pArena is not NULL, also point the arrays of
+ * pInitInfo at their tables and initialize the transaction ID store in the
+ * arena. Returns ICE_RESULT_BAD_PARAM if the total length does not fit in a
+ * size_t.
+ */
+IceResult_t Ice_LayoutArena( const IceArenaSizes_t * pSizes,
+                             uint8_t * pArena,
+                             IceInitInfo_t * pInitInfo,
+                             size_t * pArenaLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    size_t offset = 0;
+    size_t tableOffsets[ ICE_ARENA_TABLE_COUNT ];
+    size_t tableCounts[ ICE_ARENA_TABLE_COUNT ];
+    size_t entrySizes[ ICE_ARENA_TABLE_COUNT ];
+    size_t i;
+
+    tableCounts[ 0 ] = 1;
+    entrySizes[ 0 ] = sizeof( TransactionIdStore_t );
+    tableCounts[ 1 ] = pSizes->transactionIdSlotsArrayLength;
+    entrySizes[ 1 ] = sizeof( TransactionIdSlot_t );
+    tableCounts[ 2 ] = pSizes->localCandidatesArrayLength;
+    entrySizes[ 2 ] = sizeof( IceCandidate_t );
+    tableCounts[ 3 ] = pSizes->remoteCandidatesArrayLength;
+    entrySizes[ 3 ] = sizeof( IceCandidate_t );
+    tableCounts[ 4 ] = pSizes->candidatePairsArrayLength;
+    entrySizes[ 4 ] = sizeof( IceCandidatePair_t );
+    tableCounts[ 5 ] = pSizes->turnServerArrayLength;
+    entrySizes[ 5 ] = sizeof( IceTurnServer_t );
+    tableCounts[ 6 ] = pSizes->stunRequestTemplatesArrayLength;
+    entrySizes[ 6 ] = sizeof( IceStunRequestTemplate_t );
+    tableCounts[ 7 ] = pSizes->requestCachesArrayLength;
+    entrySizes[ 7 ] = sizeof( IceRequestCache_t );
+    tableCounts[ 8 ] = pSizes->responseCacheArrayLength;
+    entrySizes[ 8 ] = sizeof( IceResponseCacheEntry_t );
+    tableCounts[ 9 ] = pSizes->credentialPoolBufferLength;
+    entrySizes[ 9 ] = 1;
+
+    for( i = 0; i < ICE_ARENA_TABLE_COUNT; i++ )
+    {
+        /* The table and its alignment padding must fit in what is left of
+         * size_t. offset is a multiple of ICE_ARENA_ALIGNMENT, so the
+         * subtraction does not wrap. */
+        if( tableCounts[ i ] > ( ( SIZE_MAX - ( ICE_ARENA_ALIGNMENT - 1 ) - offset ) / entrySizes[ i ] ) )
+        {
+            result = ICE_RESULT_BAD_PARAM;
+            break;
+        }
+
+        tableOffsets[ i ] = offset;
+        offset += ( ( ( tableCounts[ i ] * entrySizes[ i ] ) + ICE_ARENA_ALIGNMENT - 1 ) / ICE_ARENA_ALIGNMENT ) * ICE_ARENA_ALIGNMENT;
+    }
+
+    if( ( result == ICE_RESULT_OK ) &&
+        ( pArena != NULL ) )
+    {
+        pInitInfo->pStunBindingRequestTransactionIdStore = ( TransactionIdStore_t * ) &( pArena[ tableOffsets[ 0 ] ] );
+        ( void ) TransactionIdStore_Init( pInitInfo->pStunBindingRequestTransactionIdStore,
+                                          ( TransactionIdSlot_t * ) &( pArena[ tableOffsets[ 1 ] ] ),
+                                          pSizes->transactionIdSlotsArrayLength );
+
+        pInitInfo->pLocalCandidatesArray = ( IceCandidate_t * ) &( pArena[ tableOffsets[ 2 ] ] );
+        pInitInfo->localCandidatesArrayLength = pSizes->localCandidatesArrayLength;
+        pInitInfo->pRemoteCandidatesArray = ( IceCandidate_t * ) &( pArena[ tableOffsets[ 3 ] ] );
+        pInitInfo->remoteCandidatesArrayLength = pSizes->remoteCandidatesArrayLength;
+        pInitInfo->pCandidatePairsArray = ( IceCandidatePair_t * ) &( pArena[ tableOffsets[ 4 ] ] );
+        pInitInfo->candidatePairsArrayLength = pSizes->candidatePairsArrayLength;
+        pInitInfo->pTurnServerArray = ( IceTurnServer_t * ) &( pArena[ tableOffsets[ 5 ] ] );
+        pInitInfo->turnServerArrayLength = pSizes->turnServerArrayLength;
+
+        pInitInfo->pStunRequestTemplatesArray = ( pSizes->stunRequestTemplatesArrayLength != 0 ) ?
+                                                ( IceStunRequestTemplate_t * ) &( pArena[ tableOffsets[ 6 ] ] ) : NULL;
+        pInitInfo->stunRequestTemplatesArrayLength = pSizes->stunRequestTemplatesArrayLength;
+        pInitInfo->pRequestCachesArray = ( pSizes->requestCachesArrayLength != 0 ) ?
+                                         ( IceRequestCache_t * ) &( pArena[ tableOffsets[ 7 ] ] ) : NULL;
+        pInitInfo->requestCachesArrayLength = pSizes->requestCachesArrayLength;
+        pInitInfo->pResponseCacheArray = ( pSizes->responseCacheArrayLength != 0 ) ?
+                                         ( IceResponseCacheEntry_t * ) &( pArena[ tableOffsets[ 8 ] ] ) : NULL;
+        pInitInfo->responseCacheArrayLength = pSizes->responseCacheArrayLength;
+        pInitInfo->pCredentialPoolBuffer = ( pSizes->credentialPoolBufferLength != 0 ) ?
+                                           &( pArena[ tableOffsets[ 9 ] ] ) : NULL;
+        pInitInfo->credentialPoolBufferLength = pSizes->credentialPoolBufferLength;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        *pArenaLength = offset;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_SetTableStats - Fill the statistics of one table, in entries and in
+ * bytes.
+ */
+void Ice_SetTableStats( IceTableStats_t * pTableStats,
+                        size_t capacity,
+                        size_t used,
+                        size_t highWaterMark,
+                        size_t entrySize )
+{
+    pTableStats->capacity = capacity;
+    pTableStats->used = used;
+    pTableStats->highWaterMark = highWaterMark;
+    pTableStats->capacityBytes = capacity * entrySize;
+    pTableStats->usedBytes = used * entrySize;
+    pTableStats->highWaterMarkBytes = highWaterMark * entrySize;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_CountUsedCandidates - Count the slots holding a candidate. Closed
+ * candidates are invalid until their slot is reused.
+ */
+size_t Ice_CountUsedCandidates( const IceCandidate_t * pCandidates,
+                                size_t numCandidates )
+{
+    size_t i, used = 0;
+
+    for( i = 0; i < numCandidates; i++ )
+    {
+        if( pCandidates[ i ].state != ICE_CANDIDATE_STATE_INVALID )
+        {
+            used++;
+        }
+    }
+
+    return used;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_GetTurnServerCredential - Return where a credential of the TURN server
+ * starts in the credential pool.
+ */
+const uint8_t * Ice_GetTurnServerCredential( const IceContext_t * pContext,
+                                             const IceTurnServer_t * pTurnServer,
+                                             IceTurnServerCredential_t credential )
+{
+    const uint8_t * pCredential = NULL;
+    size_t offset = pTurnServer->credentialsOffset;
+    size_t i;
+
+    for( i = 0; i < ( size_t ) credential; i++ )
+    {
+        offset += pTurnServer->credentialLengths[ i ];
+    }
+
+    if( pContext->pCredentialPool != NULL )
+    {
+        pCredential = &( pContext->pCredentialPool[ offset ] );
+    }
+
+    return pCredential;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* GetTurnServerCredentialsLength - Total length of the credentials of the
+ * TURN server.
+ */
+static size_t GetTurnServerCredentialsLength( const IceTurnServer_t * pTurnServer )
+{
+    size_t length = 0;
+    size_t i;
+
+    for( i = 0; i < ( size_t ) ICE_TURN_SERVER_CREDENTIAL_MAX; i++ )
+    {
+        length += pTurnServer->credentialLengths[ i ];
+    }
+
+    return length;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* GetGrownCredentialsOffset - Where the credentials of the TURN server go when
+ * they outgrow its space: in place if its space is the last one of the
+ * credential pool, at the end of the pool otherwise.
+ */
+static size_t GetGrownCredentialsOffset( const IceContext_t * pContext,
+                                         const IceTurnServer_t * pTurnServer )
+{
+    size_t offset = pContext->credentialPoolUsed;
+
+    if( ( pTurnServer->credentialsOffset + pTurnServer->credentialsCapacity ) == pContext->credentialPoolUsed )
+    {
+        offset = pTurnServer->credentialsOffset;
+    }
+
+    return offset;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* CompactCredentialPool - Move the credentials of all the TURN servers to the
+ * start of the credential pool, in the order of their offsets, and trim the
+ * space of each server to its credentials. This reclaims the space left behind
+ * by credentials moved to the end of the pool. pTurnServer is included even if
+ * it is not counted in numTurnServers yet. The spaces owned by servers do not
+ * overlap, so the server visited next is the one with the lowest offset above
+ * the previous one.
+ */
+static void CompactCredentialPool( IceContext_t * pContext,
+                                   IceTurnServer_t * pTurnServer )
+{
+    IceTurnServer_t * pServer;
+    IceTurnServer_t * pNextServer;
+    size_t previousOffset = 0;
+    size_t writeOffset = 0;
+    size_t length;
+    size_t i;
+    uint8_t isFirst = 1;
+
+    do
+    {
+        pNextServer = NULL;
+
+        for( i = 0; i <= pContext->numTurnServers; i++ )
+        {
+            pServer = ( i < pContext->numTurnServers ) ? &( pContext->pTurnServers[ i ] ) : pTurnServer;
+
+            if( ( pServer->credentialsCapacity != 0U ) &&
+                ( ( isFirst == 1U ) || ( pServer->credentialsOffset > previousOffset ) ) &&
+                ( ( pNextServer == NULL ) || ( pServer->credentialsOffset < pNextServer->credentialsOffset ) ) )
+            {
+                pNextServer = pServer;
+            }
+        }
+
+        if( pNextServer != NULL )
+        {
+            previousOffset = pNextServer->credentialsOffset;
+            isFirst = 0;
+            length = GetTurnServerCredentialsLength( pNextServer );
+
+            memmove( &( pContext->pCredentialPool[ writeOffset ] ),
+                     &( pContext->pCredentialPool[ pNextServer->credentialsOffset ] ),
+                     length );
+
+            pNextServer->credentialsOffset = ( uint32_t ) writeOffset;
+            pNextServer->credentialsCapacity = ( uint32_t ) length;
+            writeOffset += length;
+        }
+    } while( pNextServer != NULL );
+
+    pContext->credentialPoolUsed = writeOffset;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_SetTurnServerCredential - Replace a credential of the TURN server. The
+ * credentials after it are moved within the space owned by the server. If they
+ * no longer fit, the server gets new space at the end of the credential pool,
+ * growing in place if its space is already the last one. When the end of the
+ * pool is reached, the pool is compacted first. pValue must not point into the
+ * credential pool.
+ */
+IceResult_t Ice_SetTurnServerCredential( IceContext_t * pContext,
+                                         IceTurnServer_t * pTurnServer,
+                                         IceTurnServerCredential_t credential,
+                                         const uint8_t * pValue,
+                                         size_t valueLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    size_t prefixLength = 0;
+    size_t suffixLength = 0;
+    size_t usedLength;
+    size_t requiredLength;
+    size_t newOffset;
+    size_t i;
+    uint8_t * pCredentials;
+
+    for( i = 0; i < ( size_t ) ICE_TURN_SERVER_CREDENTIAL_MAX; i++ )
+    {
+        if( i < ( size_t ) credential )
+        {
+            prefixLength += pTurnServer->credentialLengths[ i ];
+        }
+        else if( i > ( size_t ) credential )
+        {
+            suffixLength += pTurnServer->credentialLengths[ i ];
+        }
+        else
+        {
+            /* The credential being replaced. */
+        }
+    }
+
+    usedLength = prefixLength + pTurnServer->credentialLengths[ credential ] + suffixLength;
+    requiredLength = prefixLength + valueLength + suffixLength;
+
+    if( requiredLength > pTurnServer->credentialsCapacity )
+    {
+        newOffset = GetGrownCredentialsOffset( pContext,
+                                               pTurnServer );
+
+        if( ( newOffset + requiredLength ) > pContext->credentialPoolLength )
+        {
+            CompactCredentialPool( pContext,
+                                   pTurnServer );
+            newOffset = GetGrownCredentialsOffset( pContext,
+                                                   pTurnServer );
+        }
+
+        if( ( newOffset + requiredLength ) > pContext->credentialPoolLength )
+        {
+            result = ICE_RESULT_OUT_OF_MEMORY;
+        }
+        else
+        {
+            if( newOffset != pTurnServer->credentialsOffset )
+            {
+                memcpy( &( pContext->pCredentialPool[ newOffset ] ),
+                        &( pContext->pCredentialPool[ pTurnServer->credentialsOffset ] ),
+                        usedLength );
+            }
+
+            pTurnServer->credentialsOffset = ( uint32_t ) newOffset;
+            pTurnServer->credentialsCapacity = ( uint32_t ) ( requiredLength + ICE_TURN_SERVER_CREDENTIALS_RESERVE_LENGTH );
+
+            if( ( newOffset + pTurnServer->credentialsCapacity ) > pContext->credentialPoolLength )
+            {
+                pTurnServer->credentialsCapacity = ( uint32_t ) ( pContext->credentialPoolLength - newOffset );
+            }
+
+            pContext->credentialPoolUsed = newOffset + pTurnServer->credentialsCapacity;
+
+            if( pContext->credentialPoolUsed > pContext->credentialPoolHighWaterMark )
+            {
+                pContext->credentialPoolHighWaterMark = pContext->credentialPoolUsed;
+            }
+        }
+    }
+
+    if( ( result == ICE_RESULT_OK ) && ( requiredLength != 0 ) )
+    {
+        pCredentials = &( pContext->pCredentialPool[ pTurnServer->credentialsOffset ] );
+
+        memmove( &( pCredentials[ prefixLength + valueLength ] ),
+                 &( pCredentials[ prefixLength + pTurnServer->credentialLengths[ credential ] ] ),
+                 suffixLength );
+        memcpy( &( pCredentials[ prefixLength ] ),
+                pValue,
+                valueLength );
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        pTurnServer->credentialLengths[ credential ] = ( uint16_t ) valueLength;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_ReleaseTurnServerCredentials - Drop the credentials of the TURN server.
+ * Its space goes back to the credential pool if it is the last one of the
+ * pool, otherwise it is reclaimed by the next compaction of the pool.
+ */
+void Ice_ReleaseTurnServerCredentials( IceContext_t * pContext,
+                                       IceTurnServer_t * pTurnServer )
+{
+    memset( &( pTurnServer->credentialLengths[ 0 ] ),
+            0,
+            sizeof( pTurnServer->credentialLengths ) );
+
+    if( ( pTurnServer->credentialsOffset + pTurnServer->credentialsCapacity ) == pContext->credentialPoolUsed )
+    {
+        pContext->credentialPoolUsed = pTurnServer->credentialsOffset;
+        pTurnServer->credentialsCapacity = 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_FillRandomPool - Replace the contents of the random pool with fresh
+ * random bytes. The pool is left empty if the random function fails.
+ */
+IceResult_t Ice_FillRandomPool( IceContext_t * pContext )
+{
+    IceResult_t result;
+
+    result = pContext->pConfig->cryptoFunctions.randomFxn( pContext->pRandomPool,
+                                                           pContext->randomPoolLength );
+
+    if( result == ICE_RESULT_OK )
+    {
+        pContext->randomPoolOffset = 0;
+    }
     else
     {
-        controllingAgentCandidatePriority = localCandidatePriority;
-        controlledAgentCandidatePriority = remoteCandidatePriority;
+        pContext->randomPoolOffset = pContext->randomPoolLength;
     }
 
-    /* https://tools.ietf.org/html/rfc5245#appendix-B.5 */
-    candidatePairPriority = ( ( ( uint64_t ) 1 << 32 ) *
-                              ( controllingAgentCandidatePriority >= controlledAgentCandidatePriority ?
-                                controlledAgentCandidatePriority : controllingAgentCandidatePriority ) +
-                              ( 2 * ( controllingAgentCandidatePriority >= controlledAgentCandidatePriority ?
-                                      controllingAgentCandidatePriority : controlledAgentCandidatePriority ) ) +
-                              ( controllingAgentCandidatePriority > controlledAgentCandidatePriority ? 1 : 0 ) );
+    return result;
+}
 
-    return candidatePairPriority;
+/*----------------------------------------------------------------------------*/
+
+/* Ice_GenerateRandom - Fill the buffer with random bytes taken from the random
+ * pool, refilling it when it runs out. Falls back to the random function of
+ * the application if there is no pool or the request does not fit in it.
+ */
+IceResult_t Ice_GenerateRandom( IceContext_t * pContext,
+                                uint8_t * pBuffer,
+                                size_t bufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+
+    if( bufferLength > pContext->randomPoolLength )
+    {
+        result = pContext->pConfig->cryptoFunctions.randomFxn( pBuffer,
+                                                               bufferLength );
+    }
+    else
+    {
+        if( ( pContext->randomPoolLength - pContext->randomPoolOffset ) < bufferLength )
+        {
+            result = Ice_FillRandomPool( pContext );
+        }
+
+        if( result == ICE_RESULT_OK )
+        {
+            memcpy( pBuffer,
+                    &( pContext->pRandomPool[ pContext->randomPoolOffset ] ),
+                    bufferLength );
+            pContext->randomPoolOffset += bufferLength;
+        }
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_ReadRequestCache - Copy the cached request to the message buffer if it
+ * was created for the given transaction ID. Returns 1 on a cache hit. On a
+ * miss the cache is invalidated as the message buffer may be the cache itself.
+ */
+uint8_t Ice_ReadRequestCache( IceRequestCache_t * pRequestCache,
+                              const uint8_t * pTransactionId,
+                              uint8_t * pMessageBuffer,
+                              size_t * pMessageBufferLength )
+{
+    uint8_t isCached = 0;
+
+    if( pRequestCache != NULL )
+    {
+        if( ( pRequestCache->messageLength != 0 ) &&
+            ( pRequestCache->messageLength <= *pMessageBufferLength ) &&
+            ( memcmp( &( pRequestCache->transactionId[ 0 ] ),
+                      pTransactionId,
+                      STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 ) )
+        {
+            if( pMessageBuffer != &( pRequestCache->message[ 0 ] ) )
+            {
+                memcpy( pMessageBuffer,
+                        &( pRequestCache->message[ 0 ] ),
+                        pRequestCache->messageLength );
+            }
+
+            *pMessageBufferLength = pRequestCache->messageLength;
+            isCached = 1;
+        }
+        else
+        {
+            pRequestCache->messageLength = 0;
+        }
+    }
+
+    return isCached;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void Ice_WriteRequestCache( IceRequestCache_t * pRequestCache,
+                            const uint8_t * pTransactionId,
+                            const uint8_t * pMessage,
+                            size_t messageLength )
+{
+    if( ( pRequestCache != NULL ) &&
+        ( messageLength <= ICE_REQUEST_CACHE_MAX_LENGTH ) )
+    {
+        if( pMessage != &( pRequestCache->message[ 0 ] ) )
+        {
+            memcpy( &( pRequestCache->message[ 0 ] ),
+                    pMessage,
+                    messageLength );
+        }
+
+        memcpy( &( pRequestCache->transactionId[ 0 ] ),
+                pTransactionId,
+                STUN_HEADER_TRANSACTION_ID_LENGTH );
+        pRequestCache->messageLength = messageLength;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+void Ice_InvalidateRequestCache( IceRequestCache_t * pRequestCache )
+{
+    if( pRequestCache != NULL )
+    {
+        pRequestCache->messageLength = 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_IsCandidateRequestDue - Check whether Ice_CreateNextCandidateRequest
+ * has a request to create for the local candidate.
+ */
+uint8_t Ice_IsCandidateRequestDue( const IceCandidate_t * pIceCandidate,
+                                   uint64_t currentTimeSeconds )
+{
+    uint8_t isDue = 0;
+
+    if( pIceCandidate->candidateType == ICE_CANDIDATE_TYPE_SERVER_REFLEXIVE )
+    {
+        isDue = ( pIceCandidate->state == ICE_CANDIDATE_STATE_NEW ) ? 1U : 0U;
+    }
+    else if( pIceCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY )
+    {
+        if( ( pIceCandidate->state == ICE_CANDIDATE_STATE_ALLOCATING ) ||
+            ( pIceCandidate->state == ICE_CANDIDATE_STATE_RELEASING ) ||
+            ( ( currentTimeSeconds + ICE_TURN_ALLOCATION_REFRESH_GRACE_PERIOD_SECONDS ) >= pIceCandidate->pTurnServer->turnAllocationExpirationTimeSeconds ) )
+        {
+            isDue = 1;
+        }
+    }
+    else
+    {
+        /* Host candidates do not send requests. */
+    }
+
+    return isDue;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_IsCandidatePairRequestDue - Check whether Ice_CreateNextPairRequest has
+ * a request to create for the candidate pair. The local and remote candidates
+ * of the pair must be set.
+ */
+uint8_t Ice_IsCandidatePairRequestDue( const IceCandidatePair_t * pIceCandidatePair,
+                                       uint64_t currentTimeSeconds )
+{
+    uint8_t isDue = 0;
+
+    if( ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_WAITING ) ||
+        ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_NOMINATED ) ||
+        ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_CREATE_PERMISSION ) ||
+        ( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_CHANNEL_BIND ) )
+    {
+        isDue = 1;
+    }
+    else if( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_SUCCEEDED )
+    {
+        /* Only the permission of a relay candidate pair is refreshed. */
+        if( ( pIceCandidatePair->pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY ) &&
+            ( pIceCandidatePair->pLocalCandidate->state == ICE_CANDIDATE_STATE_VALID ) &&
+            ( ( currentTimeSeconds + ICE_TURN_PERMISSION_REFRESH_GRACE_PERIOD_SECONDS ) >= pIceCandidatePair->turnPermissionExpirationSeconds ) )
+        {
+            isDue = 1;
+        }
+    }
+    else
+    {
+        /* Nothing to send in the other states. */
+    }
+
+    return isDue;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -556,74 +2361,247 @@ IceResult_t Ice_FinalizeStunPacket( IceContext_t * pContext,
     uint16_t fingerprintCalculationDataLength = 0;
     uint32_t messageFingerprint = 0;
 
-    if( pPassword != NULL )
-    {
-        /* Add Integrity attribute. */
-        stunResult = StunSerializer_GetIntegrityBuffer( pStunCtx,
-                                                        &( pIntegrityCalculationData ),
-                                                        &( integrityCalculationDataLength ) );
+    if( pPassword != NULL )
+    {
+        /* Add Integrity attribute. */
+        stunResult = StunSerializer_GetIntegrityBuffer( pStunCtx,
+                                                        &( pIntegrityCalculationData ),
+                                                        &( integrityCalculationDataLength ) );
+
+        if( stunResult == STUN_RESULT_OK )
+        {
+            iceResult = pContext->pConfig->cryptoFunctions.hmacFxn( pPassword,
+                                                                    passwordLength,
+                                                                    pIntegrityCalculationData,
+                                                                    ( size_t ) integrityCalculationDataLength,
+                                                                    &( messageIntegrity[ 0 ] ),
+                                                                    &( messageIntegrityLength ) );
+
+            if( iceResult == ICE_RESULT_OK )
+            {
+                if( messageIntegrityLength == STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH )
+                {
+                    stunResult = StunSerializer_AddAttributeIntegrity( pStunCtx,
+                                                                       &( messageIntegrity[ 0 ] ),
+                                                                       messageIntegrityLength );
+                }
+                else
+                {
+                    iceResult = ICE_RESULT_HMAC_ERROR;
+                }
+            }
+        }
+    }
+
+    /* Add Fingerprint attribute. */
+    if( ( iceResult == ICE_RESULT_OK ) &&
+        ( stunResult == STUN_RESULT_OK ) )
+    {
+        stunResult = StunSerializer_GetFingerprintBuffer( pStunCtx,
+                                                          &( pFingerprintCalculationData ),
+                                                          &( fingerprintCalculationDataLength ) );
+
+        if( stunResult == STUN_RESULT_OK )
+        {
+            iceResult = pContext->pConfig->cryptoFunctions.crc32Fxn( 0,
+                                                                     pFingerprintCalculationData,
+                                                                     ( size_t ) fingerprintCalculationDataLength,
+                                                                     &( messageFingerprint ) );
+
+            if( iceResult == ICE_RESULT_OK )
+            {
+                stunResult = StunSerializer_AddAttributeFingerprint( pStunCtx,
+                                                                     messageFingerprint );
+            }
+        }
+    }
+
+    if( ( iceResult == ICE_RESULT_OK ) &&
+        ( stunResult == STUN_RESULT_OK ) )
+    {
+        stunResult = StunSerializer_Finalize( pStunCtx,
+                                              pStunMessageBufferLength );
+    }
+
+    if( stunResult != STUN_RESULT_OK )
+    {
+        iceResult = ICE_RESULT_STUN_ERROR;
+    }
+
+    return iceResult;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint8_t IsStunRequestTemplateUsable( IceContext_t * pContext,
+                                            const IceStunRequestTemplate_t * pStunRequestTemplate,
+                                            uint8_t isNomination,
+                                            size_t stunMessageBufferLength )
+{
+    uint8_t isUsable = 0;
+
+    if( ( pStunRequestTemplate != NULL ) &&
+        ( pStunRequestTemplate->messageLength != 0 ) &&
+        ( pStunRequestTemplate->isNomination == isNomination ) &&
+        ( pStunRequestTemplate->isControlling == pContext->isControlling ) &&
+        ( pStunRequestTemplate->messageLength <= stunMessageBufferLength ) )
+    {
+        isUsable = 1;
+    }
+
+    return isUsable;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* CreateStunRequestFromTemplate - Copy the finalized request, replace the
+ * transaction ID and recompute MESSAGE-INTEGRITY and FINGERPRINT in place. The
+ * template always ends with these two attributes.
+ */
+static IceResult_t CreateStunRequestFromTemplate( IceContext_t * pContext,
+                                                  const IceStunRequestTemplate_t * pStunRequestTemplate,
+                                                  const uint8_t * pTransactionId,
+                                                  uint8_t * pStunMessageBuffer,
+                                                  size_t * pStunMessageBufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    size_t messageLength = pStunRequestTemplate->messageLength;
+    size_t fingerprintOffset = messageLength - ICE_STUN_FINGERPRINT_ATTRIBUTE_LENGTH;
+    size_t integrityOffset = fingerprintOffset - ICE_STUN_INTEGRITY_ATTRIBUTE_LENGTH;
+    uint16_t messageIntegrityLength = STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH;
+    uint32_t messageFingerprint = 0;
+
+    memcpy( pStunMessageBuffer,
+            &( pStunRequestTemplate->message[ 0 ] ),
+            messageLength );
+    memcpy( &( pStunMessageBuffer[ ICE_STUN_HEADER_TRANSACTION_ID_OFFSET ] ),
+            pTransactionId,
+            STUN_HEADER_TRANSACTION_ID_LENGTH );
+
+    /* MESSAGE-INTEGRITY is calculated with the message length covering the
+     * MESSAGE-INTEGRITY attribute but not FINGERPRINT. */
+    pContext->pConfig->readWriteFunctions.writeUint16Fn( &( pStunMessageBuffer[ ICE_STUN_HEADER_MESSAGE_LENGTH_OFFSET ] ),
+                                                         ( uint16_t ) ( fingerprintOffset - ICE_STUN_HEADER_LENGTH ) );
+
+    result = pContext->pConfig->cryptoFunctions.hmacFxn( pContext->creds.pRemotePassword,
+                                                         pContext->creds.remotePasswordLength,
+                                                         pStunMessageBuffer,
+                                                         integrityOffset,
+                                                         &( pStunMessageBuffer[ integrityOffset + ICE_STUN_ATTRIBUTE_HEADER_LENGTH ] ),
+                                                         &( messageIntegrityLength ) );
+
+    if( ( result == ICE_RESULT_OK ) &&
+        ( messageIntegrityLength != STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH ) )
+    {
+        result = ICE_RESULT_HMAC_ERROR;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        pContext->pConfig->readWriteFunctions.writeUint16Fn( &( pStunMessageBuffer[ ICE_STUN_HEADER_MESSAGE_LENGTH_OFFSET ] ),
+                                                             ( uint16_t ) ( messageLength - ICE_STUN_HEADER_LENGTH ) );
+
+        result = pContext->pConfig->cryptoFunctions.crc32Fxn( 0,
+                                                              pStunMessageBuffer,
+                                                              fingerprintOffset,
+                                                              &( messageFingerprint ) );
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        pContext->pConfig->readWriteFunctions.writeUint32Fn( &( pStunMessageBuffer[ fingerprintOffset + ICE_STUN_ATTRIBUTE_HEADER_LENGTH ] ),
+                                                             messageFingerprint ^ ICE_STUN_FINGERPRINT_XOR_VALUE );
+        *pStunMessageBufferLength = messageLength;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void SaveStunRequestTemplate( IceContext_t * pContext,
+                                     IceStunRequestTemplate_t * pStunRequestTemplate,
+                                     uint8_t isNomination,
+                                     const uint8_t * pStunMessage,
+                                     size_t stunMessageLength )
+{
+    if( ( pStunRequestTemplate != NULL ) &&
+        ( stunMessageLength <= ICE_STUN_REQUEST_TEMPLATE_MAX_LENGTH ) )
+    {
+        memcpy( &( pStunRequestTemplate->message[ 0 ] ),
+                pStunMessage,
+                stunMessageLength );
+        pStunRequestTemplate->messageLength = stunMessageLength;
+        pStunRequestTemplate->isNomination = isNomination;
+        pStunRequestTemplate->isControlling = pContext->isControlling;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* SerializeConnectivityCheck - Serialize a connectivity check request of the
+ * candidate pair with the given transaction ID.
+ */
+static IceResult_t SerializeConnectivityCheck( IceContext_t * pContext,
+                                               const IceCandidatePair_t * pIceCandidatePair,
+                                               uint8_t * pTransactionId,
+                                               uint8_t * pStunMessageBuffer,
+                                               size_t * pStunMessageBufferLength )
+{
+    StunContext_t stunCtx;
+    StunHeader_t stunHeader;
+    IceResult_t result = ICE_RESULT_OK;
+    StunResult_t stunResult = STUN_RESULT_OK;
+
+    stunHeader.messageType = STUN_MESSAGE_TYPE_BINDING_REQUEST;
+    stunHeader.pTransactionId = pTransactionId;
 
-        if( stunResult == STUN_RESULT_OK )
-        {
-            iceResult = pContext->cryptoFunctions.hmacFxn( pPassword,
-                                                           passwordLength,
-                                                           pIntegrityCalculationData,
-                                                           ( size_t ) integrityCalculationDataLength,
-                                                           &( messageIntegrity[ 0 ] ),
-                                                           &( messageIntegrityLength ) );
+    stunResult = StunSerializer_Init( &( stunCtx ),
+                                      pStunMessageBuffer,
+                                      *pStunMessageBufferLength,
+                                      &( stunHeader ) );
 
-            if( iceResult == ICE_RESULT_OK )
-            {
-                if( messageIntegrityLength == STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH )
-                {
-                    stunResult = StunSerializer_AddAttributeIntegrity( pStunCtx,
-                                                                       &( messageIntegrity[ 0 ] ),
-                                                                       messageIntegrityLength );
-                }
-                else
-                {
-                    iceResult = ICE_RESULT_HMAC_ERROR;
-                }
-            }
-        }
+    if( stunResult == STUN_RESULT_OK )
+    {
+        stunResult = StunSerializer_AddAttributeUsername( &( stunCtx ),
+                                                          pContext->creds.pCombinedUsername,
+                                                          ( uint16_t ) pContext->creds.combinedUsernameLength );
     }
 
-    /* Add Fingerprint attribute. */
-    if( ( iceResult == ICE_RESULT_OK ) &&
-        ( stunResult == STUN_RESULT_OK ) )
+    if( stunResult == STUN_RESULT_OK )
     {
-        stunResult = StunSerializer_GetFingerprintBuffer( pStunCtx,
-                                                          &( pFingerprintCalculationData ),
-                                                          &( fingerprintCalculationDataLength ) );
+        stunResult = StunSerializer_AddAttributePriority( &( stunCtx ),
+                                                          pIceCandidatePair->pLocalCandidate->priority );
+    }
 
-        if( stunResult == STUN_RESULT_OK )
+    if( stunResult == STUN_RESULT_OK )
+    {
+        if( pContext->isControlling == 0 )
         {
-            iceResult = pContext->cryptoFunctions.crc32Fxn( 0,
-                                                            pFingerprintCalculationData,
-                                                            ( size_t ) fingerprintCalculationDataLength,
-                                                            &( messageFingerprint ) );
-
-            if( iceResult == ICE_RESULT_OK )
-            {
-                stunResult = StunSerializer_AddAttributeFingerprint( pStunCtx,
-                                                                     messageFingerprint );
-            }
+            stunResult = StunSerializer_AddAttributeIceControlled( &( stunCtx ),
+                                                                   pContext->tieBreaker );
+        }
+        else
+        {
+            stunResult = StunSerializer_AddAttributeIceControlling( &( stunCtx ),
+                                                                    pContext->tieBreaker );
         }
     }
 
-    if( ( iceResult == ICE_RESULT_OK ) &&
-        ( stunResult == STUN_RESULT_OK ) )
+    if( stunResult == STUN_RESULT_OK )
     {
-        stunResult = StunSerializer_Finalize( pStunCtx,
-                                              pStunMessageBufferLength );
+        result = Ice_FinalizeStunPacket( pContext,
+                                         &( stunCtx ),
+                                         pContext->creds.pRemotePassword,
+                                         pContext->creds.remotePasswordLength,
+                                         pStunMessageBufferLength );
     }
-
-    if( stunResult != STUN_RESULT_OK )
+    else
     {
-        iceResult = ICE_RESULT_STUN_ERROR;
+        result = ICE_RESULT_STUN_ERROR;
     }
 
-    return iceResult;
+    return result;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -636,13 +2614,11 @@ IceResult_t Ice_CreateRequestForConnectivityCheck( IceContext_t * pContext,
                                                    uint8_t * pMessageBuffer,
                                                    size_t * pMessageBufferLength )
 {
-    StunContext_t stunCtx;
-    StunHeader_t stunHeader;
     IceResult_t result = ICE_RESULT_OK;
-    StunResult_t stunResult = STUN_RESULT_OK;
     uint8_t * pStunMessageStart;
     size_t stunMessageBufferLength;
     size_t turnMessageBufferLength;
+    uint8_t isFromTemplate = 0;
 
     if( ( pContext == NULL ) ||
         ( pIceCandidatePair == NULL ) ||
@@ -655,7 +2631,7 @@ IceResult_t Ice_CreateRequestForConnectivityCheck( IceContext_t * pContext,
     /* If we have received binding success response, we stop sending binding request for this pair. */
     if( result == ICE_RESULT_OK )
     {
-        if( ( pIceCandidatePair->connectivityCheckFlags & ICE_STUN_RESPONSE_RECEIVED_FLAG ) != 0 )
+        if( ( pIceCandidatePair->flags & ICE_STUN_RESPONSE_RECEIVED_FLAG ) != 0 )
         {
             result = ICE_RESULT_NO_NEXT_ACTION;
         }
@@ -678,55 +2654,38 @@ IceResult_t Ice_CreateRequestForConnectivityCheck( IceContext_t * pContext,
         }
     }
 
-    /* Serialize application data. */
-    if( result == ICE_RESULT_OK )
+    /* Reuse the previously serialized request of this pair, if any. */
+    if( ( result == ICE_RESULT_OK ) &&
+        ( IsStunRequestTemplateUsable( pContext,
+                                       pIceCandidatePair->pStunRequestTemplate,
+                                       0,
+                                       stunMessageBufferLength ) == 1 ) )
     {
-        stunHeader.messageType = STUN_MESSAGE_TYPE_BINDING_REQUEST;
-        stunHeader.pTransactionId = &( pIceCandidatePair->transactionId[ 0 ] );
-
-        stunResult = StunSerializer_Init( &( stunCtx ),
-                                          pStunMessageStart,
-                                          stunMessageBufferLength,
-                                          &( stunHeader ) );
-
-        if( stunResult == STUN_RESULT_OK )
-        {
-            stunResult = StunSerializer_AddAttributeUsername( &( stunCtx ),
-                                                              pContext->creds.pCombinedUsername,
-                                                              ( uint16_t ) pContext->creds.combinedUsernameLength );
-        }
-
-        if( stunResult == STUN_RESULT_OK )
-        {
-            stunResult = StunSerializer_AddAttributePriority( &( stunCtx ),
-                                                              pIceCandidatePair->pLocalCandidate->priority );
-        }
-
-        if( stunResult == STUN_RESULT_OK )
-        {
-            if( pContext->isControlling == 0 )
-            {
-                stunResult = StunSerializer_AddAttributeIceControlled( &( stunCtx ),
-                                                                       pContext->tieBreaker );
-            }
-            else
-            {
-                stunResult = StunSerializer_AddAttributeIceControlling( &( stunCtx ),
-                                                                        pContext->tieBreaker );
-            }
-        }
+        result = CreateStunRequestFromTemplate( pContext,
+                                                pIceCandidatePair->pStunRequestTemplate,
+                                                &( pIceCandidatePair->transactionId[ 0 ] ),
+                                                pStunMessageStart,
+                                                &( stunMessageBufferLength ) );
+        isFromTemplate = 1;
+    }
 
-        if( stunResult == STUN_RESULT_OK )
-        {
-            result = Ice_FinalizeStunPacket( pContext,
-                                             &( stunCtx ),
-                                             pContext->creds.pRemotePassword,
-                                             pContext->creds.remotePasswordLength,
+    /* Serialize application data. */
+    if( ( result == ICE_RESULT_OK ) &&
+        ( isFromTemplate == 0 ) )
+    {
+        result = SerializeConnectivityCheck( pContext,
+                                             pIceCandidatePair,
+                                             &( pIceCandidatePair->transactionId[ 0 ] ),
+                                             pStunMessageStart,
                                              &( stunMessageBufferLength ) );
-        }
-        else
+
+        if( result == ICE_RESULT_OK )
         {
-            result = ICE_RESULT_STUN_ERROR;
+            SaveStunRequestTemplate( pContext,
+                                     pIceCandidatePair->pStunRequestTemplate,
+                                     0,
+                                     pStunMessageStart,
+                                     stunMessageBufferLength );
         }
     }
 
@@ -743,7 +2702,7 @@ IceResult_t Ice_CreateRequestForConnectivityCheck( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        pIceCandidatePair->connectivityCheckFlags |= ICE_STUN_REQUEST_SENT_FLAG;
+        pIceCandidatePair->flags |= ICE_STUN_REQUEST_SENT_FLAG;
 
         if( pIceCandidatePair->pLocalCandidate->candidateType == ICE_CANDIDATE_TYPE_RELAY )
         {
@@ -760,6 +2719,73 @@ IceResult_t Ice_CreateRequestForConnectivityCheck( IceContext_t * pContext,
 
 /*----------------------------------------------------------------------------*/
 
+/* Ice_GetEarlyConnectivityCheckTransactionId - Derive the transaction ID of
+ * the connectivity check sent in a Send indication while a ChannelBind request
+ * is outstanding. The transaction ID of the pair belongs to the ChannelBind
+ * transaction, so flip the top bit of its first byte.
+ */
+void Ice_GetEarlyConnectivityCheckTransactionId( const IceCandidatePair_t * pIceCandidatePair,
+                                                 uint8_t * pTransactionId )
+{
+    memcpy( pTransactionId,
+            &( pIceCandidatePair->transactionId[ 0 ] ),
+            STUN_HEADER_TRANSACTION_ID_LENGTH );
+    pTransactionId[ 0 ] ^= ICE_EARLY_CONNECTIVITY_CHECK_TRANSACTION_ID_MASK;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* Ice_CreateRequestForEarlyConnectivityCheck - This API creates the connectivity
+ * check request of a relay candidate pair whose ChannelBind request is
+ * outstanding. The request uses the derived transaction ID and is not wrapped
+ * in a TURN message.
+ */
+IceResult_t Ice_CreateRequestForEarlyConnectivityCheck( IceContext_t * pContext,
+                                                        IceCandidatePair_t * pIceCandidatePair,
+                                                        uint8_t * pStunMessageBuffer,
+                                                        size_t * pStunMessageBufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    uint8_t transactionId[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+
+    Ice_GetEarlyConnectivityCheckTransactionId( pIceCandidatePair,
+                                                &( transactionId[ 0 ] ) );
+
+    /* Reuse the previously serialized request of this pair, if any. */
+    if( IsStunRequestTemplateUsable( pContext,
+                                     pIceCandidatePair->pStunRequestTemplate,
+                                     0,
+                                     *pStunMessageBufferLength ) == 1 )
+    {
+        result = CreateStunRequestFromTemplate( pContext,
+                                                pIceCandidatePair->pStunRequestTemplate,
+                                                &( transactionId[ 0 ] ),
+                                                pStunMessageBuffer,
+                                                pStunMessageBufferLength );
+    }
+    else
+    {
+        result = SerializeConnectivityCheck( pContext,
+                                             pIceCandidatePair,
+                                             &( transactionId[ 0 ] ),
+                                             pStunMessageBuffer,
+                                             pStunMessageBufferLength );
+
+        if( result == ICE_RESULT_OK )
+        {
+            SaveStunRequestTemplate( pContext,
+                                     pIceCandidatePair->pStunRequestTemplate,
+                                     0,
+                                     pStunMessageBuffer,
+                                     *pStunMessageBufferLength );
+        }
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
 /* Ice_CreateRequestForNominatingCandidatePair - This API creates Stun Packet
  * for nomination of the valid candidate Pair sent by the Controlling ICE agent.
  */
@@ -775,6 +2801,7 @@ IceResult_t Ice_CreateRequestForNominatingCandidatePair( IceContext_t * pContext
     uint8_t * pStunMessageStart;
     size_t stunMessageBufferLength;
     size_t turnMessageBufferLength;
+    uint8_t isFromTemplate = 0;
 
     if( ( pContext == NULL ) ||
         ( pIceCandidatePair == NULL ) ||
@@ -801,7 +2828,23 @@ IceResult_t Ice_CreateRequestForNominatingCandidatePair( IceContext_t * pContext
         }
     }
 
-    if( result == ICE_RESULT_OK )
+    /* Reuse the previously serialized request of this pair, if any. */
+    if( ( result == ICE_RESULT_OK ) &&
+        ( IsStunRequestTemplateUsable( pContext,
+                                       pIceCandidatePair->pStunRequestTemplate,
+                                       1,
+                                       stunMessageBufferLength ) == 1 ) )
+    {
+        result = CreateStunRequestFromTemplate( pContext,
+                                                pIceCandidatePair->pStunRequestTemplate,
+                                                &( pIceCandidatePair->transactionId[ 0 ] ),
+                                                pStunMessageStart,
+                                                &( stunMessageBufferLength ) );
+        isFromTemplate = 1;
+    }
+
+    if( ( result == ICE_RESULT_OK ) &&
+        ( isFromTemplate == 0 ) )
     {
         stunHeader.messageType = STUN_MESSAGE_TYPE_BINDING_REQUEST;
         stunHeader.pTransactionId = &( pIceCandidatePair->transactionId[ 0 ] );
@@ -847,6 +2890,15 @@ IceResult_t Ice_CreateRequestForNominatingCandidatePair( IceContext_t * pContext
         {
             result = ICE_RESULT_STUN_ERROR;
         }
+
+        if( result == ICE_RESULT_OK )
+        {
+            SaveStunRequestTemplate( pContext,
+                                     pIceCandidatePair->pStunRequestTemplate,
+                                     1,
+                                     pStunMessageStart,
+                                     stunMessageBufferLength );
+        }
     }
 
     if( ( result == ICE_RESULT_OK ) &&
@@ -983,11 +3035,11 @@ IceResult_t Ice_CreateAllocationRequest( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pIceCandidate->pTurnServer->userNameLength > 0U )
+        if( pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_USER_NAME ] > 0U )
         {
             stunResult = StunSerializer_AddAttributeUsername( &( stunCtx ),
-                                                              &( pIceCandidate->pTurnServer->userName[ 0 ] ),
-                                                              pIceCandidate->pTurnServer->userNameLength );
+                                                              Ice_GetTurnServerCredential( pContext, pIceCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_USER_NAME ),
+                                                              pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_USER_NAME ] );
 
             if( stunResult != STUN_RESULT_OK )
             {
@@ -998,11 +3050,11 @@ IceResult_t Ice_CreateAllocationRequest( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pIceCandidate->pTurnServer->realmLength > 0U )
+        if( pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_REALM ] > 0U )
         {
             stunResult = StunSerializer_AddAttributeRealm( &( stunCtx ),
-                                                           &( pIceCandidate->pTurnServer->realm[ 0 ] ),
-                                                           pIceCandidate->pTurnServer->realmLength );
+                                                           Ice_GetTurnServerCredential( pContext, pIceCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_REALM ),
+                                                           pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_REALM ] );
 
             if( stunResult != STUN_RESULT_OK )
             {
@@ -1013,11 +3065,11 @@ IceResult_t Ice_CreateAllocationRequest( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pIceCandidate->pTurnServer->nonceLength > 0U )
+        if( pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_NONCE ] > 0U )
         {
             stunResult = StunSerializer_AddAttributeNonce( &( stunCtx ),
-                                                           &( pIceCandidate->pTurnServer->nonce[ 0 ] ),
-                                                           pIceCandidate->pTurnServer->nonceLength );
+                                                           Ice_GetTurnServerCredential( pContext, pIceCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_NONCE ),
+                                                           pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_NONCE ] );
 
             if( stunResult != STUN_RESULT_OK )
             {
@@ -1097,11 +3149,11 @@ IceResult_t Ice_CreateRefreshRequest( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pIceCandidate->pTurnServer->userNameLength > 0U )
+        if( pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_USER_NAME ] > 0U )
         {
             stunResult = StunSerializer_AddAttributeUsername( &( stunCtx ),
-                                                              &( pIceCandidate->pTurnServer->userName[ 0 ] ),
-                                                              pIceCandidate->pTurnServer->userNameLength );
+                                                              Ice_GetTurnServerCredential( pContext, pIceCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_USER_NAME ),
+                                                              pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_USER_NAME ] );
 
             if( stunResult != STUN_RESULT_OK )
             {
@@ -1112,11 +3164,11 @@ IceResult_t Ice_CreateRefreshRequest( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pIceCandidate->pTurnServer->realmLength > 0U )
+        if( pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_REALM ] > 0U )
         {
             stunResult = StunSerializer_AddAttributeRealm( &( stunCtx ),
-                                                           &( pIceCandidate->pTurnServer->realm[ 0 ] ),
-                                                           pIceCandidate->pTurnServer->realmLength );
+                                                           Ice_GetTurnServerCredential( pContext, pIceCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_REALM ),
+                                                           pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_REALM ] );
 
             if( stunResult != STUN_RESULT_OK )
             {
@@ -1127,11 +3179,11 @@ IceResult_t Ice_CreateRefreshRequest( IceContext_t * pContext,
 
     if( result == ICE_RESULT_OK )
     {
-        if( pIceCandidate->pTurnServer->nonceLength > 0U )
+        if( pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_NONCE ] > 0U )
         {
             stunResult = StunSerializer_AddAttributeNonce( &( stunCtx ),
-                                                           &( pIceCandidate->pTurnServer->nonce[ 0 ] ),
-                                                           pIceCandidate->pTurnServer->nonceLength );
+                                                           Ice_GetTurnServerCredential( pContext, pIceCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_NONCE ),
+                                                           pIceCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_NONCE ] );
 
             if( stunResult != STUN_RESULT_OK )
             {
@@ -1188,8 +3240,8 @@ IceResult_t Ice_CreatePermissionRequest( IceContext_t * pContext,
     if( result == ICE_RESULT_OK )
     {
         if( ( pIceCandidatePair->pLocalCandidate->pTurnServer->longTermPasswordLength == 0 ) ||
-            ( pIceCandidatePair->pLocalCandidate->pTurnServer->realmLength == 0 ) ||
-            ( pIceCandidatePair->pLocalCandidate->pTurnServer->nonceLength == 0 ) )
+            ( pIceCandidatePair->pLocalCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_REALM ] == 0 ) ||
+            ( pIceCandidatePair->pLocalCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_NONCE ] == 0 ) )
         {
             result = ICE_RESULT_INVALID_CANDIDATE_CREDENTIAL;
         }
@@ -1226,8 +3278,8 @@ IceResult_t Ice_CreatePermissionRequest( IceContext_t * pContext,
     if( result == ICE_RESULT_OK )
     {
         stunResult = StunSerializer_AddAttributeUsername( &( stunCtx ),
-                                                          &( pIceCandidatePair->pLocalCandidate->pTurnServer->userName[ 0 ] ),
-                                                          pIceCandidatePair->pLocalCandidate->pTurnServer->userNameLength );
+                                                          Ice_GetTurnServerCredential( pContext, pIceCandidatePair->pLocalCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_USER_NAME ),
+                                                          pIceCandidatePair->pLocalCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_USER_NAME ] );
 
         if( stunResult != STUN_RESULT_OK )
         {
@@ -1238,8 +3290,8 @@ IceResult_t Ice_CreatePermissionRequest( IceContext_t * pContext,
     if( result == ICE_RESULT_OK )
     {
         stunResult = StunSerializer_AddAttributeRealm( &( stunCtx ),
-                                                       &( pIceCandidatePair->pLocalCandidate->pTurnServer->realm[ 0 ] ),
-                                                       pIceCandidatePair->pLocalCandidate->pTurnServer->realmLength );
+                                                       Ice_GetTurnServerCredential( pContext, pIceCandidatePair->pLocalCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_REALM ),
+                                                       pIceCandidatePair->pLocalCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_REALM ] );
 
         if( stunResult != STUN_RESULT_OK )
         {
@@ -1250,8 +3302,8 @@ IceResult_t Ice_CreatePermissionRequest( IceContext_t * pContext,
     if( result == ICE_RESULT_OK )
     {
         stunResult = StunSerializer_AddAttributeNonce( &( stunCtx ),
-                                                       &( pIceCandidatePair->pLocalCandidate->pTurnServer->nonce[ 0 ] ),
-                                                       pIceCandidatePair->pLocalCandidate->pTurnServer->nonceLength );
+                                                       Ice_GetTurnServerCredential( pContext, pIceCandidatePair->pLocalCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_NONCE ),
+                                                       pIceCandidatePair->pLocalCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_NONCE ] );
 
         if( stunResult != STUN_RESULT_OK )
         {
@@ -1295,8 +3347,8 @@ IceResult_t Ice_CreateChannelBindRequest( IceContext_t * pContext,
     if( result == ICE_RESULT_OK )
     {
         if( ( pIceCandidatePair->pLocalCandidate->pTurnServer->longTermPasswordLength == 0 ) ||
-            ( pIceCandidatePair->pLocalCandidate->pTurnServer->realmLength == 0 ) ||
-            ( pIceCandidatePair->pLocalCandidate->pTurnServer->nonceLength == 0 ) )
+            ( pIceCandidatePair->pLocalCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_REALM ] == 0 ) ||
+            ( pIceCandidatePair->pLocalCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_NONCE ] == 0 ) )
         {
             result = ICE_RESULT_INVALID_CANDIDATE_CREDENTIAL;
         }
@@ -1344,8 +3396,8 @@ IceResult_t Ice_CreateChannelBindRequest( IceContext_t * pContext,
     if( result == ICE_RESULT_OK )
     {
         stunResult = StunSerializer_AddAttributeUsername( &( stunCtx ),
-                                                          &( pIceCandidatePair->pLocalCandidate->pTurnServer->userName[ 0 ] ),
-                                                          pIceCandidatePair->pLocalCandidate->pTurnServer->userNameLength );
+                                                          Ice_GetTurnServerCredential( pContext, pIceCandidatePair->pLocalCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_USER_NAME ),
+                                                          pIceCandidatePair->pLocalCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_USER_NAME ] );
 
         if( stunResult != STUN_RESULT_OK )
         {
@@ -1356,8 +3408,8 @@ IceResult_t Ice_CreateChannelBindRequest( IceContext_t * pContext,
     if( result == ICE_RESULT_OK )
     {
         stunResult = StunSerializer_AddAttributeRealm( &( stunCtx ),
-                                                       &( pIceCandidatePair->pLocalCandidate->pTurnServer->realm[ 0 ] ),
-                                                       pIceCandidatePair->pLocalCandidate->pTurnServer->realmLength );
+                                                       Ice_GetTurnServerCredential( pContext, pIceCandidatePair->pLocalCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_REALM ),
+                                                       pIceCandidatePair->pLocalCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_REALM ] );
 
         if( stunResult != STUN_RESULT_OK )
         {
@@ -1368,8 +3420,8 @@ IceResult_t Ice_CreateChannelBindRequest( IceContext_t * pContext,
     if( result == ICE_RESULT_OK )
     {
         stunResult = StunSerializer_AddAttributeNonce( &( stunCtx ),
-                                                       &( pIceCandidatePair->pLocalCandidate->pTurnServer->nonce[ 0 ] ),
-                                                       pIceCandidatePair->pLocalCandidate->pTurnServer->nonceLength );
+                                                       Ice_GetTurnServerCredential( pContext, pIceCandidatePair->pLocalCandidate->pTurnServer, ICE_TURN_SERVER_CREDENTIAL_NONCE ),
+                                                       pIceCandidatePair->pLocalCandidate->pTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_NONCE ] );
 
         if( stunResult != STUN_RESULT_OK )
         {
@@ -1391,6 +3443,155 @@ IceResult_t Ice_CreateChannelBindRequest( IceContext_t * pContext,
 
 /*----------------------------------------------------------------------------*/
 
+/* FindRetransmittedStunBindingRequest - Find the response cache entry of a
+ * binding request which is a retransmission of a request that already passed
+ * the integrity check. An entry of a closed candidate pair is dropped instead
+ * so that the retransmission does not bring the candidate pair back.
+ */
+static IceResponseCacheEntry_t * FindRetransmittedStunBindingRequest( IceContext_t * pContext,
+                                                                      const StunContext_t * pStunCtx,
+                                                                      const IceCandidate_t * pLocalCandidate,
+                                                                      const IceEndpoint_t * pRemoteCandidateEndpoint )
+{
+    IceResponseCacheEntry_t * pResponseCacheEntry = NULL;
+    IceResponseCacheEntry_t * pEntry;
+    size_t i;
+
+    for( i = 0; i < pContext->responseCacheHighWaterMark; i++ )
+    {
+        pEntry = &( pContext->pResponseCacheEntries[ i ] );
+
+        /* The MESSAGE-INTEGRITY offset is within the request as the request
+         * length matches. */
+        if( ( pEntry->pCandidatePair != NULL ) &&
+            ( pEntry->pLocalCandidate == pLocalCandidate ) &&
+            ( pEntry->requestLength == pStunCtx->totalLength ) &&
+            ( memcmp( &( pEntry->transactionId[ 0 ] ),
+                      &( pStunCtx->pStart[ ICE_STUN_HEADER_TRANSACTION_ID_OFFSET ] ),
+                      STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 ) &&
+            ( memcmp( &( pEntry->requestIntegrity[ 0 ] ),
+                      &( pStunCtx->pStart[ pEntry->requestIntegrityOffset ] ),
+                      STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH ) == 0 ) &&
+            ( Ice_IsSameTransportAddress( &( pEntry->remoteTransportAddress ),
+                                          &( pRemoteCandidateEndpoint->transportAddress ) ) == 1 ) )
+        {
+            if( ICE_CANDIDATE_PAIR_IS_CLOSED( pEntry->pCandidatePair ) )
+            {
+                pEntry->pCandidatePair = NULL;
+            }
+            else
+            {
+                pResponseCacheEntry = pEntry;
+            }
+
+            break;
+        }
+    }
+
+    return pResponseCacheEntry;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* SaveStunBindingRequest - Remember a binding request which passed the
+ * integrity check so that its retransmissions are recognized. The oldest entry
+ * is replaced when the cache is full.
+ */
+static void SaveStunBindingRequest( IceContext_t * pContext,
+                                    const StunContext_t * pStunCtx,
+                                    const IceStunDeserializedPacketInfo_t * pDeserializePacketInfo,
+                                    const IceCandidate_t * pLocalCandidate,
+                                    const IceEndpoint_t * pRemoteCandidateEndpoint,
+                                    IceCandidatePair_t * pIceCandidatePair )
+{
+    IceResponseCacheEntry_t * pEntry;
+
+    /* Requests without MESSAGE-INTEGRITY are not cached. */
+    if( ( pContext->maxResponseCacheEntries != 0 ) &&
+        ( pDeserializePacketInfo->pMessageIntegrity != NULL ) )
+    {
+        pEntry = &( pContext->pResponseCacheEntries[ pContext->nextResponseCacheEntry ] );
+
+        if( pContext->nextResponseCacheEntry == pContext->responseCacheHighWaterMark )
+        {
+            pContext->responseCacheHighWaterMark += 1;
+        }
+
+        pContext->nextResponseCacheEntry = ( pContext->nextResponseCacheEntry + 1 ) % pContext->maxResponseCacheEntries;
+
+        memcpy( &( pEntry->transactionId[ 0 ] ),
+                &( pStunCtx->pStart[ ICE_STUN_HEADER_TRANSACTION_ID_OFFSET ] ),
+                STUN_HEADER_TRANSACTION_ID_LENGTH );
+        pEntry->pLocalCandidate = pLocalCandidate;
+        pEntry->remoteTransportAddress = pRemoteCandidateEndpoint->transportAddress;
+        pEntry->pCandidatePair = pIceCandidatePair;
+        pEntry->useCandidateFlag = pDeserializePacketInfo->useCandidateFlag;
+        pEntry->requestLength = pStunCtx->totalLength;
+        pEntry->requestIntegrityOffset = ( size_t ) ( pDeserializePacketInfo->pMessageIntegrity - pStunCtx->pStart );
+        memcpy( &( pEntry->requestIntegrity[ 0 ] ),
+                pDeserializePacketInfo->pMessageIntegrity,
+                STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH );
+        pEntry->responseLength = 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* AddTriggeredCandidatePair - With lazy candidate pairs, create the candidate
+ * pair a binding request arrived on if Ice_AddNextCandidatePair has not got to
+ * it yet. Returns NULL if the candidates are not usable or the candidate pair
+ * cannot be added.
+ */
+static IceCandidatePair_t * AddTriggeredCandidatePair( IceContext_t * pContext,
+                                                       const IceCandidate_t * pLocalCandidate,
+                                                       const IceEndpoint_t * pRemoteCandidateEndpoint )
+{
+    IceCandidatePair_t * pIceCandidatePair = NULL;
+    IceCandidate_t * pLocal = NULL;
+    IceCandidate_t * pRemote = NULL;
+    size_t i;
+
+    for( i = 0; i < pContext->numLocalCandidates; i++ )
+    {
+        if( ( pContext->pLocalCandidates[ i ].state == ICE_CANDIDATE_STATE_VALID ) &&
+            ( pContext->pLocalCandidates[ i ].candidateType != ICE_CANDIDATE_TYPE_RELAY ) &&
+            ( Ice_IsSameTransportAddress( &( pContext->pLocalCandidates[ i ].endpoint.transportAddress ),
+                                          &( pLocalCandidate->endpoint.transportAddress ) ) == 1 ) )
+        {
+            pLocal = &( pContext->pLocalCandidates[ i ] );
+            break;
+        }
+    }
+
+    for( i = 0; i < pContext->numRemoteCandidates; i++ )
+    {
+        if( ( pContext->pRemoteCandidates[ i ].state != ICE_CANDIDATE_STATE_INVALID ) &&
+            ( Ice_IsSameTransportAddress( &( pContext->pRemoteCandidates[ i ].endpoint.transportAddress ),
+                                          &( pRemoteCandidateEndpoint->transportAddress ) ) == 1 ) )
+        {
+            pRemote = &( pContext->pRemoteCandidates[ i ] );
+            break;
+        }
+    }
+
+    if( ( pLocal != NULL ) &&
+        ( pRemote != NULL ) &&
+        ( Ice_AddCandidatePair( pContext,
+                                pLocal,
+                                pRemote ) == ICE_RESULT_OK ) )
+    {
+        /* Ice_AddNextCandidatePair looks for it when it gets there. */
+        pContext->lazyTriggeredCandidatePairs++;
+        pIceCandidatePair = Ice_FindCandidatePair( pContext,
+                                                   pLocal,
+                                                   pRemote );
+    }
+
+    return pIceCandidatePair;
+}
+
+/*----------------------------------------------------------------------------*/
+
 IceHandleStunPacketResult_t Ice_HandleStunBindingRequest( IceContext_t * pContext,
                                                           StunContext_t * pStunCtx,
                                                           const IceCandidate_t * pLocalCandidate,
@@ -1402,13 +3603,29 @@ IceHandleStunPacketResult_t Ice_HandleStunBindingRequest( IceContext_t * pContex
     IceStunDeserializedPacketInfo_t deserializePacketInfo;
     IceCandidatePair_t * pIceCandidatePair = NULL;
     IceRemoteCandidateInfo_t remoteCandidateInfo;
+    IceResponseCacheEntry_t * pResponseCacheEntry;
     size_t i;
 
-    handleStunPacketResult = DeserializeStunPacket( pContext,
-                                                    pStunCtx,
-                                                    pContext->creds.pLocalPassword,
-                                                    pContext->creds.localPasswordLength,
-                                                    &( deserializePacketInfo ) );
+    pResponseCacheEntry = FindRetransmittedStunBindingRequest( pContext,
+                                                               pStunCtx,
+                                                               pLocalCandidate,
+                                                               pRemoteCandidateEndpoint );
+
+    if( pResponseCacheEntry == NULL )
+    {
+        handleStunPacketResult = DeserializeStunPacket( pContext,
+                                                        pStunCtx,
+                                                        pContext->creds.pLocalPassword,
+                                                        pContext->creds.localPasswordLength,
+                                                        &( deserializePacketInfo ) );
+    }
+    else
+    {
+        /* Retransmission of a request which already passed the integrity
+         * check. */
+        deserializePacketInfo.errorCode = 0;
+        deserializePacketInfo.useCandidateFlag = pResponseCacheEntry->useCandidateFlag;
+    }
 
     if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
     {
@@ -1420,14 +3637,19 @@ IceHandleStunPacketResult_t Ice_HandleStunBindingRequest( IceContext_t * pContex
 
     if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
     {
-        if( pLocalCandidate->candidateType != ICE_CANDIDATE_TYPE_RELAY )
+        if( pResponseCacheEntry != NULL )
+        {
+            pIceCandidatePair = pResponseCacheEntry->pCandidatePair;
+        }
+        else if( pLocalCandidate->candidateType != ICE_CANDIDATE_TYPE_RELAY )
         {
             /* Do we already have a remote candidate with the same transport address
              * as pRemoteCandidateEndpoint->transportAddress? */
             for( i = 0; i < pContext->numRemoteCandidates; i++ )
             {
-                if( Ice_IsSameTransportAddress( &( pContext->pRemoteCandidates[ i ].endpoint.transportAddress ),
-                                                &( pRemoteCandidateEndpoint->transportAddress ) ) == 1 )
+                if( ( pContext->pRemoteCandidates[ i ].state != ICE_CANDIDATE_STATE_INVALID ) &&
+                    ( Ice_IsSameTransportAddress( &( pContext->pRemoteCandidates[ i ].endpoint.transportAddress ),
+                                                  &( pRemoteCandidateEndpoint->transportAddress ) ) == 1 ) )
                 {
                     break;
                 }
@@ -1451,7 +3673,8 @@ IceHandleStunPacketResult_t Ice_HandleStunBindingRequest( IceContext_t * pContex
             {
                 for( i = 0; i < pContext->numCandidatePairs; i++ )
                 {
-                    if( ( Ice_IsSameTransportAddress( &( pContext->pCandidatePairs[ i ].pLocalCandidate->endpoint.transportAddress ),
+                    if( ( ICE_CANDIDATE_PAIR_IS_CLOSED( &( pContext->pCandidatePairs[ i ] ) ) == 0 ) &&
+                        ( Ice_IsSameTransportAddress( &( pContext->pCandidatePairs[ i ].pLocalCandidate->endpoint.transportAddress ),
                                                       &( pLocalCandidate->endpoint.transportAddress ) ) == 1 ) &&
                         ( Ice_IsSameTransportAddress( &( pContext->pCandidatePairs[ i ].pRemoteCandidate->endpoint.transportAddress ),
                                                       &( pRemoteCandidateEndpoint->transportAddress ) ) == 1 ) )
@@ -1460,6 +3683,14 @@ IceHandleStunPacketResult_t Ice_HandleStunBindingRequest( IceContext_t * pContex
                         break;
                     }
                 }
+
+                if( ( pIceCandidatePair == NULL ) &&
+                    ( pContext->lazyCandidatePairs != 0 ) )
+                {
+                    pIceCandidatePair = AddTriggeredCandidatePair( pContext,
+                                                                   pLocalCandidate,
+                                                                   pRemoteCandidateEndpoint );
+                }
             }
         }
         else
@@ -1476,10 +3707,21 @@ IceHandleStunPacketResult_t Ice_HandleStunBindingRequest( IceContext_t * pContex
         }
     }
 
+    if( ( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK ) &&
+        ( pResponseCacheEntry == NULL ) )
+    {
+        SaveStunBindingRequest( pContext,
+                                pStunCtx,
+                                &( deserializePacketInfo ),
+                                pLocalCandidate,
+                                pRemoteCandidateEndpoint,
+                                pIceCandidatePair );
+    }
+
     if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
     {
         /* Received a connectivity check request from the remote candidate. */
-        pIceCandidatePair->connectivityCheckFlags |= ICE_STUN_REQUEST_RECEIVED_FLAG;
+        pIceCandidatePair->flags |= ICE_STUN_REQUEST_RECEIVED_FLAG;
 
         if( pContext->isControlling == 0 )
         {
@@ -1489,15 +3731,15 @@ IceHandleStunPacketResult_t Ice_HandleStunBindingRequest( IceContext_t * pContex
                 pIceCandidatePair->state = ICE_CANDIDATE_PAIR_STATE_NOMINATED;
             }
 
-            if( ( pIceCandidatePair->connectivityCheckFlags & ICE_STUN_REQUEST_SENT_FLAG ) == 0 )
+            if( ( pIceCandidatePair->flags & ICE_STUN_REQUEST_SENT_FLAG ) == 0 )
             {
                 /* We have not sent the connectivity check request to this
                  * candidate. The application needs to send 2 stun packets-
                  * 1. The connectivity check request from local to remote.
                  * 2. The response to the connectivity check request
                  *    received from remote. */
-                pIceCandidatePair->connectivityCheckFlags |= ICE_STUN_REQUEST_SENT_FLAG;
-                pIceCandidatePair->connectivityCheckFlags |= ICE_STUN_RESPONSE_SENT_FLAG;
+                pIceCandidatePair->flags |= ICE_STUN_REQUEST_SENT_FLAG;
+                pIceCandidatePair->flags |= ICE_STUN_RESPONSE_SENT_FLAG;
 
                 handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_SEND_TRIGGERED_CHECK;
             }
@@ -1507,12 +3749,15 @@ IceHandleStunPacketResult_t Ice_HandleStunBindingRequest( IceContext_t * pContex
                  * candidate. The application needs to send 1 stun packet-
                  * 1. The response to the connectivity check request
                  *    received from remote. */
-                pIceCandidatePair->connectivityCheckFlags |= ICE_STUN_RESPONSE_SENT_FLAG;
+                pIceCandidatePair->flags |= ICE_STUN_RESPONSE_SENT_FLAG;
 
                 handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_SEND_RESPONSE_FOR_REMOTE_REQUEST;
 
-                /* Would the 4-way handshake be complete after sending the response? */
-                if( ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( pIceCandidatePair->connectivityCheckFlags ) )
+                /* Would the 4-way handshake be complete after sending the
+                 * response? A pair waiting for its ChannelBind response is
+                 * completed by the ChannelBind success response instead. */
+                if( ( ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( pIceCandidatePair->flags ) ) &&
+                    ( pIceCandidatePair->state != ICE_CANDIDATE_PAIR_STATE_CHANNEL_BIND ) )
                 {
                     if( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_NOMINATED )
                     {
@@ -1529,15 +3774,15 @@ IceHandleStunPacketResult_t Ice_HandleStunBindingRequest( IceContext_t * pContex
         else
         {
             /* Controlling agent. */
-            if( ( pIceCandidatePair->connectivityCheckFlags & ICE_STUN_REQUEST_SENT_FLAG ) == 0 )
+            if( ( pIceCandidatePair->flags & ICE_STUN_REQUEST_SENT_FLAG ) == 0 )
             {
                 /* We have not sent the connectivity check request to this
                  * candidate. The application needs to send 2 stun packets-
                  * 1. The connectivity check request from local to remote.
                  * 2. The response to the connectivity check request
                  *    received from remote. */
-                pIceCandidatePair->connectivityCheckFlags |= ICE_STUN_REQUEST_SENT_FLAG;
-                pIceCandidatePair->connectivityCheckFlags |= ICE_STUN_RESPONSE_SENT_FLAG;
+                pIceCandidatePair->flags |= ICE_STUN_REQUEST_SENT_FLAG;
+                pIceCandidatePair->flags |= ICE_STUN_RESPONSE_SENT_FLAG;
 
                 handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_SEND_TRIGGERED_CHECK;
             }
@@ -1547,12 +3792,15 @@ IceHandleStunPacketResult_t Ice_HandleStunBindingRequest( IceContext_t * pContex
                  * candidate. The application needs to send 1 stun packet-
                  * 1. The response to the connectivity check request
                  *    received from remote. */
-                pIceCandidatePair->connectivityCheckFlags |= ICE_STUN_RESPONSE_SENT_FLAG;
+                pIceCandidatePair->flags |= ICE_STUN_RESPONSE_SENT_FLAG;
 
                 handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_SEND_RESPONSE_FOR_REMOTE_REQUEST;
 
-                /* Would the 4-way handshake be complete after sending the response? */
-                if( ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( pIceCandidatePair->connectivityCheckFlags ) )
+                /* Would the 4-way handshake be complete after sending the
+                 * response? A pair waiting for its ChannelBind response is
+                 * completed by the ChannelBind success response instead. */
+                if( ( ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( pIceCandidatePair->flags ) ) &&
+                    ( pIceCandidatePair->state != ICE_CANDIDATE_PAIR_STATE_CHANNEL_BIND ) )
                 {
                     /* If we have not yet nominated a pair, we nominate this
                      * pair. The application would need to send a nomination
@@ -1565,8 +3813,10 @@ IceHandleStunPacketResult_t Ice_HandleStunBindingRequest( IceContext_t * pContex
 
                         /* Generate the Transaction ID to be used in the
                          * nomination process. */
-                        iceResult = pContext->cryptoFunctions.randomFxn( &( pIceCandidatePair->transactionId[ 0 ] ),
-                                                                         STUN_HEADER_TRANSACTION_ID_LENGTH );
+                        iceResult = Ice_GenerateRandom( pContext,
+                                                        &( pIceCandidatePair->transactionId[ 0 ] ),
+                                                        STUN_HEADER_TRANSACTION_ID_LENGTH );
+                        Ice_InvalidateRequestCache( pIceCandidatePair->pRequestCache );
                         if( iceResult != ICE_RESULT_OK )
                         {
                             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_RANDOM_ERROR_CODE;
@@ -1595,7 +3845,6 @@ IceHandleStunPacketResult_t Ice_HandleServerReflexiveResponse( IceContext_t * pC
                                                                StunContext_t * pStunCtx,
                                                                IceCandidate_t * pLocalCandidate )
 {
-    size_t i;
     IceResult_t iceResult = ICE_RESULT_OK;
     IceHandleStunPacketResult_t handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_OK;
     IceStunDeserializedPacketInfo_t deserializePacketInfo;
@@ -1634,8 +3883,10 @@ IceHandleStunPacketResult_t Ice_HandleServerReflexiveResponse( IceContext_t * pC
     if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
     {
         /* Regenerate Transaction ID for next request. */
-        iceResult = pContext->cryptoFunctions.randomFxn( &( pLocalCandidate->transactionId[ 0 ] ),
-                                                         STUN_HEADER_TRANSACTION_ID_LENGTH );
+        iceResult = Ice_GenerateRandom( pContext,
+                                        &( pLocalCandidate->transactionId[ 0 ] ),
+                                        STUN_HEADER_TRANSACTION_ID_LENGTH );
+        Ice_InvalidateRequestCache( pLocalCandidate->pRequestCache );
         if( iceResult != ICE_RESULT_OK )
         {
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_RANDOM_ERROR_CODE;
@@ -1650,12 +3901,8 @@ IceHandleStunPacketResult_t Ice_HandleServerReflexiveResponse( IceContext_t * pC
         pLocalCandidate->endpoint.isPointToPoint = 0;
         pLocalCandidate->state = ICE_CANDIDATE_STATE_VALID;
 
-        for( i = 0; ( iceResult == ICE_RESULT_OK ) && ( i < pContext->numRemoteCandidates ); i++ )
-        {
-            iceResult = Ice_AddCandidatePair( pContext,
-                                              pLocalCandidate,
-                                              &( pContext->pRemoteCandidates[ i ] ) );
-        }
+        iceResult = Ice_AddCandidatePairs( pContext,
+                                           pLocalCandidate );
 
         handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_UPDATED_SERVER_REFLEXIVE_CANDIDATE_ADDRESS;
     }
@@ -1676,6 +3923,8 @@ IceHandleStunPacketResult_t Ice_HandleConnectivityCheckResponse( IceContext_t *
     IceStunDeserializedPacketInfo_t deserializePacketInfo;
     IceCandidatePair_t * pIceCandidatePair = NULL;
     IceResult_t result = ICE_RESULT_OK;
+    uint8_t earlyTransactionId[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+    uint8_t isEarlyCheck = 0;
     size_t i;
 
     handleStunPacketResult = DeserializeStunPacket( pContext,
@@ -1698,7 +3947,8 @@ IceHandleStunPacketResult_t Ice_HandleConnectivityCheckResponse( IceContext_t *
         {
             for( i = 0; i < pContext->numCandidatePairs; i++ )
             {
-                if( ( Ice_IsSameTransportAddress( &( pContext->pCandidatePairs[ i ].pLocalCandidate->endpoint.transportAddress ),
+                if( ( ICE_CANDIDATE_PAIR_IS_CLOSED( &( pContext->pCandidatePairs[ i ] ) ) == 0 ) &&
+                    ( Ice_IsSameTransportAddress( &( pContext->pCandidatePairs[ i ].pLocalCandidate->endpoint.transportAddress ),
                                                   &( pLocalCandidate->endpoint.transportAddress ) ) == 1 ) &&
                     ( Ice_IsSameTransportAddress( &( pContext->pCandidatePairs[ i ].pRemoteCandidate->endpoint.transportAddress ),
                                                   &( pRemoteCandidateEndpoint->transportAddress ) ) == 1 ) )
@@ -1728,37 +3978,67 @@ IceHandleStunPacketResult_t Ice_HandleConnectivityCheckResponse( IceContext_t *
                     pStunHeader->pTransactionId,
                     STUN_HEADER_TRANSACTION_ID_LENGTH ) != 0 )
         {
-            /* Dropping response packet because transaction id does not match.*/
-            handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_MATCHING_TRANSACTION_ID_NOT_FOUND;
+            if( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_CHANNEL_BIND )
+            {
+                Ice_GetEarlyConnectivityCheckTransactionId( pIceCandidatePair,
+                                                            &( earlyTransactionId[ 0 ] ) );
+
+                if( memcmp( &( earlyTransactionId[ 0 ] ),
+                            pStunHeader->pTransactionId,
+                            STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 )
+                {
+                    isEarlyCheck = 1;
+                }
+            }
+
+            if( isEarlyCheck == 0 )
+            {
+                /* Dropping response packet because transaction id does not match.*/
+                handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_MATCHING_TRANSACTION_ID_NOT_FOUND;
+            }
         }
     }
 
-    if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
+    if( ( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK ) &&
+        ( isEarlyCheck == 1 ) )
+    {
+        /* Response to the check sent in a Send indication. The transaction ID
+         * of the pair still belongs to the ChannelBind request, and the pair
+         * stays in ICE_CANDIDATE_PAIR_STATE_CHANNEL_BIND until the ChannelBind
+         * success response completes the check. */
+        pIceCandidatePair->flags |= ICE_STUN_RESPONSE_RECEIVED_FLAG;
+    }
+
+    if( ( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK ) &&
+        ( isEarlyCheck == 0 ) )
     {
         /* Regenerate Transaction ID for next request. */
-        result = pContext->cryptoFunctions.randomFxn( &( pIceCandidatePair->transactionId[ 0 ] ),
-                                                      STUN_HEADER_TRANSACTION_ID_LENGTH );
+        result = Ice_GenerateRandom( pContext,
+                                     &( pIceCandidatePair->transactionId[ 0 ] ),
+                                     STUN_HEADER_TRANSACTION_ID_LENGTH );
+        Ice_InvalidateRequestCache( pIceCandidatePair->pRequestCache );
         if( result != ICE_RESULT_OK )
         {
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_RANDOM_ERROR_CODE;
         }
     }
 
-    if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
+    if( ( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK ) &&
+        ( isEarlyCheck == 0 ) )
     {
-        pIceCandidatePair->connectivityCheckFlags |= ICE_STUN_RESPONSE_RECEIVED_FLAG;
+        pIceCandidatePair->flags |= ICE_STUN_RESPONSE_RECEIVED_FLAG;
 
         if( pContext->isControlling == 0 )
         {
             /* Controlled agent. */
             /* Is the 4-way connectivity check successful after receiving
              * the current response? */
-            if( ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( pIceCandidatePair->connectivityCheckFlags ) )
+            if( ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( pIceCandidatePair->flags ) )
             {
                 if( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_NOMINATED )
                 {
                     pIceCandidatePair->state = ICE_CANDIDATE_PAIR_STATE_SUCCEEDED;
-                    pIceCandidatePair->succeeded = 1U;
+                    pIceCandidatePair->flags |= ICE_CANDIDATE_PAIR_SUCCEEDED_FLAG;
                     handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_CANDIDATE_PAIR_READY;
                 }
                 else
@@ -1773,12 +4053,12 @@ IceHandleStunPacketResult_t Ice_HandleConnectivityCheckResponse( IceContext_t *
             /* Controlling agent. */
             /* Is the 4-way connectivity check successful after receiving
              * the current response? */
-            if( ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( pIceCandidatePair->connectivityCheckFlags ) )
+            if( ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( pIceCandidatePair->flags ) )
             {
                 if( pIceCandidatePair->state == ICE_CANDIDATE_PAIR_STATE_NOMINATED )
                 {
                     pIceCandidatePair->state = ICE_CANDIDATE_PAIR_STATE_SUCCEEDED;
-                    pIceCandidatePair->succeeded = 1U;
+                    pIceCandidatePair->flags |= ICE_CANDIDATE_PAIR_SUCCEEDED_FLAG;
                     handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_CANDIDATE_PAIR_READY;
                 }
                 else
@@ -1790,7 +4070,7 @@ IceHandleStunPacketResult_t Ice_HandleConnectivityCheckResponse( IceContext_t *
             }
         }
 
-        if( !ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( pIceCandidatePair->connectivityCheckFlags ) )
+        if( !ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( pIceCandidatePair->flags ) )
         {
             if( deserializePacketInfo.peerTransportAddress.family != 0 )
             {
@@ -1836,7 +4116,6 @@ IceHandleStunPacketResult_t Ice_HandleTurnAllocateSuccessResponse( IceContext_t
     IceHandleStunPacketResult_t handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_OK;
     IceStunDeserializedPacketInfo_t deserializePacketInfo;
     IceResult_t iceResult = ICE_RESULT_OK;
-    size_t i;
 
     if( ( pLocalCandidate->candidateType != ICE_CANDIDATE_TYPE_RELAY ) ||
         ( pLocalCandidate->pTurnServer == NULL ) ||
@@ -1875,8 +4154,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnAllocateSuccessResponse( IceContext_t
     if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
     {
         /* Regenerate Transaction ID for next request. */
-        iceResult = pContext->cryptoFunctions.randomFxn( &( pLocalCandidate->transactionId[ 0 ] ),
-                                                         STUN_HEADER_TRANSACTION_ID_LENGTH );
+        iceResult = Ice_GenerateRandom( pContext,
+                                        &( pLocalCandidate->transactionId[ 0 ] ),
+                                        STUN_HEADER_TRANSACTION_ID_LENGTH );
+        Ice_InvalidateRequestCache( pLocalCandidate->pRequestCache );
         if( iceResult != ICE_RESULT_OK )
         {
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_RANDOM_ERROR_CODE;
@@ -1890,16 +4171,15 @@ IceHandleStunPacketResult_t Ice_HandleTurnAllocateSuccessResponse( IceContext_t
                 sizeof( IceTransportAddress_t ) );
         pLocalCandidate->endpoint.isPointToPoint = 0;
         pLocalCandidate->pTurnServer->nextAvailableTurnChannelNumber = ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN;
+        memset( &( pLocalCandidate->pTurnServer->turnChannelNumbersInUse[ 0 ] ),
+                0,
+                sizeof( pLocalCandidate->pTurnServer->turnChannelNumbersInUse ) );
         pLocalCandidate->pTurnServer->turnAllocationExpirationTimeSeconds = currentTimeSeconds + deserializePacketInfo.lifetimeSeconds;
 
         pLocalCandidate->state = ICE_CANDIDATE_STATE_VALID;
 
-        for( i = 0; ( i < pContext->numRemoteCandidates ) && ( iceResult == ICE_RESULT_OK ); i++ )
-        {
-            iceResult = Ice_AddCandidatePair( pContext,
-                                              pLocalCandidate,
-                                              &( pContext->pRemoteCandidates[ i ] ) );
-        }
+        iceResult = Ice_AddCandidatePairs( pContext,
+                                           pLocalCandidate );
 
         handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_UPDATED_RELAY_CANDIDATE_ADDRESS;
     }
@@ -1947,8 +4227,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnAllocateErrorResponse( IceContext_t *
     if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
     {
         /* Regenerate Transaction ID for next request. */
-        iceResult = pContext->cryptoFunctions.randomFxn( &( pLocalCandidate->transactionId[ 0 ] ),
-                                                         STUN_HEADER_TRANSACTION_ID_LENGTH );
+        iceResult = Ice_GenerateRandom( pContext,
+                                        &( pLocalCandidate->transactionId[ 0 ] ),
+                                        STUN_HEADER_TRANSACTION_ID_LENGTH );
+        Ice_InvalidateRequestCache( pLocalCandidate->pRequestCache );
         if( iceResult != ICE_RESULT_OK )
         {
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_RANDOM_ERROR_CODE;
@@ -2035,9 +4317,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnCreatePermissionSuccessResponse( IceCo
             /* In TURN connection, the remote endpoint is always the TURN server.
              * We, therefore, have to compare the Transaction ID to get the
              * remote candidate. */
-            if( memcmp( &( pContext->pCandidatePairs[ i ].transactionId[ 0 ] ),
-                        pStunHeader->pTransactionId,
-                        STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 )
+            if( ( ICE_CANDIDATE_PAIR_IS_CLOSED( &( pContext->pCandidatePairs[ i ] ) ) == 0 ) &&
+                ( memcmp( &( pContext->pCandidatePairs[ i ].transactionId[ 0 ] ),
+                          pStunHeader->pTransactionId,
+                          STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 ) )
             {
                 pIceCandidatePair = &( pContext->pCandidatePairs[ i ] );
                 break;
@@ -2064,8 +4347,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnCreatePermissionSuccessResponse( IceCo
         pIceCandidatePair->turnPermissionExpirationSeconds = currentTimeSeconds + ICE_DEFAULT_TURN_PERMISSION_LIFETIME_SECONDS;
 
         /* Regenerate Transaction ID for next request. */
-        iceResult = pContext->cryptoFunctions.randomFxn( &( pIceCandidatePair->transactionId[ 0 ] ),
-                                                         STUN_HEADER_TRANSACTION_ID_LENGTH );
+        iceResult = Ice_GenerateRandom( pContext,
+                                        &( pIceCandidatePair->transactionId[ 0 ] ),
+                                        STUN_HEADER_TRANSACTION_ID_LENGTH );
+        Ice_InvalidateRequestCache( pIceCandidatePair->pRequestCache );
         if( iceResult != ICE_RESULT_OK )
         {
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_RANDOM_ERROR_CODE;
@@ -2125,9 +4410,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnCreatePermissionErrorResponse( IceCont
             /* In TURN connection, the remote endpoint is always the TURN server.
              * We, therefore, have to compare the Transaction ID to get the
              * remote candidate. */
-            if( memcmp( &( pContext->pCandidatePairs[ i ].transactionId[ 0 ] ),
-                        pStunHeader->pTransactionId,
-                        STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 )
+            if( ( ICE_CANDIDATE_PAIR_IS_CLOSED( &( pContext->pCandidatePairs[ i ] ) ) == 0 ) &&
+                ( memcmp( &( pContext->pCandidatePairs[ i ].transactionId[ 0 ] ),
+                          pStunHeader->pTransactionId,
+                          STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 ) )
             {
                 pIceCandidatePair = &( pContext->pCandidatePairs[ i ] );
                 break;
@@ -2154,8 +4440,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnCreatePermissionErrorResponse( IceCont
         pIceCandidatePair->state = ICE_CANDIDATE_PAIR_STATE_INVALID;
 
         /* Regenerate Transaction ID for next request. */
-        iceResult = pContext->cryptoFunctions.randomFxn( &( pIceCandidatePair->transactionId[ 0 ] ),
-                                                         STUN_HEADER_TRANSACTION_ID_LENGTH );
+        iceResult = Ice_GenerateRandom( pContext,
+                                        &( pIceCandidatePair->transactionId[ 0 ] ),
+                                        STUN_HEADER_TRANSACTION_ID_LENGTH );
+        Ice_InvalidateRequestCache( pIceCandidatePair->pRequestCache );
         if( iceResult != ICE_RESULT_OK )
         {
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_RANDOM_ERROR_CODE;
@@ -2214,9 +4502,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnChannelBindSuccessResponse( IceContext
             /* In TURN connection, the remote endpoint is always the TURN server.
              * We, therefore, have to compare the Transaction ID to get the
              * remote candidate. */
-            if( memcmp( &( pContext->pCandidatePairs[ i ].transactionId[ 0 ] ),
-                        pStunHeader->pTransactionId,
-                        STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 )
+            if( ( ICE_CANDIDATE_PAIR_IS_CLOSED( &( pContext->pCandidatePairs[ i ] ) ) == 0 ) &&
+                ( memcmp( &( pContext->pCandidatePairs[ i ].transactionId[ 0 ] ),
+                          pStunHeader->pTransactionId,
+                          STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 ) )
             {
                 pIceCandidatePair = &( pContext->pCandidatePairs[ i ] );
                 break;
@@ -2241,8 +4530,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnChannelBindSuccessResponse( IceContext
     if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
     {
         /* Regenerate Transaction ID for next request. */
-        iceResult = pContext->cryptoFunctions.randomFxn( &( pIceCandidatePair->transactionId[ 0 ] ),
-                                                         STUN_HEADER_TRANSACTION_ID_LENGTH );
+        iceResult = Ice_GenerateRandom( pContext,
+                                        &( pIceCandidatePair->transactionId[ 0 ] ),
+                                        STUN_HEADER_TRANSACTION_ID_LENGTH );
+        Ice_InvalidateRequestCache( pIceCandidatePair->pRequestCache );
         if( iceResult != ICE_RESULT_OK )
         {
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_RANDOM_ERROR_CODE;
@@ -2254,11 +4545,33 @@ IceHandleStunPacketResult_t Ice_HandleTurnChannelBindSuccessResponse( IceContext
         /* If the candidate pair is already selected, the application need not
          * take any action. Otherwise, the application need to initiate
          * connectivity check. */
-        if( pIceCandidatePair->succeeded != 0U )
+        if( ( pIceCandidatePair->flags & ICE_CANDIDATE_PAIR_SUCCEEDED_FLAG ) != 0U )
         {
             pIceCandidatePair->state = ICE_CANDIDATE_PAIR_STATE_SUCCEEDED;
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_FRESH_CHANNEL_BIND_COMPLETE;
         }
+        else if( ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( pIceCandidatePair->flags ) )
+        {
+            /* The check sent in a Send indication and the check of the remote
+             * candidate both completed while the channel was being bound. */
+            if( pContext->isControlling == 0 )
+            {
+                pIceCandidatePair->state = ICE_CANDIDATE_PAIR_STATE_VALID;
+                handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_VALID_CANDIDATE_PAIR;
+            }
+            else
+            {
+                pContext->pNominatedPair = pIceCandidatePair;
+                pIceCandidatePair->state = ICE_CANDIDATE_PAIR_STATE_NOMINATED;
+                handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_START_NOMINATION;
+            }
+        }
+        else if( ( pIceCandidatePair->flags & ICE_STUN_RESPONSE_RECEIVED_FLAG ) != 0U )
+        {
+            /* The check sent in a Send indication succeeded, so only the check
+             * of the remote candidate is awaited. */
+            pIceCandidatePair->state = ICE_CANDIDATE_PAIR_STATE_WAITING;
+        }
         else
         {
             pIceCandidatePair->state = ICE_CANDIDATE_PAIR_STATE_WAITING;
@@ -2310,9 +4623,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnChannelBindErrorResponse( IceContext_t
             /* In TURN connection, the remote endpoint is always the TURN server.
              * We, therefore, have to compare the Transaction ID to get the
              * remote candidate. */
-            if( memcmp( &( pContext->pCandidatePairs[ i ].transactionId[ 0 ] ),
-                        pStunHeader->pTransactionId,
-                        STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 )
+            if( ( ICE_CANDIDATE_PAIR_IS_CLOSED( &( pContext->pCandidatePairs[ i ] ) ) == 0 ) &&
+                ( memcmp( &( pContext->pCandidatePairs[ i ].transactionId[ 0 ] ),
+                          pStunHeader->pTransactionId,
+                          STUN_HEADER_TRANSACTION_ID_LENGTH ) == 0 ) )
             {
                 pIceCandidatePair = &( pContext->pCandidatePairs[ i ] );
                 break;
@@ -2339,8 +4653,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnChannelBindErrorResponse( IceContext_t
         pIceCandidatePair->state = ICE_CANDIDATE_PAIR_STATE_INVALID;
 
         /* Regenerate Transaction ID for next request. */
-        iceResult = pContext->cryptoFunctions.randomFxn( &( pIceCandidatePair->transactionId[ 0 ] ),
-                                                         STUN_HEADER_TRANSACTION_ID_LENGTH );
+        iceResult = Ice_GenerateRandom( pContext,
+                                        &( pIceCandidatePair->transactionId[ 0 ] ),
+                                        STUN_HEADER_TRANSACTION_ID_LENGTH );
+        Ice_InvalidateRequestCache( pIceCandidatePair->pRequestCache );
         if( iceResult != ICE_RESULT_OK )
         {
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_RANDOM_ERROR_CODE;
@@ -2395,8 +4711,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnRefreshSuccessResponse( IceContext_t *
     if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
     {
         /* Regenerate Transaction ID for next request. */
-        iceResult = pContext->cryptoFunctions.randomFxn( &( pLocalCandidate->transactionId[ 0 ] ),
-                                                         STUN_HEADER_TRANSACTION_ID_LENGTH );
+        iceResult = Ice_GenerateRandom( pContext,
+                                        &( pLocalCandidate->transactionId[ 0 ] ),
+                                        STUN_HEADER_TRANSACTION_ID_LENGTH );
+        Ice_InvalidateRequestCache( pLocalCandidate->pRequestCache );
         if( iceResult != ICE_RESULT_OK )
         {
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_RANDOM_ERROR_CODE;
@@ -2408,7 +4726,8 @@ IceHandleStunPacketResult_t Ice_HandleTurnRefreshSuccessResponse( IceContext_t *
         if( pLocalCandidate->state == ICE_CANDIDATE_STATE_RELEASING )
         {
             /* Set state to released regardless of the response we received. */
-            pLocalCandidate->state = ICE_CANDIDATE_STATE_INVALID;
+            Ice_ReleaseCandidate( pContext,
+                                  pLocalCandidate );
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_TURN_SESSION_TERMINATED;
         }
     }
@@ -2462,8 +4781,10 @@ IceHandleStunPacketResult_t Ice_HandleTurnRefreshErrorResponse( IceContext_t * p
     if( handleStunPacketResult == ICE_HANDLE_STUN_PACKET_RESULT_OK )
     {
         /* Regenerate Transaction ID for next request. */
-        iceResult = pContext->cryptoFunctions.randomFxn( &( pLocalCandidate->transactionId[ 0 ] ),
-                                                         STUN_HEADER_TRANSACTION_ID_LENGTH );
+        iceResult = Ice_GenerateRandom( pContext,
+                                        &( pLocalCandidate->transactionId[ 0 ] ),
+                                        STUN_HEADER_TRANSACTION_ID_LENGTH );
+        Ice_InvalidateRequestCache( pLocalCandidate->pRequestCache );
         if( iceResult != ICE_RESULT_OK )
         {
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_RANDOM_ERROR_CODE;
@@ -2475,7 +4796,8 @@ IceHandleStunPacketResult_t Ice_HandleTurnRefreshErrorResponse( IceContext_t * p
         if( pLocalCandidate->state == ICE_CANDIDATE_STATE_RELEASING )
         {
             /* Set state to released regardless of the response we received. */
-            pLocalCandidate->state = ICE_CANDIDATE_STATE_INVALID;
+            Ice_ReleaseCandidate( pContext,
+                                  pLocalCandidate );
             handleStunPacketResult = ICE_HANDLE_STUN_PACKET_RESULT_TURN_SESSION_TERMINATED;
         }
     }
@@ -0,0 +1,1110 @@
+/* Standard includes. */
+#include <string.h>
+
+/* API includes. */
+#include "ice_crypto.h"
+
+/*
+ * The hardware accelerated SHA-1 implementations are only compiled with
+ * GCC-compatible compilers because they rely on target attributes (x86) and
+ * on the ACLE feature macros (ARMv8). The x86 implementation is always
+ * compiled in and enabled at runtime using CPUID. The ARMv8 implementation is
+ * compiled in when the compiler targets the ARMv8 cryptographic extension and
+ * enabled at runtime using the Linux auxiliary vector.
+ */
+#if !defined( ICE_CRYPTO_DISABLE_HW_ACCELERATION ) && defined( __GNUC__ ) && \
+    ( defined( __x86_64__ ) || defined( __i386__ ) )
+    #define ICE_CRYPTO_X86_SHA_NI_ENABLED    ( 1 )
+    #include <cpuid.h>
+    #include <immintrin.h>
+#endif
+
+#if !defined( ICE_CRYPTO_DISABLE_HW_ACCELERATION ) && defined( __GNUC__ ) && \
+    defined( __aarch64__ ) && defined( __linux__ ) &&                        \
+    ( defined( __ARM_FEATURE_CRYPTO ) || defined( __ARM_FEATURE_SHA2 ) )
+    #define ICE_CRYPTO_ARMV8_SHA1_ENABLED    ( 1 )
+    #include <sys/auxv.h>
+    #include <arm_neon.h>
+    #ifndef HWCAP_SHA1
+        #define HWCAP_SHA1    ( 1 << 5 )
+    #endif
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+#define ICE_CRYPTO_ROTATE_LEFT( x, n )    ( ( ( x ) << ( n ) ) | ( ( x ) >> ( 32 - ( n ) ) ) )
+
+#define ICE_CRYPTO_READ_UINT32_BE( p )                                    \
+    ( ( ( uint32_t ) ( p )[ 0 ] << 24 ) | ( ( uint32_t ) ( p )[ 1 ] << 16 ) | \
+      ( ( uint32_t ) ( p )[ 2 ] << 8 ) | ( ( uint32_t ) ( p )[ 3 ] ) )
+
+#define ICE_CRYPTO_READ_UINT32_LE( p )                                    \
+    ( ( ( uint32_t ) ( p )[ 3 ] << 24 ) | ( ( uint32_t ) ( p )[ 2 ] << 16 ) | \
+      ( ( uint32_t ) ( p )[ 1 ] << 8 ) | ( ( uint32_t ) ( p )[ 0 ] ) )
+
+#define ICE_CRYPTO_HMAC_INNER_PAD    ( 0x36 )
+#define ICE_CRYPTO_HMAC_OUTER_PAD    ( 0x5C )
+
+/* The length field appended to the last block is 8 bytes for both SHA-1 and
+ * MD5. */
+#define ICE_CRYPTO_LENGTH_FIELD_SIZE    ( 8 )
+
+/* The selected SHA-1 implementation is published with a single pointer store
+ * so that concurrent first use and IceCrypto_SetSha1Implementation never
+ * observe a torn selection. Compilers without the GCC atomic builtins fall
+ * back to plain accesses - call IceCrypto_SetSha1Implementation before
+ * starting any thread there. */
+#if defined( __GNUC__ )
+    #define ICE_CRYPTO_ATOMIC_LOAD_POINTER( ppValue )            __atomic_load_n( ( ppValue ), __ATOMIC_ACQUIRE )
+    #define ICE_CRYPTO_ATOMIC_STORE_POINTER( ppValue, pValue )   __atomic_store_n( ( ppValue ), ( pValue ), __ATOMIC_RELEASE )
+#else
+    #define ICE_CRYPTO_ATOMIC_LOAD_POINTER( ppValue )            ( *( ppValue ) )
+    #define ICE_CRYPTO_ATOMIC_STORE_POINTER( ppValue, pValue )   ( *( ppValue ) = ( pValue ) )
+#endif
+
+typedef void ( * IceCryptoSha1BlockFunction_t )( uint32_t * pState,
+                                                 const uint8_t * pBlocks,
+                                                 size_t numBlocks );
+
+typedef struct IceCryptoSha1Selection
+{
+    IceCryptoSha1BlockFunction_t blockFunction;
+    IceCryptoSha1Implementation_t implementation;
+} IceCryptoSha1Selection_t;
+
+/*----------------------------------------------------------------------------*/
+
+static const uint32_t md5RoundConstants[ 64 ] =
+{
+    0xD76AA478, 0xE8C7B756, 0x242070DB, 0xC1BDCEEE,
+    0xF57C0FAF, 0x4787C62A, 0xA8304613, 0xFD469501,
+    0x698098D8, 0x8B44F7AF, 0xFFFF5BB1, 0x895CD7BE,
+    0x6B901122, 0xFD987193, 0xA679438E, 0x49B40821,
+    0xF61E2562, 0xC040B340, 0x265E5A51, 0xE9B6C7AA,
+    0xD62F105D, 0x02441453, 0xD8A1E681, 0xE7D3FBC8,
+    0x21E1CDE6, 0xC33707D6, 0xF4D50D87, 0x455A14ED,
+    0xA9E3E905, 0xFCEFA3F8, 0x676F02D9, 0x8D2A4C8A,
+    0xFFFA3942, 0x8771F681, 0x6D9D6122, 0xFDE5380C,
+    0xA4BEEA44, 0x4BDECFA9, 0xF6BB4B60, 0xBEBFBC70,
+    0x289B7EC6, 0xEAA127FA, 0xD4EF3085, 0x04881D05,
+    0xD9D4D039, 0xE6DB99E5, 0x1FA27CF8, 0xC4AC5665,
+    0xF4292244, 0x432AFF97, 0xAB9423A7, 0xFC93A039,
+    0x655B59C3, 0x8F0CCC92, 0xFFEFF47D, 0x85845DD1,
+    0x6FA87E4F, 0xFE2CE6E0, 0xA3014314, 0x4E0811A1,
+    0xF7537E82, 0xBD3AF235, 0x2AD7D2BB, 0xEB86D391
+};
+
+static const uint8_t md5RoundShifts[ 16 ] =
+{
+    7, 12, 17, 22,
+    5, 9, 14, 20,
+    4, 11, 16, 23,
+    6, 10, 15, 21
+};
+
+/*----------------------------------------------------------------------------*/
+
+static void Sha1ProcessBlocksPortable( uint32_t * pState,
+                                       const uint8_t * pBlocks,
+                                       size_t numBlocks )
+{
+    size_t i, j;
+    uint32_t w[ 16 ];
+    uint32_t a, b, c, d, e, f, k, temp;
+
+    for( i = 0; i < numBlocks; i++ )
+    {
+        for( j = 0; j < 16; j++ )
+        {
+            w[ j ] = ICE_CRYPTO_READ_UINT32_BE( &( pBlocks[ ( i * ICE_CRYPTO_SHA1_BLOCK_LENGTH ) + ( j * 4 ) ] ) );
+        }
+
+        a = pState[ 0 ];
+        b = pState[ 1 ];
+        c = pState[ 2 ];
+        d = pState[ 3 ];
+        e = pState[ 4 ];
+
+        for( j = 0; j < 80; j++ )
+        {
+            /* The message schedule is kept in a 16 word circular buffer. */
+            if( j >= 16 )
+            {
+                temp = w[ ( j + 13 ) & 15 ] ^ w[ ( j + 8 ) & 15 ] ^ w[ ( j + 2 ) & 15 ] ^ w[ j & 15 ];
+                w[ j & 15 ] = ICE_CRYPTO_ROTATE_LEFT( temp, 1 );
+            }
+
+            if( j < 20 )
+            {
+                f = ( b & c ) | ( ( ~b ) & d );
+                k = 0x5A827999;
+            }
+            else if( j < 40 )
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if( j < 60 )
+            {
+                f = ( b & c ) | ( b & d ) | ( c & d );
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+
+            temp = ICE_CRYPTO_ROTATE_LEFT( a, 5 ) + f + e + k + w[ j & 15 ];
+            e = d;
+            d = c;
+            c = ICE_CRYPTO_ROTATE_LEFT( b, 30 );
+            b = a;
+            a = temp;
+        }
+
+        pState[ 0 ] += a;
+        pState[ 1 ] += b;
+        pState[ 2 ] += c;
+        pState[ 3 ] += d;
+        pState[ 4 ] += e;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* The hardware implementations are excluded from coverage as they are only
+ * exercised on hosts with the corresponding CPU support. */
+/* LCOV_EXCL_START */
+#if defined( ICE_CRYPTO_X86_SHA_NI_ENABLED )
+
+static uint8_t Sha1IsX86ShaNiSupported( void )
+{
+    uint8_t isSupported = 0;
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    /* SHA-NI (CPUID.7.0:EBX[29]) together with SSSE3 (CPUID.1:ECX[9]) and
+     * SSE4.1 (CPUID.1:ECX[19]) used for byte shuffling and extraction. */
+    if( ( __get_cpuid( 1, &( eax ), &( ebx ), &( ecx ), &( edx ) ) != 0 ) &&
+        ( ( ecx & ( 1U << 9 ) ) != 0 ) &&
+        ( ( ecx & ( 1U << 19 ) ) != 0 ) &&
+        ( __get_cpuid_count( 7, 0, &( eax ), &( ebx ), &( ecx ), &( edx ) ) != 0 ) &&
+        ( ( ebx & ( 1U << 29 ) ) != 0 ) )
+    {
+        isSupported = 1;
+    }
+
+    return isSupported;
+}
+
+/*----------------------------------------------------------------------------*/
+
+__attribute__( ( target( "sha,ssse3,sse4.1" ) ) )
+static inline __m128i Sha1X86ShaNiRounds( __m128i abcd,
+                                          __m128i e,
+                                          size_t roundGroup )
+{
+    __m128i result;
+
+    /* The round function selector must be an immediate. */
+    switch( roundGroup / 5 )
+    {
+        case 0:
+            result = _mm_sha1rnds4_epu32( abcd, e, 0 );
+            break;
+
+        case 1:
+            result = _mm_sha1rnds4_epu32( abcd, e, 1 );
+            break;
+
+        case 2:
+            result = _mm_sha1rnds4_epu32( abcd, e, 2 );
+            break;
+
+        default:
+            result = _mm_sha1rnds4_epu32( abcd, e, 3 );
+            break;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+__attribute__( ( target( "sha,ssse3,sse4.1" ) ) )
+static void Sha1ProcessBlocksX86ShaNi( uint32_t * pState,
+                                       const uint8_t * pBlocks,
+                                       size_t numBlocks )
+{
+    size_t i, j;
+    __m128i abcd, abcdSaved, e0, e0Saved, e1, msg[ 4 ];
+    const __m128i byteSwapMask = _mm_set_epi64x( 0x0001020304050607LL, 0x08090A0B0C0D0E0FLL );
+
+    /* The SHA-NI instructions keep A in the most significant lane. */
+    abcd = _mm_loadu_si128( ( const __m128i * ) &( pState[ 0 ] ) );
+    abcd = _mm_shuffle_epi32( abcd, 0x1B );
+    e0 = _mm_set_epi32( ( int ) pState[ 4 ], 0, 0, 0 );
+
+    for( i = 0; i < numBlocks; i++ )
+    {
+        abcdSaved = abcd;
+        e0Saved = e0;
+
+        for( j = 0; j < 4; j++ )
+        {
+            msg[ j ] = _mm_loadu_si128( ( const __m128i * ) &( pBlocks[ ( i * ICE_CRYPTO_SHA1_BLOCK_LENGTH ) + ( j * 16 ) ] ) );
+            msg[ j ] = _mm_shuffle_epi8( msg[ j ], byteSwapMask );
+        }
+
+        /* 20 groups of 4 rounds. msg[ j & 3 ] holds the schedule words for
+         * group j, computed from the previous 4 groups. */
+        e0 = _mm_add_epi32( e0, msg[ 0 ] );
+        e1 = abcd;
+        abcd = Sha1X86ShaNiRounds( abcd, e0, 0 );
+
+        for( j = 1; j < 20; j++ )
+        {
+            if( j >= 4 )
+            {
+                msg[ j & 3 ] = _mm_sha1msg2_epu32( _mm_xor_si128( _mm_sha1msg1_epu32( msg[ j & 3 ],
+                                                                                      msg[ ( j + 1 ) & 3 ] ),
+                                                                  msg[ ( j + 2 ) & 3 ] ),
+                                                   msg[ ( j + 3 ) & 3 ] );
+            }
+
+            e0 = _mm_sha1nexte_epu32( e1, msg[ j & 3 ] );
+            e1 = abcd;
+            abcd = Sha1X86ShaNiRounds( abcd, e0, j );
+        }
+
+        e0 = _mm_sha1nexte_epu32( e1, e0Saved );
+        abcd = _mm_add_epi32( abcd, abcdSaved );
+    }
+
+    abcd = _mm_shuffle_epi32( abcd, 0x1B );
+    _mm_storeu_si128( ( __m128i * ) &( pState[ 0 ] ), abcd );
+    pState[ 4 ] = ( uint32_t ) _mm_extract_epi32( e0, 3 );
+}
+
+#endif /* #if defined( ICE_CRYPTO_X86_SHA_NI_ENABLED ) */
+
+/*----------------------------------------------------------------------------*/
+
+#if defined( ICE_CRYPTO_ARMV8_SHA1_ENABLED )
+
+static uint8_t Sha1IsArmv8Sha1Supported( void )
+{
+    uint8_t isSupported = 0;
+
+    if( ( getauxval( AT_HWCAP ) & HWCAP_SHA1 ) != 0 )
+    {
+        isSupported = 1;
+    }
+
+    return isSupported;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void Sha1ProcessBlocksArmv8( uint32_t * pState,
+                                    const uint8_t * pBlocks,
+                                    size_t numBlocks )
+{
+    size_t i, j;
+    uint32x4_t abcd, abcdSaved, wk, msg[ 4 ];
+    uint32_t e0, e0Saved, e1;
+    static const uint32_t roundConstants[ 4 ] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+
+    abcd = vld1q_u32( &( pState[ 0 ] ) );
+    e0 = pState[ 4 ];
+
+    for( i = 0; i < numBlocks; i++ )
+    {
+        abcdSaved = abcd;
+        e0Saved = e0;
+
+        for( j = 0; j < 4; j++ )
+        {
+            msg[ j ] = vreinterpretq_u32_u8( vrev32q_u8( vld1q_u8( &( pBlocks[ ( i * ICE_CRYPTO_SHA1_BLOCK_LENGTH ) + ( j * 16 ) ] ) ) ) );
+        }
+
+        /* 20 groups of 4 rounds. msg[ j & 3 ] holds the schedule words for
+         * group j, computed from the previous 4 groups. */
+        for( j = 0; j < 20; j++ )
+        {
+            if( j >= 4 )
+            {
+                msg[ j & 3 ] = vsha1su1q_u32( vsha1su0q_u32( msg[ j & 3 ],
+                                                             msg[ ( j + 1 ) & 3 ],
+                                                             msg[ ( j + 2 ) & 3 ] ),
+                                              msg[ ( j + 3 ) & 3 ] );
+            }
+
+            wk = vaddq_u32( msg[ j & 3 ], vdupq_n_u32( roundConstants[ j / 5 ] ) );
+            e1 = vsha1h_u32( vgetq_lane_u32( abcd, 0 ) );
+
+            if( j < 5 )
+            {
+                abcd = vsha1cq_u32( abcd, e0, wk );
+            }
+            else if( ( j >= 10 ) && ( j < 15 ) )
+            {
+                abcd = vsha1mq_u32( abcd, e0, wk );
+            }
+            else
+            {
+                abcd = vsha1pq_u32( abcd, e0, wk );
+            }
+
+            e0 = e1;
+        }
+
+        e0 += e0Saved;
+        abcd = vaddq_u32( abcd, abcdSaved );
+    }
+
+    vst1q_u32( &( pState[ 0 ] ), abcd );
+    pState[ 4 ] = e0;
+}
+
+#endif /* #if defined( ICE_CRYPTO_ARMV8_SHA1_ENABLED ) */
+/* LCOV_EXCL_STOP */
+
+/*----------------------------------------------------------------------------*/
+
+static const IceCryptoSha1Selection_t sha1SelectionPortable =
+{
+    Sha1ProcessBlocksPortable, ICE_CRYPTO_SHA1_IMPLEMENTATION_PORTABLE
+};
+
+#if defined( ICE_CRYPTO_X86_SHA_NI_ENABLED )
+    static const IceCryptoSha1Selection_t sha1SelectionX86ShaNi =
+    {
+        Sha1ProcessBlocksX86ShaNi, ICE_CRYPTO_SHA1_IMPLEMENTATION_X86_SHA_NI
+    };
+#endif
+
+#if defined( ICE_CRYPTO_ARMV8_SHA1_ENABLED )
+    static const IceCryptoSha1Selection_t sha1SelectionArmv8 =
+    {
+        Sha1ProcessBlocksArmv8, ICE_CRYPTO_SHA1_IMPLEMENTATION_ARMV8_SHA1
+    };
+#endif
+
+/* Selected on first use, or explicitly by IceCrypto_SetSha1Implementation.
+ * Only ever points to one of the constant selections above. */
+static const IceCryptoSha1Selection_t * pSha1Selection = NULL;
+
+/*----------------------------------------------------------------------------*/
+
+static const IceCryptoSha1Selection_t * Sha1GetSelection( void )
+{
+    const IceCryptoSha1Selection_t * pSelection = ICE_CRYPTO_ATOMIC_LOAD_POINTER( &( pSha1Selection ) );
+
+    if( pSelection == NULL )
+    {
+        /* Automatic selection is idempotent, so threads racing here all
+         * store the same pointer. */
+        ( void ) IceCrypto_SetSha1Implementation( ICE_CRYPTO_SHA1_IMPLEMENTATION_AUTO );
+        pSelection = ICE_CRYPTO_ATOMIC_LOAD_POINTER( &( pSha1Selection ) );
+    }
+
+    return pSelection;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void IceCrypto_Zeroize( void * pBuffer,
+                        size_t bufferLength )
+{
+    volatile uint8_t * pBytes = ( volatile uint8_t * ) pBuffer;
+    size_t i;
+
+    for( i = 0; i < bufferLength; i++ )
+    {
+        pBytes[ i ] = 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void Md5ProcessBlocks( uint32_t * pState,
+                              const uint8_t * pBlocks,
+                              size_t numBlocks )
+{
+    size_t i, j, g;
+    uint32_t m[ 16 ];
+    uint32_t a, b, c, d, f;
+
+    for( i = 0; i < numBlocks; i++ )
+    {
+        for( j = 0; j < 16; j++ )
+        {
+            m[ j ] = ICE_CRYPTO_READ_UINT32_LE( &( pBlocks[ ( i * ICE_CRYPTO_MD5_BLOCK_LENGTH ) + ( j * 4 ) ] ) );
+        }
+
+        a = pState[ 0 ];
+        b = pState[ 1 ];
+        c = pState[ 2 ];
+        d = pState[ 3 ];
+
+        for( j = 0; j < 64; j++ )
+        {
+            if( j < 16 )
+            {
+                f = ( b & c ) | ( ( ~b ) & d );
+                g = j;
+            }
+            else if( j < 32 )
+            {
+                f = ( d & b ) | ( ( ~d ) & c );
+                g = ( ( 5 * j ) + 1 ) & 15;
+            }
+            else if( j < 48 )
+            {
+                f = b ^ c ^ d;
+                g = ( ( 3 * j ) + 5 ) & 15;
+            }
+            else
+            {
+                f = c ^ ( b | ( ~d ) );
+                g = ( 7 * j ) & 15;
+            }
+
+            f = f + a + md5RoundConstants[ j ] + m[ g ];
+            a = d;
+            d = c;
+            c = b;
+            b = b + ICE_CRYPTO_ROTATE_LEFT( f, md5RoundShifts[ ( ( j >> 4 ) << 2 ) | ( j & 3 ) ] );
+        }
+
+        pState[ 0 ] += a;
+        pState[ 1 ] += b;
+        pState[ 2 ] += c;
+        pState[ 3 ] += d;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_SetSha1Implementation( IceCryptoSha1Implementation_t implementation )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    const IceCryptoSha1Selection_t * pSelection = NULL;
+
+    #if defined( ICE_CRYPTO_X86_SHA_NI_ENABLED )
+        if( ( ( implementation == ICE_CRYPTO_SHA1_IMPLEMENTATION_AUTO ) ||
+              ( implementation == ICE_CRYPTO_SHA1_IMPLEMENTATION_X86_SHA_NI ) ) &&
+            ( Sha1IsX86ShaNiSupported() != 0 ) )
+        {
+            pSelection = &( sha1SelectionX86ShaNi );
+        }
+    #endif
+
+    #if defined( ICE_CRYPTO_ARMV8_SHA1_ENABLED )
+        if( ( ( implementation == ICE_CRYPTO_SHA1_IMPLEMENTATION_AUTO ) ||
+              ( implementation == ICE_CRYPTO_SHA1_IMPLEMENTATION_ARMV8_SHA1 ) ) &&
+            ( Sha1IsArmv8Sha1Supported() != 0 ) )
+        {
+            pSelection = &( sha1SelectionArmv8 );
+        }
+    #endif
+
+    if( pSelection == NULL )
+    {
+        if( ( implementation == ICE_CRYPTO_SHA1_IMPLEMENTATION_AUTO ) ||
+            ( implementation == ICE_CRYPTO_SHA1_IMPLEMENTATION_PORTABLE ) )
+        {
+            pSelection = &( sha1SelectionPortable );
+        }
+        else
+        {
+            result = ICE_RESULT_CRYPTO_IMPLEMENTATION_NOT_SUPPORTED;
+        }
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        ICE_CRYPTO_ATOMIC_STORE_POINTER( &( pSha1Selection ),
+                                         pSelection );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceCryptoSha1Implementation_t IceCrypto_GetSha1Implementation( void )
+{
+    return Sha1GetSelection()->implementation;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_Sha1Init( IceCryptoSha1Context_t * pSha1Context )
+{
+    IceResult_t result = ICE_RESULT_OK;
+
+    if( pSha1Context == NULL )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        pSha1Context->state[ 0 ] = 0x67452301;
+        pSha1Context->state[ 1 ] = 0xEFCDAB89;
+        pSha1Context->state[ 2 ] = 0x98BADCFE;
+        pSha1Context->state[ 3 ] = 0x10325476;
+        pSha1Context->state[ 4 ] = 0xC3D2E1F0;
+        pSha1Context->totalLength = 0;
+        pSha1Context->blockLength = 0;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_Sha1Update( IceCryptoSha1Context_t * pSha1Context,
+                                  const uint8_t * pBuffer,
+                                  size_t bufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    IceCryptoSha1BlockFunction_t blockFunction;
+    size_t copyLength, numBlocks;
+
+    if( ( pSha1Context == NULL ) ||
+        ( ( pBuffer == NULL ) && ( bufferLength != 0 ) ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( ( result == ICE_RESULT_OK ) && ( bufferLength != 0 ) )
+    {
+        blockFunction = Sha1GetSelection()->blockFunction;
+        pSha1Context->totalLength += bufferLength;
+
+        /* Complete a previously buffered partial block first. */
+        if( pSha1Context->blockLength != 0 )
+        {
+            copyLength = ICE_CRYPTO_SHA1_BLOCK_LENGTH - pSha1Context->blockLength;
+            copyLength = ( bufferLength < copyLength ) ? bufferLength : copyLength;
+
+            memcpy( &( pSha1Context->block[ pSha1Context->blockLength ] ),
+                    pBuffer,
+                    copyLength );
+            pSha1Context->blockLength += copyLength;
+            pBuffer = &( pBuffer[ copyLength ] );
+            bufferLength -= copyLength;
+
+            if( pSha1Context->blockLength == ICE_CRYPTO_SHA1_BLOCK_LENGTH )
+            {
+                blockFunction( &( pSha1Context->state[ 0 ] ),
+                               &( pSha1Context->block[ 0 ] ),
+                               1 );
+                pSha1Context->blockLength = 0;
+            }
+        }
+
+        /* Hash all complete blocks directly from the input. */
+        numBlocks = bufferLength / ICE_CRYPTO_SHA1_BLOCK_LENGTH;
+
+        if( numBlocks != 0 )
+        {
+            blockFunction( &( pSha1Context->state[ 0 ] ),
+                           pBuffer,
+                           numBlocks );
+            pBuffer = &( pBuffer[ numBlocks * ICE_CRYPTO_SHA1_BLOCK_LENGTH ] );
+            bufferLength -= numBlocks * ICE_CRYPTO_SHA1_BLOCK_LENGTH;
+        }
+
+        if( bufferLength != 0 )
+        {
+            memcpy( &( pSha1Context->block[ 0 ] ),
+                    pBuffer,
+                    bufferLength );
+            pSha1Context->blockLength = bufferLength;
+        }
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_Sha1Final( IceCryptoSha1Context_t * pSha1Context,
+                                 uint8_t * pOutputBuffer,
+                                 uint16_t * pOutputBufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    IceCryptoSha1BlockFunction_t blockFunction;
+    uint64_t totalBits;
+    size_t i;
+
+    if( ( pSha1Context == NULL ) ||
+        ( pOutputBuffer == NULL ) ||
+        ( pOutputBufferLength == NULL ) ||
+        ( *pOutputBufferLength < ICE_CRYPTO_SHA1_DIGEST_LENGTH ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        blockFunction = Sha1GetSelection()->blockFunction;
+        totalBits = pSha1Context->totalLength * 8;
+
+        pSha1Context->block[ pSha1Context->blockLength ] = 0x80;
+        pSha1Context->blockLength += 1;
+
+        /* Not enough room for the length field - pad out this block. */
+        if( pSha1Context->blockLength > ( ICE_CRYPTO_SHA1_BLOCK_LENGTH - ICE_CRYPTO_LENGTH_FIELD_SIZE ) )
+        {
+            memset( &( pSha1Context->block[ pSha1Context->blockLength ] ),
+                    0,
+                    ICE_CRYPTO_SHA1_BLOCK_LENGTH - pSha1Context->blockLength );
+            blockFunction( &( pSha1Context->state[ 0 ] ),
+                           &( pSha1Context->block[ 0 ] ),
+                           1 );
+            pSha1Context->blockLength = 0;
+        }
+
+        memset( &( pSha1Context->block[ pSha1Context->blockLength ] ),
+                0,
+                ICE_CRYPTO_SHA1_BLOCK_LENGTH - ICE_CRYPTO_LENGTH_FIELD_SIZE - pSha1Context->blockLength );
+
+        for( i = 0; i < ICE_CRYPTO_LENGTH_FIELD_SIZE; i++ )
+        {
+            pSha1Context->block[ ICE_CRYPTO_SHA1_BLOCK_LENGTH - 1 - i ] = ( uint8_t ) ( totalBits >> ( 8 * i ) );
+        }
+
+        blockFunction( &( pSha1Context->state[ 0 ] ),
+                       &( pSha1Context->block[ 0 ] ),
+                       1 );
+
+        for( i = 0; i < ICE_CRYPTO_SHA1_DIGEST_LENGTH; i++ )
+        {
+            pOutputBuffer[ i ] = ( uint8_t ) ( pSha1Context->state[ i / 4 ] >> ( 24 - ( 8 * ( i % 4 ) ) ) );
+        }
+
+        *pOutputBufferLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH;
+
+        /* The block may hold key material, e.g. the HMAC key pads. */
+        IceCrypto_Zeroize( pSha1Context,
+                           sizeof( IceCryptoSha1Context_t ) );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_Md5Init( IceCryptoMd5Context_t * pMd5Context )
+{
+    IceResult_t result = ICE_RESULT_OK;
+
+    if( pMd5Context == NULL )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        pMd5Context->state[ 0 ] = 0x67452301;
+        pMd5Context->state[ 1 ] = 0xEFCDAB89;
+        pMd5Context->state[ 2 ] = 0x98BADCFE;
+        pMd5Context->state[ 3 ] = 0x10325476;
+        pMd5Context->totalLength = 0;
+        pMd5Context->blockLength = 0;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_Md5Update( IceCryptoMd5Context_t * pMd5Context,
+                                 const uint8_t * pBuffer,
+                                 size_t bufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    size_t copyLength, numBlocks;
+
+    if( ( pMd5Context == NULL ) ||
+        ( ( pBuffer == NULL ) && ( bufferLength != 0 ) ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( ( result == ICE_RESULT_OK ) && ( bufferLength != 0 ) )
+    {
+        pMd5Context->totalLength += bufferLength;
+
+        /* Complete a previously buffered partial block first. */
+        if( pMd5Context->blockLength != 0 )
+        {
+            copyLength = ICE_CRYPTO_MD5_BLOCK_LENGTH - pMd5Context->blockLength;
+            copyLength = ( bufferLength < copyLength ) ? bufferLength : copyLength;
+
+            memcpy( &( pMd5Context->block[ pMd5Context->blockLength ] ),
+                    pBuffer,
+                    copyLength );
+            pMd5Context->blockLength += copyLength;
+            pBuffer = &( pBuffer[ copyLength ] );
+            bufferLength -= copyLength;
+
+            if( pMd5Context->blockLength == ICE_CRYPTO_MD5_BLOCK_LENGTH )
+            {
+                Md5ProcessBlocks( &( pMd5Context->state[ 0 ] ),
+                                  &( pMd5Context->block[ 0 ] ),
+                                  1 );
+                pMd5Context->blockLength = 0;
+            }
+        }
+
+        /* Hash all complete blocks directly from the input. */
+        numBlocks = bufferLength / ICE_CRYPTO_MD5_BLOCK_LENGTH;
+
+        if( numBlocks != 0 )
+        {
+            Md5ProcessBlocks( &( pMd5Context->state[ 0 ] ),
+                              pBuffer,
+                              numBlocks );
+            pBuffer = &( pBuffer[ numBlocks * ICE_CRYPTO_MD5_BLOCK_LENGTH ] );
+            bufferLength -= numBlocks * ICE_CRYPTO_MD5_BLOCK_LENGTH;
+        }
+
+        if( bufferLength != 0 )
+        {
+            memcpy( &( pMd5Context->block[ 0 ] ),
+                    pBuffer,
+                    bufferLength );
+            pMd5Context->blockLength = bufferLength;
+        }
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_Md5Final( IceCryptoMd5Context_t * pMd5Context,
+                                uint8_t * pOutputBuffer,
+                                uint16_t * pOutputBufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    uint64_t totalBits;
+    size_t i;
+
+    if( ( pMd5Context == NULL ) ||
+        ( pOutputBuffer == NULL ) ||
+        ( pOutputBufferLength == NULL ) ||
+        ( *pOutputBufferLength < ICE_CRYPTO_MD5_DIGEST_LENGTH ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        totalBits = pMd5Context->totalLength * 8;
+
+        pMd5Context->block[ pMd5Context->blockLength ] = 0x80;
+        pMd5Context->blockLength += 1;
+
+        /* Not enough room for the length field - pad out this block. */
+        if( pMd5Context->blockLength > ( ICE_CRYPTO_MD5_BLOCK_LENGTH - ICE_CRYPTO_LENGTH_FIELD_SIZE ) )
+        {
+            memset( &( pMd5Context->block[ pMd5Context->blockLength ] ),
+                    0,
+                    ICE_CRYPTO_MD5_BLOCK_LENGTH - pMd5Context->blockLength );
+            Md5ProcessBlocks( &( pMd5Context->state[ 0 ] ),
+                              &( pMd5Context->block[ 0 ] ),
+                              1 );
+            pMd5Context->blockLength = 0;
+        }
+
+        memset( &( pMd5Context->block[ pMd5Context->blockLength ] ),
+                0,
+                ICE_CRYPTO_MD5_BLOCK_LENGTH - ICE_CRYPTO_LENGTH_FIELD_SIZE - pMd5Context->blockLength );
+
+        /* MD5 appends the length in little endian. */
+        for( i = 0; i < ICE_CRYPTO_LENGTH_FIELD_SIZE; i++ )
+        {
+            pMd5Context->block[ ICE_CRYPTO_MD5_BLOCK_LENGTH - ICE_CRYPTO_LENGTH_FIELD_SIZE + i ] = ( uint8_t ) ( totalBits >> ( 8 * i ) );
+        }
+
+        Md5ProcessBlocks( &( pMd5Context->state[ 0 ] ),
+                          &( pMd5Context->block[ 0 ] ),
+                          1 );
+
+        for( i = 0; i < ICE_CRYPTO_MD5_DIGEST_LENGTH; i++ )
+        {
+            pOutputBuffer[ i ] = ( uint8_t ) ( pMd5Context->state[ i / 4 ] >> ( 8 * ( i % 4 ) ) );
+        }
+
+        *pOutputBufferLength = ICE_CRYPTO_MD5_DIGEST_LENGTH;
+
+        /* The block may hold key material, e.g. username:realm:password. */
+        IceCrypto_Zeroize( pMd5Context,
+                           sizeof( IceCryptoMd5Context_t ) );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_HmacSha1Init( IceCryptoHmacSha1Context_t * pHmacContext,
+                                    const uint8_t * pPassword,
+                                    size_t passwordLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    uint8_t pad[ ICE_CRYPTO_SHA1_BLOCK_LENGTH ];
+    uint16_t digestLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH;
+    size_t i;
+
+    if( ( pHmacContext == NULL ) ||
+        ( ( pPassword == NULL ) && ( passwordLength != 0 ) ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        memset( &( pHmacContext->key[ 0 ] ),
+                0,
+                sizeof( pHmacContext->key ) );
+
+        /* Keys longer than the block size are hashed first. */
+        if( passwordLength > ICE_CRYPTO_SHA1_BLOCK_LENGTH )
+        {
+            ( void ) IceCrypto_Sha1Init( &( pHmacContext->sha1Context ) );
+            ( void ) IceCrypto_Sha1Update( &( pHmacContext->sha1Context ),
+                                           pPassword,
+                                           passwordLength );
+            ( void ) IceCrypto_Sha1Final( &( pHmacContext->sha1Context ),
+                                          &( pHmacContext->key[ 0 ] ),
+                                          &( digestLength ) );
+        }
+        else if( passwordLength != 0 )
+        {
+            memcpy( &( pHmacContext->key[ 0 ] ),
+                    pPassword,
+                    passwordLength );
+        }
+        else
+        {
+            /* Empty key - key stays all zeros. */
+        }
+
+        /* Inner hash: SHA1( ( key ^ ipad ) || message ). */
+        for( i = 0; i < ICE_CRYPTO_SHA1_BLOCK_LENGTH; i++ )
+        {
+            pad[ i ] = pHmacContext->key[ i ] ^ ICE_CRYPTO_HMAC_INNER_PAD;
+        }
+
+        ( void ) IceCrypto_Sha1Init( &( pHmacContext->sha1Context ) );
+        ( void ) IceCrypto_Sha1Update( &( pHmacContext->sha1Context ),
+                                       &( pad[ 0 ] ),
+                                       ICE_CRYPTO_SHA1_BLOCK_LENGTH );
+
+        IceCrypto_Zeroize( &( pad[ 0 ] ),
+                           sizeof( pad ) );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_HmacSha1Update( IceCryptoHmacSha1Context_t * pHmacContext,
+                                      const uint8_t * pBuffer,
+                                      size_t bufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+
+    if( pHmacContext == NULL )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = IceCrypto_Sha1Update( &( pHmacContext->sha1Context ),
+                                       pBuffer,
+                                       bufferLength );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_HmacSha1Final( IceCryptoHmacSha1Context_t * pHmacContext,
+                                     uint8_t * pOutputBuffer,
+                                     uint16_t * pOutputBufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    uint8_t pad[ ICE_CRYPTO_SHA1_BLOCK_LENGTH ];
+    uint8_t innerDigest[ ICE_CRYPTO_SHA1_DIGEST_LENGTH ];
+    uint16_t digestLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH;
+    size_t i;
+
+    if( ( pHmacContext == NULL ) ||
+        ( pOutputBuffer == NULL ) ||
+        ( pOutputBufferLength == NULL ) ||
+        ( *pOutputBufferLength < ICE_CRYPTO_SHA1_DIGEST_LENGTH ) )
+    {
+        result = ICE_RESULT_BAD_PARAM;
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        ( void ) IceCrypto_Sha1Final( &( pHmacContext->sha1Context ),
+                                      &( innerDigest[ 0 ] ),
+                                      &( digestLength ) );
+
+        /* Outer hash: SHA1( ( key ^ opad ) || inner hash ). */
+        for( i = 0; i < ICE_CRYPTO_SHA1_BLOCK_LENGTH; i++ )
+        {
+            pad[ i ] = pHmacContext->key[ i ] ^ ICE_CRYPTO_HMAC_OUTER_PAD;
+        }
+
+        ( void ) IceCrypto_Sha1Init( &( pHmacContext->sha1Context ) );
+        ( void ) IceCrypto_Sha1Update( &( pHmacContext->sha1Context ),
+                                       &( pad[ 0 ] ),
+                                       ICE_CRYPTO_SHA1_BLOCK_LENGTH );
+        ( void ) IceCrypto_Sha1Update( &( pHmacContext->sha1Context ),
+                                       &( innerDigest[ 0 ] ),
+                                       ICE_CRYPTO_SHA1_DIGEST_LENGTH );
+        result = IceCrypto_Sha1Final( &( pHmacContext->sha1Context ),
+                                      pOutputBuffer,
+                                      pOutputBufferLength );
+
+        /* The context cannot be used after Final, so drop the key. */
+        IceCrypto_Zeroize( &( pad[ 0 ] ),
+                           sizeof( pad ) );
+        IceCrypto_Zeroize( &( pHmacContext->key[ 0 ] ),
+                           sizeof( pHmacContext->key ) );
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_HmacSha1( const uint8_t * pPassword,
+                                size_t passwordLength,
+                                const uint8_t * pBuffer,
+                                size_t bufferLength,
+                                uint8_t * pOutputBuffer,
+                                uint16_t * pOutputBufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    IceCryptoHmacSha1Context_t hmacContext;
+
+    result = IceCrypto_HmacSha1Init( &( hmacContext ),
+                                     pPassword,
+                                     passwordLength );
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = IceCrypto_HmacSha1Update( &( hmacContext ),
+                                           pBuffer,
+                                           bufferLength );
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = IceCrypto_HmacSha1Final( &( hmacContext ),
+                                          pOutputBuffer,
+                                          pOutputBufferLength );
+    }
+
+    /* The inner hash state is derived from the key as well. */
+    IceCrypto_Zeroize( &( hmacContext ),
+                       sizeof( hmacContext ) );
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_HmacSha1Segments( const uint8_t * pPassword,
+                                        size_t passwordLength,
+                                        const uint8_t * pHeader,
+                                        size_t headerLength,
+                                        const uint8_t * pBuffer,
+                                        size_t bufferLength,
+                                        uint8_t * pOutputBuffer,
+                                        uint16_t * pOutputBufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    IceCryptoHmacSha1Context_t hmacContext;
+
+    result = IceCrypto_HmacSha1Init( &( hmacContext ),
+                                     pPassword,
+                                     passwordLength );
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = IceCrypto_HmacSha1Update( &( hmacContext ),
+                                           pHeader,
+                                           headerLength );
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = IceCrypto_HmacSha1Update( &( hmacContext ),
+                                           pBuffer,
+                                           bufferLength );
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = IceCrypto_HmacSha1Final( &( hmacContext ),
+                                          pOutputBuffer,
+                                          pOutputBufferLength );
+    }
+
+    /* The inner hash state is derived from the key as well. */
+    IceCrypto_Zeroize( &( hmacContext ),
+                       sizeof( hmacContext ) );
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+IceResult_t IceCrypto_Md5( const uint8_t * pBuffer,
+                           size_t bufferLength,
+                           uint8_t * pOutputBuffer,
+                           uint16_t * pOutputBufferLength )
+{
+    IceResult_t result = ICE_RESULT_OK;
+    IceCryptoMd5Context_t md5Context;
+
+    result = IceCrypto_Md5Init( &( md5Context ) );
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = IceCrypto_Md5Update( &( md5Context ),
+                                      pBuffer,
+                                      bufferLength );
+    }
+
+    if( result == ICE_RESULT_OK )
+    {
+        result = IceCrypto_Md5Final( &( md5Context ),
+                                     pOutputBuffer,
+                                     pOutputBufferLength );
+    }
+
+    IceCrypto_Zeroize( &( md5Context ),
+                       sizeof( md5Context ) );
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
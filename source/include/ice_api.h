@@ -6,6 +6,57 @@
 IceResult_t Ice_Init( IceContext_t * pContext,
                       const IceInitInfo_t * pInitInfo );
 
+/* Get the length of the memory block that Ice_InitFromArena needs for the
+ * tables described by pSizes. Returns ICE_RESULT_BAD_PARAM if the length does
+ * not fit in a size_t. */
+IceResult_t Ice_GetRequiredMemorySize( const IceArenaSizes_t * pSizes,
+                                       size_t * pMemorySize );
+
+/* Same as Ice_Init, except that the candidate, candidate pair, TURN server,
+ * request template and cache tables as well as the transaction ID store are
+ * carved out of pArena instead of being taken from pInitInfo. pArena must be
+ * aligned to ICE_ARENA_ALIGNMENT and at least as long as returned by
+ * Ice_GetRequiredMemorySize. The arena must stay valid as long as the
+ * context is used. */
+IceResult_t Ice_InitFromArena( IceContext_t * pContext,
+                               const IceInitInfo_t * pInitInfo,
+                               const IceArenaSizes_t * pSizes,
+                               uint8_t * pArena,
+                               size_t arenaLength );
+
+/* Initialize a long-term credential cache which can be passed to Ice_Init of
+ * one or more contexts in IceInitInfo_t.pLongTermCredentialCache. TURN servers
+ * with the same username, realm and password then share the MD5 key instead of
+ * computing it again on every 401 response. randomFxn generates the secret
+ * which keys the entries. lockFxn and unlockFxn are optional but must be
+ * provided together, and are required if the contexts sharing the cache run
+ * on different threads. */
+IceResult_t Ice_InitLongTermCredentialCache( IceLongTermCredentialCache_t * pCache,
+                                             IceLongTermCredentialCacheEntry_t * pEntries,
+                                             size_t numEntries,
+                                             IceRandom_t randomFxn,
+                                             IceLock_t lockFxn,
+                                             IceUnlock_t unlockFxn,
+                                             void * pLockContext );
+
+/* Clear the long-term keys and the secret of a long-term credential cache once
+ * no context uses it anymore. The cache can be initialized again afterwards. */
+IceResult_t Ice_DeinitLongTermCredentialCache( IceLongTermCredentialCache_t * pCache );
+
+/* Initialize a configuration which can be passed to Ice_Init of one or more
+ * contexts in IceInitInfo_t.pSharedConfig, in place of the crypto functions
+ * and the long-term credential cache of each context. The configuration is
+ * only read by the contexts and must stay valid as long as they are used.
+ * pLongTermCredentialCache is optional. */
+IceResult_t Ice_InitSharedConfig( IceSharedConfig_t * pSharedConfig,
+                                  const IceCryptoFunctions_t * pCryptoFunctions,
+                                  IceLongTermCredentialCache_t * pLongTermCredentialCache );
+
+/* Refill the random pool provided in IceInitInfo_t.pRandomPoolBuffer. The pool
+ * is otherwise refilled when it runs out, so this can be used to move the cost
+ * of the refill out of a gathering or pairing burst. */
+IceResult_t Ice_RefillRandomPool( IceContext_t * pContext );
+
 IceResult_t Ice_AddHostCandidate( IceContext_t * pContext,
                                   const IceEndpoint_t * pEndpoint );
 
@@ -23,14 +74,34 @@ IceResult_t Ice_AddRemoteCandidate( IceContext_t * pContext,
                                     const IceRemoteCandidateInfo_t * pRemoteCandidateInfo );
 
 IceResult_t Ice_CloseCandidate( IceContext_t * pContext,
-                                IceCandidate_t * pLocalCandidate );
+                                IceCandidate_t * pIceCandidate );
 
 IceResult_t Ice_CloseCandidatePair( IceContext_t * pContext,
                                     IceCandidatePair_t * pIceCandidatePair );
 
+/* Continue squeezing closed candidate pairs out of the candidate pair array,
+ * visiting at most maxCandidatePairsToVisit candidate pairs. Call it
+ * periodically, for example before Ice_CreateNextRequestsBatch(). Candidate
+ * pairs move, so pointers to them obtained earlier are no longer valid. */
+IceResult_t Ice_CompactCandidatePairs( IceContext_t * pContext,
+                                       size_t maxCandidatePairsToVisit );
+
+/* With lazyCandidatePairs set in IceInitInfo_t, candidate pairs are not
+ * created when candidates are added. Call it when the next connectivity check
+ * is due to create the candidate pair of the highest priority local and remote
+ * candidates not paired yet. Ice_CreateNextRequestsBatch() calls it once per
+ * batch. Returns ICE_RESULT_NO_NEXT_ACTION when all of them are paired. */
+IceResult_t Ice_AddNextCandidatePair( IceContext_t * pContext,
+                                      IceCandidatePair_t ** ppIceCandidatePair );
+
+/* Create the response to a binding request. pMessageBuffer can be the buffer
+ * the request was received in (the STUN message for a host or server
+ * reflexive candidate, the ChannelData or Data indication message for a relay
+ * candidate) to reflect the response back in place without a second buffer.
+ * pTransactionId is then the one returned by Ice_HandleStunPacket. */
 IceResult_t Ice_CreateResponseForRequest( IceContext_t * pContext,
                                           const IceCandidatePair_t * pIceCandidatePair,
-                                          uint8_t * pTransactionId,
+                                          const uint8_t * pTransactionId,
                                           uint8_t * pMessageBuffer,
                                           size_t * pMessageBufferLength );
 
@@ -42,13 +113,44 @@ IceResult_t Ice_HandleTurnPacket( IceContext_t * pContext,
                                   uint16_t * pTurnPayloadLength,
                                   IceCandidatePair_t ** ppIceCandidatePair );
 
+/* Same as Ice_HandleTurnPacket for a buffer of datagrams coalesced by UDP GRO.
+ * All the datagrams are segmentSize bytes long except the last one, which can
+ * be shorter. pSegments[ i ] describes the i-th datagram, which is handled in
+ * place. A segment whose result is ICE_RESULT_TURN_INVALID_MESSAGE is not a
+ * ChannelData message and can be passed to Ice_HandleStunPacket or
+ * Ice_HandleTurnDataIndication. Returns ICE_RESULT_BAD_PARAM if maxSegments is
+ * less than the number of datagrams in the buffer.
+ */
+IceResult_t Ice_HandleTurnPacketSegments( IceContext_t * pContext,
+                                          const uint8_t * pReceivedBuffer,
+                                          size_t receivedBufferLength,
+                                          size_t segmentSize,
+                                          IceCandidate_t * pLocalCandidate,
+                                          IceTurnPacketSegment_t * pSegments,
+                                          size_t maxSegments,
+                                          size_t * pNumSegments );
+
+/* Same as Ice_HandleTurnPacket for a Data indication, which the TURN server
+ * uses to relay data from a peer until a channel is bound to it. The payload
+ * is the DATA attribute and the candidate pair is the one whose remote
+ * candidate matches the XOR-PEER-ADDRESS attribute. Returns
+ * ICE_RESULT_TURN_INVALID_MESSAGE if the message is not a Data indication.
+ */
+IceResult_t Ice_HandleTurnDataIndication( IceContext_t * pContext,
+                                          const uint8_t * pReceivedStunMessage,
+                                          size_t receivedStunMessageLength,
+                                          IceCandidate_t * pLocalCandidate,
+                                          const uint8_t ** ppTurnPayload,
+                                          uint16_t * pTurnPayloadLength,
+                                          IceCandidatePair_t ** ppIceCandidatePair );
+
 IceHandleStunPacketResult_t Ice_HandleStunPacket( IceContext_t * pContext,
-                                                  uint8_t * pReceivedStunMessage,
+                                                  const uint8_t * pReceivedStunMessage,
                                                   size_t receivedStunMessageLength,
                                                   IceCandidate_t * pLocalCandidate,
                                                   const IceEndpoint_t * pRemoteCandidateEndpoint,
                                                   uint64_t currentTimeSeconds,
-                                                  uint8_t ** ppTransactionId,
+                                                  const uint8_t ** ppTransactionId,
                                                   IceCandidatePair_t ** ppIceCandidatePair );
 
 IceResult_t Ice_GetLocalCandidateCount( IceContext_t * pContext,
@@ -60,6 +162,12 @@ IceResult_t Ice_GetRemoteCandidateCount( IceContext_t * pContext,
 IceResult_t Ice_GetCandidatePairCount( IceContext_t * pContext,
                                        size_t * pNumCandidatePairs );
 
+/* Report the capacity, current use and high-water mark of each table of the
+ * context, to size the arrays in IceInitInfo_t from what sessions actually
+ * use. */
+IceResult_t Ice_GetMemoryStats( IceContext_t * pContext,
+                                IceMemoryStats_t * pMemoryStats );
+
 /**
  * Generates STUN/TURN requests for ICE candidate:
  * - Server reflexive candidate: STUN Binding request (query external IP/port).
@@ -82,6 +190,68 @@ IceResult_t Ice_CreateNextPairRequest( IceContext_t * pContext,
                                        uint8_t * pStunMessageBuffer,
                                        size_t * pStunMessageBufferLength );
 
+/* Create the connectivity check of a relay candidate pair wrapped in a Send
+ * indication, to be sent alongside the ChannelBind request created by
+ * Ice_CreateNextPairRequest while the pair is in
+ * ICE_CANDIDATE_PAIR_STATE_CHANNEL_BIND. The check only needs the permission
+ * installed before ChannelBind and so completes one round trip earlier. Its
+ * transaction ID is derived from the ChannelBind one, so retransmit it with
+ * each retransmission of the ChannelBind request. The check is complete once
+ * both its response and the ChannelBind success response are received.
+ *
+ * Returns ICE_RESULT_NO_NEXT_ACTION if the pair is not a relay candidate pair
+ * waiting for its ChannelBind response or its check already succeeded.
+ */
+IceResult_t Ice_CreateEarlyConnectivityCheck( IceContext_t * pContext,
+                                              IceCandidatePair_t * pIceCandidatePair,
+                                              uint8_t * pStunMessageBuffer,
+                                              size_t * pStunMessageBufferLength );
+
+/**
+ * Same as Ice_CreateNextCandidateRequest and Ice_CreateNextPairRequest but the
+ * request is created in the request cache of the candidate or candidate pair
+ * and a reference to it is returned, so that retransmissions of the same
+ * transaction are sent without copying or serializing the request again. The
+ * reference stays valid until the next call for the same candidate or
+ * candidate pair. Returns ICE_RESULT_BAD_PARAM if no request cache is assigned.
+ * The request cache holds ICE_REQUEST_CACHE_MAX_LENGTH bytes, which fits any
+ * TURN request with credentials within the ICE_SERVER_CONFIG_MAX_* limits. A
+ * connectivity check with a longer combined ICE username does not fit and
+ * fails with the error of Ice_CreateNextPairRequest for a too small buffer -
+ * use Ice_CreateNextPairRequest with a larger buffer for it instead.
+ */
+IceResult_t Ice_GetNextCandidateRequest( IceContext_t * pContext,
+                                         IceCandidate_t * pIceCandidate,
+                                         uint64_t currentTimeSeconds,
+                                         const uint8_t ** ppStunMessage,
+                                         size_t * pStunMessageLength );
+
+IceResult_t Ice_GetNextPairRequest( IceContext_t * pContext,
+                                    IceCandidatePair_t * pIceCandidatePair,
+                                    uint64_t currentTimeSeconds,
+                                    const uint8_t ** ppStunMessage,
+                                    size_t * pStunMessageLength );
+
+/* Create the next requests of all the local candidates and candidate pairs,
+ * one after another in pArena, so that a whole round of requests can be sent
+ * with a single sendmmsg call. pDescriptors[ 0 .. *pNumDescriptors - 1 ]
+ * describe the created requests. A request is only created if at least
+ * ICE_REQUEST_CACHE_MAX_LENGTH bytes of the arena are left.
+ *
+ * Returns ICE_RESULT_REQUESTS_BATCH_FULL if the descriptors or the arena ran
+ * out while requests were still due. The next call starts with the local
+ * candidate and the candidate pair which did not fit. A candidate or candidate
+ * pair whose request fails is skipped and the batch goes on, the first error
+ * is returned. The created requests are valid whatever the result.
+ */
+IceResult_t Ice_CreateNextRequestsBatch( IceContext_t * pContext,
+                                         uint64_t currentTimeSeconds,
+                                         uint8_t * pArena,
+                                         size_t arenaLength,
+                                         IceRequestDescriptor_t * pDescriptors,
+                                         size_t maxDescriptors,
+                                         size_t * pNumDescriptors );
+
 /* Writes 4 byte TURN channel data message header before the payload and the
  * required padding after the payload. It assumes that the caller has reserved
  * 4 (ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH) bytes for the header.
@@ -107,4 +277,94 @@ IceResult_t Ice_CreateTurnChannelDataMessage( IceContext_t * pContext,
                                               size_t turnPayloadLength,
                                               size_t * pTotalBufferLength );
 
+/* Same as Ice_CreateTurnChannelDataMessage but the payload is neither moved
+ * nor modified. The header and padding are written to the caller owned
+ * pFraming and the message is returned as segments referring to pFraming and
+ * pTurnPayload, which can be passed to sendmsg/writev without copying the
+ * payload. pFraming must stay valid until the message is sent. Returns
+ * ICE_RESULT_BAD_PARAM if turnPayloadLength is larger than 65535 bytes, which
+ * does not fit in the 16-bit ChannelData length field.
+ *
+ * @param pNumSegments [in, out]: On input, the number of entries in pSegments.
+ *                                On output, the number of segments used - 2
+ *                                without padding and 3 with padding.
+ *
+ * +----------+--------------------------------------+----------+
+ * |  Header  |           TURN Payload               |  Padding |
+ * +----------+--------------------------------------+----------+
+ *  pSegments[ 0 ]          pSegments[ 1 ]            pSegments[ 2 ]
+ */
+IceResult_t Ice_CreateTurnChannelDataSegments( IceContext_t * pContext,
+                                               const IceCandidatePair_t * pIceCandidatePair,
+                                               const uint8_t * pTurnPayload,
+                                               size_t turnPayloadLength,
+                                               IceTurnChannelDataFraming_t * pFraming,
+                                               IceBufferSegment_t * pSegments,
+                                               size_t * pNumSegments );
+
+/* Same as Ice_CreateTurnChannelDataSegments for numTurnPayloads payloads sent
+ * on the same candidate pair, e.g. all the RTP packets of a video frame. The
+ * parameters and the candidate pair state are checked once for the whole
+ * burst. pMessages must have numTurnPayloads entries and pMessages[ i ]
+ * describes the message for pTurnPayloads[ i ]. Returns ICE_RESULT_BAD_PARAM
+ * if a payload is longer than 65535 bytes, in which case no message is
+ * created.
+ */
+IceResult_t Ice_CreateTurnChannelDataBurst( IceContext_t * pContext,
+                                            const IceCandidatePair_t * pIceCandidatePair,
+                                            const IceBufferSegment_t * pTurnPayloads,
+                                            size_t numTurnPayloads,
+                                            IceTurnChannelDataBurstMessage_t * pMessages );
+
+/* Create a Send indication carrying pTurnPayload to the remote candidate of a
+ * relay candidate pair. Unlike ChannelData messages, Send indications only
+ * need a permission on the TURN server and can be used while the pair is in
+ * ICE_CANDIDATE_PAIR_STATE_CHANNEL_BIND. Once the channel is bound, prefer
+ * Ice_CreateTurnChannelDataMessage as its header is 4 bytes instead of 36 or
+ * 48 bytes. pTurnPayload is copied and must not overlap pBuffer.
+ *
+ * @param pBufferLength [in, out]: On input, the size of pBuffer. On output,
+ *                                 the length of the Send indication.
+ *
+ * Returns ICE_RESULT_TURN_PERMISSION_NOT_INSTALLED if the permission has not
+ * been created yet.
+ */
+IceResult_t Ice_CreateTurnSendIndication( IceContext_t * pContext,
+                                          const IceCandidatePair_t * pIceCandidatePair,
+                                          const uint8_t * pTurnPayload,
+                                          size_t turnPayloadLength,
+                                          uint8_t * pBuffer,
+                                          size_t * pBufferLength );
+
+/* Initialize a deframer for the TCP/TLS connection of the relay candidate
+ * pLocalCandidate. pBuffer holds the start of a frame which spans multiple
+ * chunks and must be large enough for the largest expected frame.
+ */
+IceResult_t Ice_InitTurnStreamDeframer( IceTurnStreamDeframer_t * pDeframer,
+                                        IceCandidate_t * pLocalCandidate,
+                                        uint8_t * pBuffer,
+                                        size_t bufferLength );
+
+/* Get the next STUN or ChannelData message from a chunk of bytes received on
+ * the TCP/TLS connection to the TURN server. Call it repeatedly, advancing
+ * pChunk by *pConsumedLength, until the chunk is consumed:
+ *
+ * - ICE_RESULT_OK: *pFrame is the next frame. It points either into pChunk
+ *   or into the buffer of the deframer and is valid until the next call.
+ *   The padding of a ChannelData message is consumed but not part of the
+ *   frame, so that the frame can be passed to Ice_HandleTurnPacket.
+ * - ICE_RESULT_TURN_STREAM_NEED_MORE_DATA: All the bytes were consumed and
+ *   the start of the next frame is kept in the buffer of the deframer.
+ * - ICE_RESULT_TURN_INVALID_MESSAGE: The stream does not contain a STUN or
+ *   ChannelData message. ICE_RESULT_OUT_OF_MEMORY: The frame does not fit in
+ *   the buffer of the deframer. In both cases the deframer is reset and the
+ *   connection should be closed.
+ */
+IceResult_t Ice_DeframeTurnStream( IceContext_t * pContext,
+                                   IceTurnStreamDeframer_t * pDeframer,
+                                   const uint8_t * pChunk,
+                                   size_t chunkLength,
+                                   size_t * pConsumedLength,
+                                   IceTurnStreamFrame_t * pFrame );
+
 #endif /* ICE_API_H */
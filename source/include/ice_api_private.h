@@ -5,6 +5,39 @@
 
 /*----------------------------------------------------------------------------*/
 
+/* STUN message layout - https://datatracker.ietf.org/doc/html/rfc5389#section-6. */
+#define ICE_STUN_HEADER_LENGTH                  ( 20 )
+#define ICE_STUN_HEADER_MESSAGE_LENGTH_OFFSET   ( 2 )
+#define ICE_STUN_HEADER_TRANSACTION_ID_OFFSET   ( 8 )
+#define ICE_STUN_ATTRIBUTE_HEADER_LENGTH        ( 4 )
+#define ICE_STUN_INTEGRITY_ATTRIBUTE_LENGTH     ( ICE_STUN_ATTRIBUTE_HEADER_LENGTH + STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH )
+#define ICE_STUN_FINGERPRINT_ATTRIBUTE_LENGTH   ( ICE_STUN_ATTRIBUTE_HEADER_LENGTH + 4 )
+
+/* Binding success response with XOR-MAPPED-ADDRESS (IPv6), ICE-CONTROLLED or
+ * ICE-CONTROLLING, MESSAGE-INTEGRITY and FINGERPRINT. */
+#define ICE_STUN_BINDING_RESPONSE_MAX_LENGTH                              \
+    ( ICE_STUN_HEADER_LENGTH +                                            \
+      ( ICE_STUN_ATTRIBUTE_HEADER_LENGTH + 4 + STUN_IPV6_ADDRESS_SIZE ) + \
+      ( ICE_STUN_ATTRIBUTE_HEADER_LENGTH + 8 ) +                          \
+      ICE_STUN_INTEGRITY_ATTRIBUTE_LENGTH +                               \
+      ICE_STUN_FINGERPRINT_ATTRIBUTE_LENGTH )
+
+/* https://datatracker.ietf.org/doc/html/rfc5389#section-15.5. */
+#define ICE_STUN_FINGERPRINT_XOR_VALUE          ( 0x5354554E )
+
+/* Closed candidate pairs are skipped by lookups and their slots are reclaimed
+ * when the candidate pair array is full. */
+#define ICE_CANDIDATE_PAIR_IS_CLOSED( pIceCandidatePair )                    \
+    ( ( ( pIceCandidatePair )->state == ICE_CANDIDATE_PAIR_STATE_INVALID ) || \
+      ( ( pIceCandidatePair )->state == ICE_CANDIDATE_PAIR_STATE_FROZEN ) )
+
+/* Flipped in the first byte of the transaction ID of a candidate pair to get
+ * the transaction ID of its connectivity check sent while ChannelBind is
+ * pending. */
+#define ICE_EARLY_CONNECTIVITY_CHECK_TRANSACTION_ID_MASK    ( 0x80 )
+
+/*----------------------------------------------------------------------------*/
+
 /*
  * Functions below are not part of the public API and are intended
  * for use by the library only. We do not do parameter checking in these APIs
@@ -20,6 +53,52 @@ IceResult_t Ice_AddCandidatePair( IceContext_t * pContext,
                                   IceCandidate_t * pLocalCandidate,
                                   IceCandidate_t * pRemoteCandidate );
 
+void Ice_RemoveCandidatePair( IceContext_t * pContext,
+                              size_t candidatePairIndex );
+
+void Ice_ClearCandidatePair( IceCandidatePair_t * pIceCandidatePair );
+
+IceCandidate_t * Ice_GetFreeCandidate( IceContext_t * pContext,
+                                       uint8_t isRemote );
+
+void Ice_ConsumeCandidate( IceContext_t * pContext,
+                           IceCandidate_t * pCandidate,
+                           uint8_t isRemote );
+
+void Ice_ReleaseCandidate( IceContext_t * pContext,
+                           IceCandidate_t * pCandidate );
+
+uint16_t Ice_AllocateTurnChannelNumber( IceTurnServer_t * pTurnServer );
+
+void Ice_ReleaseTurnChannelNumber( IceCandidatePair_t * pIceCandidatePair );
+
+uint32_t Ice_CountTrailingZeros( uint64_t value );
+
+IceCandidate_t * Ice_GetLazyCandidate( const IceContext_t * pContext,
+                                       uint8_t isRemote,
+                                       size_t link );
+
+uint8_t Ice_IsBeforeLazyFrontier( const IceContext_t * pContext,
+                                  const IceCandidate_t * pCandidate );
+
+uint8_t Ice_InsertLazyCandidate( IceContext_t * pContext,
+                                 IceCandidate_t * pCandidate,
+                                 uint8_t * pIsPairedWithCurrent );
+
+void Ice_RemoveLazyCandidate( IceContext_t * pContext,
+                              const IceCandidate_t * pCandidate );
+
+IceResult_t Ice_AddCandidatePairIfUsable( IceContext_t * pContext,
+                                          IceCandidate_t * pCandidate,
+                                          IceCandidate_t * pOtherCandidate );
+
+IceResult_t Ice_AddCandidatePairs( IceContext_t * pContext,
+                                   IceCandidate_t * pCandidate );
+
+IceCandidatePair_t * Ice_FindCandidatePair( IceContext_t * pContext,
+                                            const IceCandidate_t * pLocalCandidate,
+                                            const IceCandidate_t * pRemoteCandidate );
+
 uint32_t Ice_ComputeCandidatePriority( IceCandidateType_t candidateType,
                                        uint8_t isPointToPoint );
 
@@ -27,6 +106,69 @@ uint64_t Ice_ComputeCandidatePairPriority( uint32_t localCandidatePriority,
                                            uint32_t remoteCandidatePriority,
                                            uint32_t isControlling );
 
+IceRequestCache_t * Ice_AllocateRequestCache( IceContext_t * pContext );
+
+uint8_t Ice_ReadRequestCache( IceRequestCache_t * pRequestCache,
+                              const uint8_t * pTransactionId,
+                              uint8_t * pMessageBuffer,
+                              size_t * pMessageBufferLength );
+
+void Ice_WriteRequestCache( IceRequestCache_t * pRequestCache,
+                            const uint8_t * pTransactionId,
+                            const uint8_t * pMessage,
+                            size_t messageLength );
+
+void Ice_InvalidateRequestCache( IceRequestCache_t * pRequestCache );
+
+uint8_t Ice_IsCandidateRequestDue( const IceCandidate_t * pIceCandidate,
+                                   uint64_t currentTimeSeconds );
+
+uint8_t Ice_IsCandidatePairRequestDue( const IceCandidatePair_t * pIceCandidatePair,
+                                       uint64_t currentTimeSeconds );
+
+IceResponseCacheEntry_t * Ice_FindResponseCacheEntry( IceContext_t * pContext,
+                                                      const uint8_t * pTransactionId,
+                                                      const IceCandidatePair_t * pIceCandidatePair );
+
+void Ice_ClearResponseCache( IceContext_t * pContext );
+
+void Ice_MoveResponseCacheEntries( IceContext_t * pContext,
+                                   const IceCandidatePair_t * pFromCandidatePair,
+                                   IceCandidatePair_t * pToCandidatePair );
+
+IceResult_t Ice_FillRandomPool( IceContext_t * pContext );
+
+IceResult_t Ice_LayoutArena( const IceArenaSizes_t * pSizes,
+                             uint8_t * pArena,
+                             IceInitInfo_t * pInitInfo,
+                             size_t * pArenaLength );
+
+void Ice_SetTableStats( IceTableStats_t * pTableStats,
+                        size_t capacity,
+                        size_t used,
+                        size_t highWaterMark,
+                        size_t entrySize );
+
+size_t Ice_CountUsedCandidates( const IceCandidate_t * pCandidates,
+                                size_t numCandidates );
+
+const uint8_t * Ice_GetTurnServerCredential( const IceContext_t * pContext,
+                                             const IceTurnServer_t * pTurnServer,
+                                             IceTurnServerCredential_t credential );
+
+IceResult_t Ice_SetTurnServerCredential( IceContext_t * pContext,
+                                         IceTurnServer_t * pTurnServer,
+                                         IceTurnServerCredential_t credential,
+                                         const uint8_t * pValue,
+                                         size_t valueLength );
+
+void Ice_ReleaseTurnServerCredentials( IceContext_t * pContext,
+                                       IceTurnServer_t * pTurnServer );
+
+IceResult_t Ice_GenerateRandom( IceContext_t * pContext,
+                                uint8_t * pBuffer,
+                                size_t bufferLength );
+
 IceResult_t Ice_FinalizeStunPacket( IceContext_t * pContext,
                                     StunContext_t * pStunCtx,
                                     const uint8_t * pPassword,
@@ -38,6 +180,14 @@ IceResult_t Ice_CreateRequestForConnectivityCheck( IceContext_t * pContext,
                                                    uint8_t * pMessageBuffer,
                                                    size_t * pMessageBufferLength );
 
+void Ice_GetEarlyConnectivityCheckTransactionId( const IceCandidatePair_t * pIceCandidatePair,
+                                                 uint8_t * pTransactionId );
+
+IceResult_t Ice_CreateRequestForEarlyConnectivityCheck( IceContext_t * pContext,
+                                                        IceCandidatePair_t * pIceCandidatePair,
+                                                        uint8_t * pStunMessageBuffer,
+                                                        size_t * pStunMessageBufferLength );
+
 IceResult_t Ice_CreateRequestForNominatingCandidatePair( IceContext_t * pContext,
                                                          IceCandidatePair_t * pIceCandidatePair,
                                                          uint8_t * pMessageBuffer,
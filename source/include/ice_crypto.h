@@ -0,0 +1,144 @@
+#ifndef ICE_CRYPTO_H
+#define ICE_CRYPTO_H
+
+/* Standard includes. */
+#include <stdint.h>
+#include <stddef.h>
+
+/* Data types includes. */
+#include "ice_data_types.h"
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Built-in implementations of the hash functions needed by the ICE library.
+ *
+ * IceCrypto_HmacSha1 and IceCrypto_Md5 match the IceHmac_t and IceMd5_t
+ * signatures and can be assigned directly to IceCryptoFunctions_t.hmacFxn and
+ * IceCryptoFunctions_t.md5Fxn. The SHA-1 block function uses the x86 SHA
+ * extensions or the ARMv8 SHA1 instructions when the CPU supports them and
+ * falls back to a portable implementation otherwise.
+ *
+ * Define ICE_CRYPTO_DISABLE_HW_ACCELERATION to compile only the portable
+ * implementation.
+ */
+
+#define ICE_CRYPTO_SHA1_BLOCK_LENGTH    ( 64 )
+#define ICE_CRYPTO_SHA1_DIGEST_LENGTH   ( 20 )
+#define ICE_CRYPTO_MD5_BLOCK_LENGTH     ( 64 )
+#define ICE_CRYPTO_MD5_DIGEST_LENGTH    ( 16 )
+
+/*----------------------------------------------------------------------------*/
+
+typedef enum IceCryptoSha1Implementation
+{
+    ICE_CRYPTO_SHA1_IMPLEMENTATION_AUTO,
+    ICE_CRYPTO_SHA1_IMPLEMENTATION_PORTABLE,
+    ICE_CRYPTO_SHA1_IMPLEMENTATION_X86_SHA_NI,
+    ICE_CRYPTO_SHA1_IMPLEMENTATION_ARMV8_SHA1
+} IceCryptoSha1Implementation_t;
+
+typedef struct IceCryptoSha1Context
+{
+    uint32_t state[ 5 ];
+    uint64_t totalLength;
+    uint8_t block[ ICE_CRYPTO_SHA1_BLOCK_LENGTH ];
+    size_t blockLength;
+} IceCryptoSha1Context_t;
+
+typedef struct IceCryptoMd5Context
+{
+    uint32_t state[ 4 ];
+    uint64_t totalLength;
+    uint8_t block[ ICE_CRYPTO_MD5_BLOCK_LENGTH ];
+    size_t blockLength;
+} IceCryptoMd5Context_t;
+
+typedef struct IceCryptoHmacSha1Context
+{
+    IceCryptoSha1Context_t sha1Context;
+    uint8_t key[ ICE_CRYPTO_SHA1_BLOCK_LENGTH ];
+} IceCryptoHmacSha1Context_t;
+
+/*----------------------------------------------------------------------------*/
+
+/* Select the SHA-1 block implementation. ICE_CRYPTO_SHA1_IMPLEMENTATION_AUTO
+ * picks the fastest one supported by the CPU. Returns
+ * ICE_RESULT_CRYPTO_IMPLEMENTATION_NOT_SUPPORTED if the requested
+ * implementation is not compiled in or not supported by the CPU. Without an
+ * explicit selection, the automatic one is made on first use. Selection is
+ * thread safe with GCC-compatible compilers; with other compilers, select
+ * the implementation before the library is used from multiple threads. */
+IceResult_t IceCrypto_SetSha1Implementation( IceCryptoSha1Implementation_t implementation );
+
+IceCryptoSha1Implementation_t IceCrypto_GetSha1Implementation( void );
+
+/* The SHA-1 and MD5 contexts are zeroed by IceCrypto_Sha1Final and
+ * IceCrypto_Md5Final, as the data hashed may be a key, so a context must be
+ * initialized again before it is reused. */
+IceResult_t IceCrypto_Sha1Init( IceCryptoSha1Context_t * pSha1Context );
+
+IceResult_t IceCrypto_Sha1Update( IceCryptoSha1Context_t * pSha1Context,
+                                  const uint8_t * pBuffer,
+                                  size_t bufferLength );
+
+IceResult_t IceCrypto_Sha1Final( IceCryptoSha1Context_t * pSha1Context,
+                                 uint8_t * pOutputBuffer,
+                                 uint16_t * pOutputBufferLength );
+
+IceResult_t IceCrypto_Md5Init( IceCryptoMd5Context_t * pMd5Context );
+
+IceResult_t IceCrypto_Md5Update( IceCryptoMd5Context_t * pMd5Context,
+                                 const uint8_t * pBuffer,
+                                 size_t bufferLength );
+
+IceResult_t IceCrypto_Md5Final( IceCryptoMd5Context_t * pMd5Context,
+                                uint8_t * pOutputBuffer,
+                                uint16_t * pOutputBufferLength );
+
+/* The HMAC-SHA1 key is zeroed in the context by IceCrypto_HmacSha1Final, so
+ * a context must be initialized again before it is reused. */
+IceResult_t IceCrypto_HmacSha1Init( IceCryptoHmacSha1Context_t * pHmacContext,
+                                    const uint8_t * pPassword,
+                                    size_t passwordLength );
+
+IceResult_t IceCrypto_HmacSha1Update( IceCryptoHmacSha1Context_t * pHmacContext,
+                                      const uint8_t * pBuffer,
+                                      size_t bufferLength );
+
+IceResult_t IceCrypto_HmacSha1Final( IceCryptoHmacSha1Context_t * pHmacContext,
+                                     uint8_t * pOutputBuffer,
+                                     uint16_t * pOutputBufferLength );
+
+/* Matches IceHmac_t. */
+IceResult_t IceCrypto_HmacSha1( const uint8_t * pPassword,
+                                size_t passwordLength,
+                                const uint8_t * pBuffer,
+                                size_t bufferLength,
+                                uint8_t * pOutputBuffer,
+                                uint16_t * pOutputBufferLength );
+
+/* Matches IceHmacSegments_t. */
+IceResult_t IceCrypto_HmacSha1Segments( const uint8_t * pPassword,
+                                        size_t passwordLength,
+                                        const uint8_t * pHeader,
+                                        size_t headerLength,
+                                        const uint8_t * pBuffer,
+                                        size_t bufferLength,
+                                        uint8_t * pOutputBuffer,
+                                        uint16_t * pOutputBufferLength );
+
+/* Matches IceMd5_t. */
+IceResult_t IceCrypto_Md5( const uint8_t * pBuffer,
+                           size_t bufferLength,
+                           uint8_t * pOutputBuffer,
+                           uint16_t * pOutputBufferLength );
+
+/* Zero a buffer holding key material. Unlike memset, the stores are not
+ * removed by the compiler when the buffer is not read afterwards. */
+void IceCrypto_Zeroize( void * pBuffer,
+                        size_t bufferLength );
+
+/*----------------------------------------------------------------------------*/
+
+#endif /* ICE_CRYPTO_H */
@@ -18,12 +18,18 @@
 #define ICE_STUN_RESPONSE_RECEIVED_FLAG     ( 1 << 1 )
 #define ICE_STUN_REQUEST_RECEIVED_FLAG      ( 1 << 2 )
 #define ICE_STUN_RESPONSE_SENT_FLAG         ( 1 << 3 )
+#define ICE_STUN_CONNECTIVITY_CHECK_FLAGS   ( 0x0F )
 
-#define ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( connectivityCheckFlags ) \
-    ( ( connectivityCheckFlags ) == ( ICE_STUN_REQUEST_SENT_FLAG |       \
-                                      ICE_STUN_RESPONSE_RECEIVED_FLAG |  \
-                                      ICE_STUN_REQUEST_RECEIVED_FLAG |   \
-                                      ICE_STUN_RESPONSE_SENT_FLAG ) )
+/* Set once the nominated candidate pair has succeeded, so that it goes back
+ * to succeeded after a channel bind refresh. */
+#define ICE_CANDIDATE_PAIR_SUCCEEDED_FLAG   ( 1 << 4 )
+
+#define ICE_STUN_CONNECTIVITY_CHECK_SUCCESSFUL( flags )               \
+    ( ( ( flags ) & ICE_STUN_CONNECTIVITY_CHECK_FLAGS ) ==            \
+      ( ICE_STUN_REQUEST_SENT_FLAG |                                  \
+        ICE_STUN_RESPONSE_RECEIVED_FLAG |                             \
+        ICE_STUN_REQUEST_RECEIVED_FLAG |                              \
+        ICE_STUN_RESPONSE_SENT_FLAG ) )
 
 /* https://tools.ietf.org/html/rfc5389#section-15.3. */
 #define ICE_SERVER_CONFIG_MAX_USER_NAME_LENGTH  ( 512 )
@@ -42,6 +48,11 @@
  * of 16 bytes. */
 #define ICE_SERVER_CONFIG_LONG_TERM_PASSWORD_LENGTH         ( 16 )
 
+/* The long-term credential cache keys its entries with HMAC-SHA1 of the
+ * credentials under a random secret of the cache. */
+#define ICE_LONG_TERM_CREDENTIAL_CACHE_SECRET_LENGTH        ( 32 )
+#define ICE_LONG_TERM_CREDENTIAL_CACHE_TAG_LENGTH           ( 20 )
+
 /* Various TURN times. */
 #define ICE_DEFAULT_TURN_ALLOCATION_LIFETIME_SECONDS        ( 600 )
 #define ICE_TURN_ALLOCATION_REFRESH_GRACE_PERIOD_SECONDS    ( 30 )
@@ -55,6 +66,21 @@
 #define ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN ( 0x4000 )
 #define ICE_DEFAULT_TURN_CHANNEL_NUMBER_MAX ( 0x4FFF )
 
+/*
+ * Number of channel numbers handed out per TURN server, from
+ * ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN up. Each TURN server keeps one bit per
+ * channel number, 512 bytes for the whole range. A channel number is bound
+ * per relay candidate pair, so a build with a short check list can lower it to
+ * a multiple of 64 which covers its candidate pairs, e.g. 128 for 16 bytes.
+ */
+#ifndef ICE_TURN_CHANNEL_NUMBER_COUNT
+    #define ICE_TURN_CHANNEL_NUMBER_COUNT \
+    ( ICE_DEFAULT_TURN_CHANNEL_NUMBER_MAX - ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN + 1 )
+#endif
+#define ICE_TURN_CHANNEL_NUMBER_LAST \
+    ( ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN + ICE_TURN_CHANNEL_NUMBER_COUNT - 1 )
+#define ICE_TURN_CHANNEL_NUMBER_BITMAP_WORDS ( ICE_TURN_CHANNEL_NUMBER_COUNT / 64 )
+
 /*
  * TURN ChannelData Message:
 
@@ -77,6 +103,93 @@
 #define ICE_TURN_CHANNEL_DATA_MESSAGE_CHANNEL_NUMBER_OFFSET ( 0 )
 #define ICE_TURN_CHANNEL_DATA_MESSAGE_LENGTH_OFFSET         ( 2 )
 
+/* A TURN ChannelData message is sent as up to 3 segments: header, payload and
+ * padding. */
+#define ICE_TURN_CHANNEL_DATA_MESSAGE_MAX_SEGMENTS          ( 3 )
+#define ICE_TURN_CHANNEL_DATA_MESSAGE_MAX_PADDING_LENGTH    ( 3 )
+
+/* Over TCP/TLS, STUN and ChannelData messages both start with 4 bytes which
+ * contain the length of the rest of the message at offset 2. */
+#define ICE_TURN_STREAM_FRAME_HEADER_LENGTH                 ( 4 )
+#define ICE_TURN_STREAM_FRAME_LENGTH_OFFSET                 ( 2 )
+
+/*
+ * Maximum length of a pre-serialized connectivity check or nomination request
+ * kept in an IceStunRequestTemplate_t. Requests longer than this are
+ * serialized from scratch every time.
+ */
+#ifndef ICE_STUN_REQUEST_TEMPLATE_MAX_LENGTH
+    #define ICE_STUN_REQUEST_TEMPLATE_MAX_LENGTH            ( 160 )
+#endif
+
+/*
+ * Maximum length of a request kept in an IceRequestCache_t. Longer requests
+ * are not cached, and cannot be created by Ice_GetNextCandidateRequest and
+ * Ice_GetNextPairRequest. The default fits the longest TURN request - a
+ * ChannelBind request with the longest username, realm and nonce: header (20),
+ * XOR-PEER-ADDRESS (24), CHANNEL-NUMBER (8), USERNAME, REALM and NONCE
+ * (3 attribute headers and the values), MESSAGE-INTEGRITY (24) and
+ * FINGERPRINT (8).
+ */
+#ifndef ICE_REQUEST_CACHE_MAX_LENGTH
+    #define ICE_REQUEST_CACHE_MAX_LENGTH               \
+    ( 20 + 24 + 8 + ( 3 * 4 ) +                        \
+      ICE_SERVER_CONFIG_MAX_USER_NAME_LENGTH +         \
+      ICE_SERVER_CONFIG_MAX_REALM_LENGTH +             \
+      ICE_SERVER_CONFIG_MAX_NONCE_LENGTH +             \
+      24 + 8 )
+#endif
+
+/*
+ * Maximum length of a response kept in an IceResponseCacheEntry_t. Longer
+ * responses are not cached.
+ */
+#ifndef ICE_RESPONSE_CACHE_MAX_LENGTH
+    #define ICE_RESPONSE_CACHE_MAX_LENGTH                   ( 128 )
+#endif
+
+/*
+ * Received messages are never modified. To verify the MESSAGE-INTEGRITY of a
+ * message which has attributes after it without an hmacSegmentsFxn, the
+ * message is copied to a stack buffer of this size first. Longer messages fail
+ * the integrity check in that case.
+ */
+#ifndef ICE_STUN_INTEGRITY_CHECK_MAX_LENGTH
+    #define ICE_STUN_INTEGRITY_CHECK_MAX_LENGTH             ( 1280 )
+#endif
+
+/*
+ * Alignment of the memory block passed to Ice_InitFromArena and of each table
+ * carved out of it. Defaults to the size of a cache line.
+ */
+#ifndef ICE_ARENA_ALIGNMENT
+    #define ICE_ARENA_ALIGNMENT                             ( 64 )
+#endif
+
+/*
+ * Room reserved after the credentials of a TURN server in the credential pool,
+ * so that the realm and nonce received later, or a longer nonce, usually fit
+ * without moving the credentials to the end of the pool.
+ */
+#ifndef ICE_TURN_SERVER_CREDENTIALS_RESERVE_LENGTH
+    #define ICE_TURN_SERVER_CREDENTIALS_RESERVE_LENGTH      ( 64 )
+#endif
+
+/*
+ * Size budgets of IceCandidate_t and IceCandidatePair_t, one cache line each.
+ * They are checked at compile time so that a new field which does not fit in
+ * the existing padding is noticed.
+ */
+#define ICE_CANDIDATE_MAX_SIZE                              ( 64 )
+#define ICE_CANDIDATE_PAIR_MAX_SIZE                         ( 64 )
+
+/* Candidate slots are linked by index + 1 in 16-bit fields of IceCandidate_t,
+ * which bounds the length of the candidate arrays. */
+#define ICE_CANDIDATES_ARRAY_MAX_LENGTH                     ( UINT16_MAX )
+
+/* Fails to compile if the condition is false. */
+#define ICE_STATIC_ASSERT( condition, name )    typedef char name[ ( condition ) ? 1 : -1 ]
+
 /*----------------------------------------------------------------------------*/
 
 typedef enum IceCandidateType
@@ -121,6 +234,8 @@ typedef enum IceResult
     ICE_RESULT_OK,
     ICE_RESULT_NO_NEXT_ACTION,
     ICE_RESULT_TURN_CHANNEL_DATA_HEADER_NOT_REQUIRED,
+    ICE_RESULT_TURN_STREAM_NEED_MORE_DATA,
+    ICE_RESULT_REQUESTS_BATCH_FULL,
 
     /* Error code. */
     ICE_RESULT_BAD_PARAM,
@@ -136,6 +251,7 @@ typedef enum IceResult
     ICE_RESULT_STUN_ERROR_ADD_NONCE,
     ICE_RESULT_STUN_ERROR_ADD_XOR_PEER_ADDRESS,
     ICE_RESULT_STUN_ERROR_ADD_CHANNEL_NUMBER,
+    ICE_RESULT_STUN_ERROR_ADD_DATA,
     ICE_RESULT_SNPRINTF_ERROR,
     ICE_RESULT_RANDOM_GENERATION_ERROR,
     ICE_RESULT_CRC32_ERROR,
@@ -149,6 +265,8 @@ typedef enum IceResult
     ICE_RESULT_TURN_CANDIDATE_PAIR_NOT_FOUND,
     ICE_RESULT_TURN_INVALID_MESSAGE,
     ICE_RESULT_TURN_UNEXPECTED_MESSAGE,
+    ICE_RESULT_TURN_PERMISSION_NOT_INSTALLED,
+    ICE_RESULT_CRYPTO_IMPLEMENTATION_NOT_SUPPORTED,
 } IceResult_t;
 
 typedef enum IceHandleStunPacketResult
@@ -188,6 +306,7 @@ typedef enum IceHandleStunPacketResult
     ICE_HANDLE_STUN_PACKET_RESULT_LONG_TERM_CREDENTIAL_CALCULATION_ERROR,
     ICE_HANDLE_STUN_PACKET_RESULT_ADD_REMOTE_CANDIDATE_FAILED,
     ICE_HANDLE_STUN_PACKET_RESULT_UNEXPECTED_RESPONSE,
+    ICE_HANDLE_STUN_PACKET_RESULT_CREDENTIAL_POOL_FULL,
 
     /* Application needs to take action. */
     ICE_HANDLE_STUN_PACKET_RESULT_NOT_STUN_PACKET,
@@ -215,10 +334,21 @@ typedef IceResult_t ( * IceHmac_t ) ( const uint8_t * pPassword,
                                       size_t bufferLength,
                                       uint8_t * pOutputBuffer,
                                       uint16_t * pOutputBufferLength );
+/* HMAC of pHeader followed by pBuffer. */
+typedef IceResult_t ( * IceHmacSegments_t ) ( const uint8_t * pPassword,
+                                              size_t passwordLength,
+                                              const uint8_t * pHeader,
+                                              size_t headerLength,
+                                              const uint8_t * pBuffer,
+                                              size_t bufferLength,
+                                              uint8_t * pOutputBuffer,
+                                              uint16_t * pOutputBufferLength );
 typedef IceResult_t ( * IceMd5_t ) ( const uint8_t * pBuffer,
                                      size_t bufferLength,
                                      uint8_t * pOutputBuffer,
                                      uint16_t * pOutputBufferLength );
+typedef void ( * IceLock_t ) ( void * pLockContext );
+typedef void ( * IceUnlock_t ) ( void * pLockContext );
 
 /*----------------------------------------------------------------------------*/
 
@@ -230,58 +360,178 @@ typedef struct IceEndpoint
     uint8_t isPointToPoint;
 } IceEndpoint_t;
 
+typedef enum IceTurnServerCredential
+{
+    ICE_TURN_SERVER_CREDENTIAL_USER_NAME,
+    ICE_TURN_SERVER_CREDENTIAL_PASSWORD,
+    ICE_TURN_SERVER_CREDENTIAL_REALM,
+    ICE_TURN_SERVER_CREDENTIAL_NONCE,
+    ICE_TURN_SERVER_CREDENTIAL_MAX
+} IceTurnServerCredential_t;
+
+/*
+ * The username, password, realm and nonce of a TURN server are stored one
+ * after another in the credential pool of the context, starting at
+ * credentialsOffset.
+ */
 typedef struct IceTurnServer
 {
-    uint8_t userName[ ICE_SERVER_CONFIG_MAX_USER_NAME_LENGTH ];                 /* Username for the server. */
-    size_t userNameLength;                                                      /* Length of the username. */
-    uint8_t password[ ICE_SERVER_CONFIG_MAX_PASSWORD_LENGTH ];                  /* Password for the server. */
-    size_t passwordLength;                                                      /* Length of the password. */
-    uint8_t nonce[ ICE_SERVER_CONFIG_MAX_NONCE_LENGTH ];                        /* Nonce for the server. */
-    size_t nonceLength;                                                         /* Length of the nonce. */
-    uint8_t realm[ ICE_SERVER_CONFIG_MAX_REALM_LENGTH ];                        /* Realm for the server. */
-    size_t realmLength;                                                         /* Length of the realm. */
+    uint32_t credentialsOffset;                                                 /* Offset of the credentials in the credential pool. */
+    uint32_t credentialsCapacity;                                               /* Bytes of the pool owned by the server. */
+    uint16_t credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_MAX ];               /* Length of each credential. */
     uint8_t longTermPassword[ ICE_SERVER_CONFIG_LONG_TERM_PASSWORD_LENGTH ];    /* Long term password for the server. */
     size_t longTermPasswordLength;                                              /* Length of the long term password. */
     uint64_t turnAllocationExpirationTimeSeconds;
-    uint16_t nextAvailableTurnChannelNumber;
+    uint64_t turnChannelNumbersInUse[ ICE_TURN_CHANNEL_NUMBER_BITMAP_WORDS ];  /* Bit n is set while channel number MIN + n is assigned to a candidate pair. */
+    uint16_t nextAvailableTurnChannelNumber;                                    /* Where the search for a free channel number starts. */
 } IceTurnServer_t;
 
+/*
+ * Finalized bytes of the last request created for a candidate or a candidate
+ * pair. Retransmissions of the same transaction are served from the cache
+ * which is invalidated whenever the library regenerates the transaction ID.
+ */
+typedef struct IceRequestCache
+{
+    uint8_t transactionId[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+    uint8_t message[ ICE_REQUEST_CACHE_MAX_LENGTH ];
+    size_t messageLength; /* 0 if nothing is cached. */
+} IceRequestCache_t;
+
+/*
+ * The fields are ordered by how often they are accessed and the enums are
+ * stored in one byte each, which keeps the candidate within
+ * ICE_CANDIDATE_MAX_SIZE bytes without holes.
+ */
 typedef struct IceCandidate
 {
-    IceCandidateType_t candidateType;
-    uint8_t isRemote;
     IceEndpoint_t endpoint;
-    IceCandidateState_t state;
+    uint8_t candidateType; /* IceCandidateType_t. */
+    uint8_t state; /* IceCandidateState_t. */
+    uint8_t isRemote;
+    uint8_t remoteProtocol; /* IceSocketProtocol_t. */
+    uint16_t nextByPriority; /* Index + 1 of the next candidate in the lazy candidate pair list of its side, 0 for the last one. */
     uint32_t priority;
-    IceSocketProtocol_t remoteProtocol;
+    IceTurnServer_t * pTurnServer;
+    IceRequestCache_t * pRequestCache; /* NULL if no request cache is assigned. */
     uint8_t transactionId[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
     uint16_t candidateId; /* Debugging aid only. */
-    IceTurnServer_t * pTurnServer;
+    uint16_t nextFreeCandidate; /* Index + 1 of the next free slot while the candidate is on a free list, 0 for the last one. */
 } IceCandidate_t;
 
+ICE_STATIC_ASSERT( sizeof( IceCandidate_t ) <= ICE_CANDIDATE_MAX_SIZE, IceCandidateSizeCheck_t );
+ICE_STATIC_ASSERT( ( ICE_TURN_CHANNEL_NUMBER_COUNT % 64 == 0 ) &&
+                   ( ICE_TURN_CHANNEL_NUMBER_COUNT >= 64 ) &&
+                   ( ICE_TURN_CHANNEL_NUMBER_LAST <= ICE_DEFAULT_TURN_CHANNEL_NUMBER_MAX ),
+                   IceTurnChannelNumberCountCheck_t );
+
+/*
+ * Finalized connectivity check or nomination request of a candidate pair.
+ * Subsequent requests of the same kind are created by patching the transaction
+ * ID and recomputing MESSAGE-INTEGRITY and FINGERPRINT instead of serializing
+ * the message again.
+ */
+typedef struct IceStunRequestTemplate
+{
+    uint8_t message[ ICE_STUN_REQUEST_TEMPLATE_MAX_LENGTH ];
+    size_t messageLength; /* 0 if the template is not yet built. */
+    uint8_t isNomination;
+    uint8_t isControlling;
+} IceStunRequestTemplate_t;
+
+/*
+ * Laid out like IceCandidate_t to stay within ICE_CANDIDATE_PAIR_MAX_SIZE
+ * bytes.
+ */
 typedef struct IceCandidatePair
 {
     IceCandidate_t * pLocalCandidate;
     IceCandidate_t * pRemoteCandidate;
     uint64_t priority;
-    IceCandidatePairState_t state;
-    uint8_t succeeded;
-    uint32_t connectivityCheckFlags;
-    uint8_t transactionId[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
-
-    /* Below fields are for TURN. */
+    uint8_t state; /* IceCandidatePairState_t. */
+    uint8_t flags; /* ICE_STUN_*_FLAG and ICE_CANDIDATE_PAIR_SUCCEEDED_FLAG. */
     uint16_t turnChannelNumber;
+    uint8_t transactionId[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+    IceStunRequestTemplate_t * pStunRequestTemplate; /* NULL if no template is assigned. */
+    IceRequestCache_t * pRequestCache; /* NULL if no request cache is assigned. */
     uint64_t turnPermissionExpirationSeconds;
 } IceCandidatePair_t;
 
+ICE_STATIC_ASSERT( sizeof( IceCandidatePair_t ) <= ICE_CANDIDATE_PAIR_MAX_SIZE, IceCandidatePairSizeCheck_t );
+
+/*
+ * Binding request which passed the integrity check and the response created
+ * for it. A retransmission of the request, i.e. same transaction ID and
+ * MESSAGE-INTEGRITY received on the same local candidate from the same remote
+ * transport address, is answered from here as allowed by RFC 5389 section
+ * 7.3.1.
+ */
+typedef struct IceResponseCacheEntry
+{
+    uint8_t transactionId[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+    const IceCandidate_t * pLocalCandidate;
+    IceTransportAddress_t remoteTransportAddress;
+    IceCandidatePair_t * pCandidatePair; /* NULL if the entry is not in use. */
+    uint8_t useCandidateFlag;
+    size_t requestLength;
+    size_t requestIntegrityOffset;
+    uint8_t requestIntegrity[ STUN_ATTRIBUTE_INTEGRITY_VALUE_LENGTH ];
+    uint8_t response[ ICE_RESPONSE_CACHE_MAX_LENGTH ];
+    size_t responseLength; /* 0 if the response is not cached yet. */
+} IceResponseCacheEntry_t;
+
+/* The username, realm and password are not kept, an entry is found by a
+ * keyed MAC of them. The MAC cannot be computed without the secret of the
+ * cache, so a TURN server cannot choose a realm which matches the entry of
+ * another server. */
+typedef struct IceLongTermCredentialCacheEntry
+{
+    uint8_t credentialTag[ ICE_LONG_TERM_CREDENTIAL_CACHE_TAG_LENGTH ];
+    uint8_t isUsed;
+    uint8_t longTermPassword[ ICE_SERVER_CONFIG_LONG_TERM_PASSWORD_LENGTH ];
+} IceLongTermCredentialCacheEntry_t;
+
+/*
+ * Long-term credential keys (MD5 of username:realm:password) computed for TURN
+ * servers. One cache can be shared by all the ICE contexts of the process - in
+ * that case, lockFxn and unlockFxn must be provided to serialize the access.
+ */
+typedef struct IceLongTermCredentialCache
+{
+    IceLongTermCredentialCacheEntry_t * pEntries;
+    size_t maxEntries;
+    size_t nextEntry;
+    uint8_t secret[ ICE_LONG_TERM_CREDENTIAL_CACHE_SECRET_LENGTH ];
+    IceLock_t lockFxn;     /* Optional. */
+    IceUnlock_t unlockFxn; /* Optional. */
+    void * pLockContext;
+} IceLongTermCredentialCache_t;
+
 typedef struct IceCryptoFunctions
 {
     IceRandom_t randomFxn;
     IceCrc32_t crc32Fxn;
     IceHmac_t hmacFxn;
     IceMd5_t md5Fxn;
+    /* Optional, same HMAC as hmacFxn over two buffers. Received messages are
+     * then verified without being copied. IceCrypto_HmacSha1Segments is used
+     * if hmacFxn is IceCrypto_HmacSha1. */
+    IceHmacSegments_t hmacSegmentsFxn;
 } IceCryptoFunctions_t;
 
+/*
+ * Function tables and TURN long-term keys which do not change for the lifetime
+ * of a context. One configuration initialized with Ice_InitSharedConfig can be
+ * referenced by any number of contexts through IceInitInfo_t.pSharedConfig
+ * instead of each context carrying its own copy.
+ */
+typedef struct IceSharedConfig
+{
+    IceCryptoFunctions_t cryptoFunctions;
+    StunReadWriteFunctions_t readWriteFunctions;
+    IceLongTermCredentialCache_t * pLongTermCredentialCache; /* Optional. */
+} IceSharedConfig_t;
+
 typedef struct IceCredentials
 {
     const uint8_t * pLocalUsername;
@@ -301,22 +551,67 @@ typedef struct IceContext
     IceCredentials_t creds;
     IceCandidate_t * pLocalCandidates;
     size_t maxLocalCandidates;
-    size_t numLocalCandidates;
+    size_t numLocalCandidates; /* Slots ever used, including the ones on the free list. */
+    size_t localCandidatesFreeList; /* Index + 1 of the first free slot, 0 if the free list is empty. */
     IceCandidate_t * pRemoteCandidates;
     size_t maxRemoteCandidates;
-    size_t numRemoteCandidates;
+    size_t numRemoteCandidates; /* Slots ever used, including the ones on the free list. */
+    size_t remoteCandidatesFreeList; /* Index + 1 of the first free slot, 0 if the free list is empty. */
     IceCandidatePair_t * pCandidatePairs;
     size_t maxCandidatePairs;
     size_t numCandidatePairs;
+    size_t candidatePairsHighWaterMark;
+    size_t compactionReadIndex; /* Next candidate pair visited by Ice_CompactCandidatePairs. */
+    size_t compactionWriteIndex; /* Where the next live candidate pair visited is moved to. */
+    size_t batchNextLocalCandidate; /* First local candidate visited by the next Ice_CreateNextRequestsBatch. */
+    size_t batchNextCandidatePair; /* First candidate pair visited by the next Ice_CreateNextRequestsBatch. */
     IceTurnServer_t * pTurnServers;
     size_t maxTurnServers;
     size_t numTurnServers;
+    IceStunRequestTemplate_t * pStunRequestTemplates;
+    size_t maxStunRequestTemplates;
+    size_t numStunRequestTemplates;
+    IceRequestCache_t * pRequestCaches;
+    size_t maxRequestCaches;
+    size_t numRequestCaches;
+    IceResponseCacheEntry_t * pResponseCacheEntries;
+    size_t maxResponseCacheEntries;
+    size_t nextResponseCacheEntry;
+    size_t responseCacheHighWaterMark; /* Entries ever written, they are written in order. */
+    uint8_t * pCredentialPool;
+    size_t credentialPoolLength;
+    size_t credentialPoolUsed;
+    size_t credentialPoolHighWaterMark;
+    uint8_t * pRandomPool;
+    size_t randomPoolLength;
+    size_t randomPoolOffset; /* Equal to randomPoolLength when the pool is empty. */
     IceCandidatePair_t * pNominatedPair;
     uint64_t tieBreaker;
     uint8_t isControlling;
+    uint8_t lazyCandidatePairs;
+    /* The priority of a candidate pair is ruled by the lower priority of its
+     * two candidates. Ice_AddNextCandidatePair therefore visits the local and
+     * remote candidates in the order of decreasing priority, merging the two
+     * lists below, and pairs each one with the candidates of the other side
+     * visited before it. Links are index + 1, 0 for none. */
+    size_t localCandidatesByPriority;
+    size_t remoteCandidatesByPriority;
+    size_t lazyNextLocalCandidate; /* First local candidate not visited yet. */
+    size_t lazyNextRemoteCandidate; /* First remote candidate not visited yet. */
+    size_t lazyCandidate; /* Candidate being paired, on the side of lazyFrontierIsRemote. */
+    size_t lazyPartner; /* Next candidate of the other side to pair it with. */
+    uint64_t lazyFrontierPriority; /* Priority of the last candidate visited, UINT64_MAX before the first one. */
+    uint8_t lazyFrontierIsRemote;
+    size_t lazyTriggeredCandidatePairs; /* Candidate pairs created ahead of the lists by triggered checks. */
     TransactionIdStore_t * pStunBindingRequestTransactionIdStore;
-    IceCryptoFunctions_t cryptoFunctions;
-    StunReadWriteFunctions_t readWriteFunctions;
+    const IceSharedConfig_t * pConfig; /* Either the shared configuration or config. */
+    /* Copy of the crypto functions and long-term credential cache passed in
+     * IceInitInfo_t when no shared configuration is given, so that a single
+     * context does not need an IceSharedConfig_t kept alive next to it. It is
+     * unused with a shared configuration, but kept rather than compiled out:
+     * it is 96 bytes, and a build switch would give IceContext_t two layouts
+     * that the application and the library must agree on. */
+    IceSharedConfig_t config;
     uint16_t nextCandidateId;
 } IceContext_t;
 
@@ -324,18 +619,73 @@ typedef struct IceInitInfo
 {
     IceCredentials_t creds;
     IceCandidate_t * pLocalCandidatesArray;
-    size_t localCandidatesArrayLength;
+    size_t localCandidatesArrayLength; /* At most ICE_CANDIDATES_ARRAY_MAX_LENGTH. */
     IceCandidate_t * pRemoteCandidatesArray;
-    size_t remoteCandidatesArrayLength;
+    size_t remoteCandidatesArrayLength; /* At most ICE_CANDIDATES_ARRAY_MAX_LENGTH. */
     IceCandidatePair_t * pCandidatePairsArray;
     size_t candidatePairsArrayLength;
+    size_t candidatePairsLimit; /* Optional, size of the check list (RFC 8445 suggests 100), 0 for candidatePairsArrayLength. */
     IceTurnServer_t * pTurnServerArray;
     size_t turnServerArrayLength;
+    IceStunRequestTemplate_t * pStunRequestTemplatesArray; /* Optional, one template per candidate pair. */
+    size_t stunRequestTemplatesArrayLength;
+    IceRequestCache_t * pRequestCachesArray; /* Optional, one cache per relay candidate and candidate pair. */
+    size_t requestCachesArrayLength;
+    IceResponseCacheEntry_t * pResponseCacheArray; /* Optional. */
+    size_t responseCacheArrayLength;
+    IceLongTermCredentialCache_t * pLongTermCredentialCache; /* Optional, can be shared between contexts. */
+    uint8_t * pCredentialPoolBuffer; /* Optional, holds the credentials of the TURN servers. Required for relay candidates. */
+    size_t credentialPoolBufferLength;
+    uint8_t * pRandomPoolBuffer; /* Optional. */
+    size_t randomPoolBufferLength;
     uint8_t isControlling;
+    uint8_t lazyCandidatePairs; /* Optional, 1 to create candidate pairs on demand with Ice_AddNextCandidatePair. */
     TransactionIdStore_t * pStunBindingRequestTransactionIdStore;
+    const IceSharedConfig_t * pSharedConfig; /* Optional, cryptoFunctions and pLongTermCredentialCache are ignored if set. */
     IceCryptoFunctions_t cryptoFunctions;
 } IceInitInfo_t;
 
+/* Number of entries of each table carved out of the memory block passed to
+ * Ice_InitFromArena. The lengths match the ones in IceInitInfo_t. */
+typedef struct IceArenaSizes
+{
+    size_t localCandidatesArrayLength;
+    size_t remoteCandidatesArrayLength;
+    size_t candidatePairsArrayLength;
+    size_t turnServerArrayLength;
+    size_t transactionIdSlotsArrayLength;
+    size_t stunRequestTemplatesArrayLength; /* Optional, 0 to disable. */
+    size_t requestCachesArrayLength; /* Optional, 0 to disable. */
+    size_t responseCacheArrayLength; /* Optional, 0 to disable. */
+    size_t credentialPoolBufferLength; /* Optional, 0 to disable. */
+} IceArenaSizes_t;
+
+/* Capacity, current use and high-water mark of one table of the context, in
+ * entries and in bytes. The high-water mark is the most entries in use at a
+ * time since Ice_Init. */
+typedef struct IceTableStats
+{
+    size_t capacity;
+    size_t used;
+    size_t highWaterMark;
+    size_t capacityBytes;
+    size_t usedBytes;
+    size_t highWaterMarkBytes;
+} IceTableStats_t;
+
+typedef struct IceMemoryStats
+{
+    IceTableStats_t localCandidates;
+    IceTableStats_t remoteCandidates;
+    IceTableStats_t candidatePairs;
+    IceTableStats_t turnServers;
+    IceTableStats_t transactionIdSlots;
+    IceTableStats_t stunRequestTemplates;
+    IceTableStats_t requestCaches;
+    IceTableStats_t responseCache;
+    IceTableStats_t credentialPool; /* Entries are bytes. */
+} IceMemoryStats_t;
+
 typedef struct IceRemoteCandidateInfo
 {
     IceCandidateType_t candidateType;
@@ -344,18 +694,94 @@ typedef struct IceRemoteCandidateInfo
     const IceEndpoint_t * pEndpoint;
 } IceRemoteCandidateInfo_t;
 
+/* Same layout as struct iovec on POSIX systems. */
+typedef struct IceBufferSegment
+{
+    const uint8_t * pBuffer;
+    size_t bufferLength;
+} IceBufferSegment_t;
+
+/* Header and padding of a TURN ChannelData message sent as segments. */
+typedef struct IceTurnChannelDataFraming
+{
+    uint8_t header[ ICE_TURN_CHANNEL_DATA_MESSAGE_HEADER_LENGTH ];
+    uint8_t padding[ ICE_TURN_CHANNEL_DATA_MESSAGE_MAX_PADDING_LENGTH ];
+} IceTurnChannelDataFraming_t;
+
+/* One TURN ChannelData message of a burst. segments and numSegments can be
+ * used directly as msg_iov and msg_iovlen of a struct mmsghdr entry. */
+typedef struct IceTurnChannelDataBurstMessage
+{
+    IceTurnChannelDataFraming_t framing;
+    IceBufferSegment_t segments[ ICE_TURN_CHANNEL_DATA_MESSAGE_MAX_SEGMENTS ];
+    size_t numSegments;
+} IceTurnChannelDataBurstMessage_t;
+
+typedef enum IceTurnStreamFrameType
+{
+    ICE_TURN_STREAM_FRAME_TYPE_STUN,
+    ICE_TURN_STREAM_FRAME_TYPE_CHANNEL_DATA
+} IceTurnStreamFrameType_t;
+
+/* A complete STUN message or TURN ChannelData message (header and payload,
+ * without padding) received on a TURN-over-TCP/TLS stream. */
+typedef struct IceTurnStreamFrame
+{
+    IceTurnStreamFrameType_t frameType;
+    const uint8_t * pFrame;
+    size_t frameLength;
+} IceTurnStreamFrame_t;
+
+/* Splits the byte stream of a TCP/TLS connection to a TURN server into
+ * frames. Only the start of a frame which is not received completely is kept
+ * in pBuffer, all the other frames are returned in place. */
+typedef struct IceTurnStreamDeframer
+{
+    IceCandidate_t * pLocalCandidate;
+    uint8_t * pBuffer;
+    size_t bufferLength;
+    size_t bufferedLength;
+} IceTurnStreamDeframer_t;
+
+/* One datagram of a buffer in which the kernel coalesced several datagrams
+ * received from the TURN server (UDP GRO). result, pTurnPayload,
+ * turnPayloadLength and pIceCandidatePair are the outputs of
+ * Ice_HandleTurnPacket for the datagram. */
+typedef struct IceTurnPacketSegment
+{
+    const uint8_t * pSegment;
+    size_t segmentLength;
+    IceResult_t result;
+    const uint8_t * pTurnPayload;
+    uint16_t turnPayloadLength;
+    IceCandidatePair_t * pIceCandidatePair;
+} IceTurnPacketSegment_t;
+
+/* A request created by Ice_CreateNextRequestsBatch. The request starts at
+ * offset in the arena, and can be used with pDestination as msg_iov and
+ * msg_name of a struct mmsghdr entry for the socket of pLocalCandidate. */
+typedef struct IceRequestDescriptor
+{
+    size_t offset;
+    size_t length;
+    IceCandidate_t * pLocalCandidate;
+    const IceEndpoint_t * pDestination; /* NULL if the request is for the STUN or TURN server of pLocalCandidate. */
+} IceRequestDescriptor_t;
+
 typedef struct IceStunDeserializedPacketInfo
 {
     uint8_t useCandidateFlag;
     uint16_t errorCode;
     uint32_t priority;
+    const uint8_t * pMessageIntegrity; /* Value of the verified MESSAGE-INTEGRITY attribute. */
     IceTransportAddress_t peerTransportAddress;
     IceTransportAddress_t relayTransportAddress;
 
-    /* Below fields are for relay candidate. */
-    uint8_t * pNonce;
+    /* Below fields are for relay candidate. They point into the received
+     * message. */
+    const uint8_t * pNonce;
     size_t nonceLength;
-    uint8_t * pRealm;
+    const uint8_t * pRealm;
     size_t realmLength;
     uint32_t lifetimeSeconds;
 } IceStunDeserializedPacketInfo_t;
@@ -30,6 +30,8 @@ typedef struct TransactionIdStore
 {
     TransactionIdSlot_t * pTransactionIdSlots;
     size_t numTransactionIdSlots;
+    size_t highWaterMark; /* Slots ever used. The first free slot is taken, so
+                           * it is also the most slots in use at a time. */
 } TransactionIdStore_t;
 
 /*----------------------------------------------------------------------------*/
@@ -39,13 +41,13 @@ TransactionIdStoreResult_t TransactionIdStore_Init( TransactionIdStore_t * pStor
                                                     size_t numTransactionIdSlots );
 
 TransactionIdStoreResult_t TransactionIdStore_Insert( TransactionIdStore_t * pStore,
-                                                      uint8_t * pTransactionId );
+                                                      const uint8_t * pTransactionId );
 
 TransactionIdStoreResult_t TransactionIdStore_HasId( TransactionIdStore_t * pStore,
-                                                     uint8_t * pTransactionId );
+                                                     const uint8_t * pTransactionId );
 
 TransactionIdStoreResult_t TransactionIdStore_Remove( TransactionIdStore_t * pStore,
-                                                      uint8_t * pTransactionId );
+                                                      const uint8_t * pTransactionId );
 
 /*----------------------------------------------------------------------------*/
 
@@ -21,10 +21,9 @@ TransactionIdStoreResult_t TransactionIdStore_Init( TransactionIdStore_t * pStor
     {
         pStore->pTransactionIdSlots = pTransactionIdSlots;
         pStore->numTransactionIdSlots = numTransactionIdSlots;
-
-        memset( &( pStore->pTransactionIdSlots[ 0 ] ),
-                0,
-                pStore->numTransactionIdSlots * sizeof( TransactionIdSlot_t ) );
+        /* The slots from highWaterMark onwards are never read, so they do
+         * not need to be cleared. */
+        pStore->highWaterMark = 0;
     }
 
     return result;
@@ -33,7 +32,7 @@ TransactionIdStoreResult_t TransactionIdStore_Init( TransactionIdStore_t * pStor
 /*----------------------------------------------------------------------------*/
 
 TransactionIdStoreResult_t TransactionIdStore_Insert( TransactionIdStore_t * pStore,
-                                                      uint8_t * pTransactionId )
+                                                      const uint8_t * pTransactionId )
 {
     size_t i;
     TransactionIdStoreResult_t result = TRANSACTION_ID_STORE_RESULT_OK;
@@ -46,14 +45,21 @@ TransactionIdStoreResult_t TransactionIdStore_Insert( TransactionIdStore_t * pSt
 
     if( result == TRANSACTION_ID_STORE_RESULT_OK )
     {
+        /* Take the first free slot, or else the first slot never used. */
         for( i = 0; i < pStore->numTransactionIdSlots; i++ )
         {
-            if( pStore->pTransactionIdSlots[ i ].inUse == 0 )
+            if( ( i == pStore->highWaterMark ) ||
+                ( pStore->pTransactionIdSlots[ i ].inUse == 0 ) )
             {
                 memcpy( &( pStore->pTransactionIdSlots[ i ].transactionId[ 0 ] ),
                         &( pTransactionId[ 0 ] ),
                         STUN_HEADER_TRANSACTION_ID_LENGTH );
                 pStore->pTransactionIdSlots[ i ].inUse = 1;
+
+                if( i == pStore->highWaterMark )
+                {
+                    pStore->highWaterMark = i + 1;
+                }
                 break;
             }
         }
@@ -70,7 +76,7 @@ TransactionIdStoreResult_t TransactionIdStore_Insert( TransactionIdStore_t * pSt
 /*----------------------------------------------------------------------------*/
 
 TransactionIdStoreResult_t TransactionIdStore_HasId( TransactionIdStore_t * pStore,
-                                                     uint8_t * pTransactionId )
+                                                     const uint8_t * pTransactionId )
 {
     size_t i;
     TransactionIdStoreResult_t result = TRANSACTION_ID_STORE_RESULT_OK;
@@ -85,7 +91,7 @@ TransactionIdStoreResult_t TransactionIdStore_HasId( TransactionIdStore_t * pSto
     {
         result = TRANSACTION_ID_STORE_RESULT_ID_NOT_FOUND;
 
-        for( i = 0; i < pStore->numTransactionIdSlots; i++ )
+        for( i = 0; i < pStore->highWaterMark; i++ )
         {
             if( pStore->pTransactionIdSlots[ i ].inUse == 1 )
             {
@@ -106,7 +112,7 @@ TransactionIdStoreResult_t TransactionIdStore_HasId( TransactionIdStore_t * pSto
 /*----------------------------------------------------------------------------*/
 
 TransactionIdStoreResult_t TransactionIdStore_Remove( TransactionIdStore_t * pStore,
-                                                      uint8_t * pTransactionId )
+                                                      const uint8_t * pTransactionId )
 {
     size_t i;
     TransactionIdStoreResult_t result = TRANSACTION_ID_STORE_RESULT_OK;
@@ -121,7 +127,7 @@ TransactionIdStoreResult_t TransactionIdStore_Remove( TransactionIdStore_t * pSt
     {
         result = TRANSACTION_ID_STORE_RESULT_ID_NOT_FOUND;
 
-        for( i = 0; i < pStore->numTransactionIdSlots; i++ )
+        for( i = 0; i < pStore->highWaterMark; i++ )
         {
             if( pStore->pTransactionIdSlots[ i ].inUse == 1 )
             {
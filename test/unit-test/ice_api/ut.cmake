@@ -31,6 +31,7 @@ list(APPEND real_source_files
             ${MODULE_ROOT_DIR}/source/ice_api_private.c
             ${MODULE_ROOT_DIR}/source/ice_api.c
             ${MODULE_ROOT_DIR}/source/transaction_id_store.c
+            ${MODULE_ROOT_DIR}/source/ice_crypto.c
             ${STUN_SOURCES}
         )
 # List the directories the module under test includes.
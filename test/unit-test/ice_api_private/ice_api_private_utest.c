@@ -28,6 +28,7 @@ uint8_t ipAddress[] = { 0xC0, 0xA8, 0x01, 0x64 }; /* "192.168.1.100". */
 #define CANDIDATE_PAIR_ARRAY_SIZE                100
 #define ICE_TURN_SERVER_ARRAY_SIZE               10
 #define TRANSACTION_ID_SLOTS_ARRAY_ARRAY_SIZE    32
+#define CREDENTIAL_POOL_SIZE                     4096
 
 /* Specific TURN channel number used for testing. */
 #define TEST_TURN_CHANNEL_NUMBER_START           ( 0x4010 )
@@ -39,6 +40,7 @@ IceCandidate_t remoteCandidateArray[ REMOTE_CANDIDATE_ARRAY_SIZE ];
 IceCandidatePair_t candidatePairArray[ CANDIDATE_PAIR_ARRAY_SIZE ];
 IceTurnServer_t iceTurnServerArray[ ICE_TURN_SERVER_ARRAY_SIZE ];
 TransactionIdSlot_t transactionIdSlots[ TRANSACTION_ID_SLOTS_ARRAY_ARRAY_SIZE ];
+uint8_t credentialPool[ CREDENTIAL_POOL_SIZE ];
 
 /* ===========================  EXTERN FUNCTIONS   =========================== */
 
@@ -352,11 +354,37 @@ static void Info_Init_For_Tests( void )
     initInfo.remoteCandidatesArrayLength = REMOTE_CANDIDATE_ARRAY_SIZE;
     initInfo.candidatePairsArrayLength = CANDIDATE_PAIR_ARRAY_SIZE;
     initInfo.turnServerArrayLength = ICE_TURN_SERVER_ARRAY_SIZE;
+    initInfo.pCredentialPoolBuffer = &( credentialPool[ 0 ] );
+    initInfo.credentialPoolBufferLength = CREDENTIAL_POOL_SIZE;
     initInfo.isControlling = 1;
 }
 
 /*-----------------------------------------------------------*/
 
+/*
+ * The following function is used to store a credential of a TURN server in the
+ * credential pool of the context.
+ */
+static void Set_Turn_Server_Credential( IceContext_t * pContext,
+                                        IceTurnServer_t * pTurnServer,
+                                        IceTurnServerCredential_t credential,
+                                        const void * pValue,
+                                        size_t valueLength )
+{
+    IceResult_t result;
+
+    result = Ice_SetTurnServerCredential( pContext,
+                                          pTurnServer,
+                                          credential,
+                                          ( const uint8_t * ) pValue,
+                                          valueLength );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+}
+
+/*-----------------------------------------------------------*/
+
 void setUp( void )
 {
     memset( &( localCandidateArray[ 0 ] ),
@@ -438,6 +466,7 @@ void test_iceAddCandidatePair_BadParams( void )
 void test_iceAddCandidatePair_MaxCandidatePairThreshold( void )
 {
     IceContext_t context = { 0 };
+    size_t i;
     IceCandidate_t localCandidate = { 0 };
     IceCandidate_t remoteCandidate = { 0 };
     IceResult_t result;
@@ -450,6 +479,10 @@ void test_iceAddCandidatePair_MaxCandidatePairThreshold( void )
 
     /* Simulate having max possible candidate pairs. */
     context.numCandidatePairs = CANDIDATE_PAIR_ARRAY_SIZE;
+    for( i = 0; i < CANDIDATE_PAIR_ARRAY_SIZE; i++ )
+    {
+        context.pCandidatePairs[ i ].state = ICE_CANDIDATE_PAIR_STATE_WAITING;
+    }
 
     result = Ice_AddCandidatePair( &( context ),
                                    &( localCandidate ),
@@ -481,14 +514,451 @@ void test_iceAddCandidatePair_MaxTurnChannelNumber( void )
     context.numTurnServers = 1;
     localCandidate.pTurnServer = &( context.pTurnServers[ 0 ] );
     localCandidate.candidateType = ICE_CANDIDATE_TYPE_RELAY;
-    localCandidate.pTurnServer->nextAvailableTurnChannelNumber = ICE_DEFAULT_TURN_CHANNEL_NUMBER_MAX + 1;
+    memset( &( localCandidate.pTurnServer->turnChannelNumbersInUse[ 0 ] ),
+            0xFF,
+            sizeof( localCandidate.pTurnServer->turnChannelNumbersInUse ) );
+
+    result = Ice_AddCandidatePair( &( context ),
+                                   &( localCandidate ),
+                                   &( remoteCandidate ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_MAX_CHANNEL_NUMBER_THRESHOLD,
+                       result );
+    TEST_ASSERT_EQUAL( 0,
+                       context.numCandidatePairs );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that TURN channel numbers are taken from the hint onwards,
+ * wrap around at the end of the range and skip the numbers in use.
+ */
+void test_iceAllocateTurnChannelNumber_WrapAround( void )
+{
+    IceTurnServer_t turnServer;
+
+    memset( &( turnServer ),
+            0,
+            sizeof( IceTurnServer_t ) );
+
+    turnServer.nextAvailableTurnChannelNumber = ICE_TURN_CHANNEL_NUMBER_LAST;
+
+    TEST_ASSERT_EQUAL( ICE_TURN_CHANNEL_NUMBER_LAST,
+                       Ice_AllocateTurnChannelNumber( &( turnServer ) ) );
+
+    /* The hint is past the end of the range. */
+    TEST_ASSERT_EQUAL( ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN,
+                       Ice_AllocateTurnChannelNumber( &( turnServer ) ) );
+
+    /* Channel numbers in use are skipped. */
+    turnServer.turnChannelNumbersInUse[ 0 ] |= 0x2;
+    TEST_ASSERT_EQUAL( ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN + 2,
+                       Ice_AllocateTurnChannelNumber( &( turnServer ) ) );
+
+    /* A free channel number below the hint in the same word is found after
+     * wrapping around. */
+    memset( &( turnServer.turnChannelNumbersInUse[ 0 ] ),
+            0xFF,
+            sizeof( turnServer.turnChannelNumbersInUse ) );
+    turnServer.turnChannelNumbersInUse[ 1 ] &= ~( ( uint64_t ) 1 );
+    turnServer.nextAvailableTurnChannelNumber = ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN + 100;
+
+    TEST_ASSERT_EQUAL( ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN + 64,
+                       Ice_AllocateTurnChannelNumber( &( turnServer ) ) );
+    TEST_ASSERT_EQUAL( ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN + 65,
+                       turnServer.nextAvailableTurnChannelNumber );
+    TEST_ASSERT_EQUAL( 0,
+                       Ice_AllocateTurnChannelNumber( &( turnServer ) ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that the TURN channel number of a closed candidate pair is
+ * given to the next candidate pair once the hint wraps around.
+ */
+void test_iceReleaseTurnChannelNumber( void )
+{
+    IceContext_t context = { 0 };
+    IceCandidate_t localCandidate = { 0 };
+    IceCandidate_t remoteCandidate = { 0 };
+    IceCandidatePair_t candidatePair;
+    IceResult_t result;
+
+    result = Ice_Init( &( context ),
+                       &( initInfo ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    context.numTurnServers = 1;
+    localCandidate.pTurnServer = &( context.pTurnServers[ 0 ] );
+    localCandidate.candidateType = ICE_CANDIDATE_TYPE_RELAY;
+    localCandidate.pTurnServer->nextAvailableTurnChannelNumber = ICE_TURN_CHANNEL_NUMBER_LAST;
+
+    result = Ice_AddCandidatePair( &( context ),
+                                   &( localCandidate ),
+                                   &( remoteCandidate ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL( ICE_TURN_CHANNEL_NUMBER_LAST,
+                       context.pCandidatePairs[ 0 ].turnChannelNumber );
+
+    Ice_ReleaseCandidate( &( context ),
+                          &( remoteCandidate ) );
+
+    TEST_ASSERT_EQUAL( 0,
+                       context.pCandidatePairs[ 0 ].turnChannelNumber );
+    TEST_ASSERT_EQUAL( 0,
+                       context.pTurnServers[ 0 ].turnChannelNumbersInUse[ ICE_TURN_CHANNEL_NUMBER_BITMAP_WORDS - 1 ] );
+
+    /* Only the released channel number is free once the hint wraps around. */
+    memset( &( context.pTurnServers[ 0 ].turnChannelNumbersInUse[ 0 ] ),
+            0xFF,
+            sizeof( uint64_t ) * ( ICE_TURN_CHANNEL_NUMBER_BITMAP_WORDS - 1 ) );
+    context.pTurnServers[ 0 ].turnChannelNumbersInUse[ ICE_TURN_CHANNEL_NUMBER_BITMAP_WORDS - 1 ] = ~( ( ( uint64_t ) 1 ) << 63 );
+
+    TEST_ASSERT_EQUAL( ICE_TURN_CHANNEL_NUMBER_LAST,
+                       Ice_AllocateTurnChannelNumber( &( context.pTurnServers[ 0 ] ) ) );
+
+    /* A candidate pair without a channel number has nothing to release. */
+    memset( &( candidatePair ),
+            0,
+            sizeof( IceCandidatePair_t ) );
+    candidatePair.turnChannelNumber = ICE_DEFAULT_TURN_CHANNEL_NUMBER_MIN;
+
+    Ice_ReleaseTurnChannelNumber( &( candidatePair ) );
+
+    TEST_ASSERT_EQUAL( 0,
+                       candidatePair.turnChannelNumber );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that a new candidate pair reclaims the slot of the lowest
+ * priority closed candidate pair when the candidate pair array is full.
+ */
+void test_iceAddCandidatePair_ReclaimClosedCandidatePair( void )
+{
+    IceContext_t context = { 0 };
+    IceCandidate_t localCandidate = { 0 };
+    IceCandidate_t remoteCandidate = { 0 };
+    IceStunRequestTemplate_t stunRequestTemplates[ 1 ];
+    IceRequestCache_t requestCaches[ 1 ];
+    IceResult_t result;
+    size_t i;
+
+    initInfo.pStunRequestTemplatesArray = &( stunRequestTemplates[ 0 ] );
+    initInfo.stunRequestTemplatesArrayLength = 1;
+    initInfo.pRequestCachesArray = &( requestCaches[ 0 ] );
+    initInfo.requestCachesArrayLength = 1;
+
+    result = Ice_Init( &( context ),
+                       &( initInfo ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    /* The first candidate pair has the highest priority and gets the only
+     * request template and request cache. */
+    localCandidate.priority = 1000;
+    remoteCandidate.priority = 3000;
+
+    for( i = 0; i < CANDIDATE_PAIR_ARRAY_SIZE; i++ )
+    {
+        result = Ice_AddCandidatePair( &( context ),
+                                       &( localCandidate ),
+                                       &( remoteCandidate ) );
+
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+
+        remoteCandidate.priority = 1000;
+    }
+
+    TEST_ASSERT_EQUAL_PTR( &( stunRequestTemplates[ 0 ] ),
+                           context.pCandidatePairs[ 0 ].pStunRequestTemplate );
+    TEST_ASSERT_EQUAL_PTR( &( requestCaches[ 0 ] ),
+                           context.pCandidatePairs[ 0 ].pRequestCache );
+    stunRequestTemplates[ 0 ].messageLength = 20;
+    requestCaches[ 0 ].messageLength = 20;
+
+    /* No closed candidate pair to reclaim. */
+    result = Ice_AddCandidatePair( &( context ),
+                                   &( localCandidate ),
+                                   &( remoteCandidate ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_MAX_CANDIDATE_PAIR_THRESHOLD,
+                       result );
+
+    /* The new candidate pair takes over the request template and the request
+     * cache of the closed one. */
+    context.pCandidatePairs[ 0 ].state = ICE_CANDIDATE_PAIR_STATE_INVALID;
+    remoteCandidate.priority = 2000;
+
+    result = Ice_AddCandidatePair( &( context ),
+                                   &( localCandidate ),
+                                   &( remoteCandidate ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL( CANDIDATE_PAIR_ARRAY_SIZE,
+                       context.numCandidatePairs );
+    TEST_ASSERT_EQUAL( ICE_CANDIDATE_PAIR_STATE_WAITING,
+                       context.pCandidatePairs[ 0 ].state );
+    TEST_ASSERT_EQUAL_PTR( &( stunRequestTemplates[ 0 ] ),
+                           context.pCandidatePairs[ 0 ].pStunRequestTemplate );
+    TEST_ASSERT_EQUAL( 0,
+                       stunRequestTemplates[ 0 ].messageLength );
+    TEST_ASSERT_EQUAL_PTR( &( requestCaches[ 0 ] ),
+                           context.pCandidatePairs[ 0 ].pRequestCache );
+    TEST_ASSERT_EQUAL( 0,
+                       requestCaches[ 0 ].messageLength );
+
+    /* The lowest priority closed candidate pair is reclaimed first. */
+    context.pCandidatePairs[ 0 ].state = ICE_CANDIDATE_PAIR_STATE_FROZEN;
+    context.pCandidatePairs[ 5 ].state = ICE_CANDIDATE_PAIR_STATE_FROZEN;
+
+    result = Ice_AddCandidatePair( &( context ),
+                                   &( localCandidate ),
+                                   &( remoteCandidate ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL( ICE_CANDIDATE_PAIR_STATE_WAITING,
+                       context.pCandidatePairs[ 0 ].state );
+    TEST_ASSERT_EQUAL( ICE_CANDIDATE_PAIR_STATE_FROZEN,
+                       context.pCandidatePairs[ 1 ].state );
+
+    for( i = 2; i < CANDIDATE_PAIR_ARRAY_SIZE; i++ )
+    {
+        TEST_ASSERT_EQUAL( ICE_CANDIDATE_PAIR_STATE_WAITING,
+                           context.pCandidatePairs[ i ].state );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that a new candidate pair evicts the lowest priority waiting
+ * candidate pair when the candidate pair array is full and none is closed.
+ */
+void test_iceAddCandidatePair_EvictWaitingCandidatePair( void )
+{
+    IceContext_t context = { 0 };
+    IceCandidate_t localCandidate = { 0 };
+    IceCandidate_t remoteCandidate = { 0 };
+    IceCandidate_t newRemoteCandidate = { 0 };
+    IceResult_t result;
+    size_t i;
+
+    result = Ice_Init( &( context ),
+                       &( initInfo ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    localCandidate.priority = 1000;
+    remoteCandidate.priority = 1000;
+
+    for( i = 0; i < CANDIDATE_PAIR_ARRAY_SIZE; i++ )
+    {
+        result = Ice_AddCandidatePair( &( context ),
+                                       &( localCandidate ),
+                                       &( remoteCandidate ) );
+
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+    }
+
+    /* The lowest priority candidate pair is past its check, so the one before
+     * it is evicted. */
+    context.pCandidatePairs[ CANDIDATE_PAIR_ARRAY_SIZE - 1 ].state = ICE_CANDIDATE_PAIR_STATE_SUCCEEDED;
+    newRemoteCandidate.priority = 2000;
+
+    result = Ice_AddCandidatePair( &( context ),
+                                   &( localCandidate ),
+                                   &( newRemoteCandidate ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL( CANDIDATE_PAIR_ARRAY_SIZE,
+                       context.numCandidatePairs );
+    TEST_ASSERT_EQUAL_PTR( &( newRemoteCandidate ),
+                           context.pCandidatePairs[ 0 ].pRemoteCandidate );
+    TEST_ASSERT_EQUAL( ICE_CANDIDATE_PAIR_STATE_SUCCEEDED,
+                       context.pCandidatePairs[ CANDIDATE_PAIR_ARRAY_SIZE - 1 ].state );
+    TEST_ASSERT_EQUAL( ICE_CANDIDATE_PAIR_STATE_WAITING,
+                       context.pCandidatePairs[ CANDIDATE_PAIR_ARRAY_SIZE - 2 ].state );
+
+    /* No waiting candidate pair is left to evict. */
+    for( i = 0; i < CANDIDATE_PAIR_ARRAY_SIZE; i++ )
+    {
+        context.pCandidatePairs[ i ].state = ICE_CANDIDATE_PAIR_STATE_SUCCEEDED;
+    }
 
     result = Ice_AddCandidatePair( &( context ),
                                    &( localCandidate ),
+                                   &( newRemoteCandidate ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_MAX_CANDIDATE_PAIR_THRESHOLD,
+                       result );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that a full candidate pair array is left untouched when the
+ * new candidate pair cannot get a TURN channel number.
+ */
+void test_iceAddCandidatePair_FullMaxTurnChannelNumber( void )
+{
+    IceContext_t context = { 0 };
+    IceCandidate_t localCandidate = { 0 };
+    IceCandidate_t relayCandidate = { 0 };
+    IceCandidate_t remoteCandidate = { 0 };
+    IceResult_t result;
+    size_t i;
+
+    result = Ice_Init( &( context ),
+                       &( initInfo ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    localCandidate.priority = 1000;
+    remoteCandidate.priority = 1000;
+
+    for( i = 0; i < CANDIDATE_PAIR_ARRAY_SIZE; i++ )
+    {
+        result = Ice_AddCandidatePair( &( context ),
+                                       &( localCandidate ),
+                                       &( remoteCandidate ) );
+
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+    }
+
+    /* The new relay candidate pair would reclaim the closed candidate pair,
+     * but the TURN server has no channel number left. */
+    context.pCandidatePairs[ 0 ].state = ICE_CANDIDATE_PAIR_STATE_FROZEN;
+    context.numTurnServers = 1;
+    relayCandidate.pTurnServer = &( context.pTurnServers[ 0 ] );
+    relayCandidate.candidateType = ICE_CANDIDATE_TYPE_RELAY;
+    relayCandidate.priority = 2000;
+    memset( &( relayCandidate.pTurnServer->turnChannelNumbersInUse[ 0 ] ),
+            0xFF,
+            sizeof( relayCandidate.pTurnServer->turnChannelNumbersInUse ) );
+
+    result = Ice_AddCandidatePair( &( context ),
+                                   &( relayCandidate ),
+                                   &( remoteCandidate ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_MAX_CHANNEL_NUMBER_THRESHOLD,
+                       result );
+    TEST_ASSERT_EQUAL( CANDIDATE_PAIR_ARRAY_SIZE,
+                       context.numCandidatePairs );
+    TEST_ASSERT_EQUAL( ICE_CANDIDATE_PAIR_STATE_FROZEN,
+                       context.pCandidatePairs[ 0 ].state );
+
+    /* The same goes for evicting a waiting candidate pair. */
+    context.pCandidatePairs[ 0 ].state = ICE_CANDIDATE_PAIR_STATE_WAITING;
+
+    result = Ice_AddCandidatePair( &( context ),
+                                   &( relayCandidate ),
                                    &( remoteCandidate ) );
 
     TEST_ASSERT_EQUAL( ICE_RESULT_MAX_CHANNEL_NUMBER_THRESHOLD,
                        result );
+    TEST_ASSERT_EQUAL( CANDIDATE_PAIR_ARRAY_SIZE,
+                       context.numCandidatePairs );
+
+    for( i = 0; i < CANDIDATE_PAIR_ARRAY_SIZE; i++ )
+    {
+        TEST_ASSERT_EQUAL_PTR( &( localCandidate ),
+                               context.pCandidatePairs[ i ].pLocalCandidate );
+        TEST_ASSERT_EQUAL( ICE_CANDIDATE_PAIR_STATE_WAITING,
+                           context.pCandidatePairs[ i ].state );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that the nominated candidate pair is followed when candidate
+ * pairs are inserted or removed before it, and forgotten when it is removed.
+ */
+void test_iceRemoveCandidatePair_NominatedPair( void )
+{
+    IceContext_t context = { 0 };
+    IceCandidate_t localCandidate = { 0 };
+    IceCandidate_t remoteCandidates[ 4 ];
+    IceResult_t result;
+    size_t i;
+
+    result = Ice_Init( &( context ),
+                       &( initInfo ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    memset( &( remoteCandidates[ 0 ] ),
+            0,
+            sizeof( remoteCandidates ) );
+    localCandidate.priority = 1000;
+
+    for( i = 0; i < 3; i++ )
+    {
+        remoteCandidates[ i ].priority = ( uint32_t ) ( 3000 - ( 1000 * i ) );
+
+        result = Ice_AddCandidatePair( &( context ),
+                                       &( localCandidate ),
+                                       &( remoteCandidates[ i ] ) );
+
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+    }
+
+    context.pNominatedPair = &( context.pCandidatePairs[ 1 ] );
+
+    /* A higher priority candidate pair is inserted before it. */
+    remoteCandidates[ 3 ].priority = 4000;
+
+    result = Ice_AddCandidatePair( &( context ),
+                                   &( localCandidate ),
+                                   &( remoteCandidates[ 3 ] ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL_PTR( &( remoteCandidates[ 1 ] ),
+                           context.pNominatedPair->pRemoteCandidate );
+
+    /* A candidate pair after it is removed. */
+    Ice_RemoveCandidatePair( &( context ),
+                             3 );
+
+    TEST_ASSERT_EQUAL_PTR( &( context.pCandidatePairs[ 2 ] ),
+                           context.pNominatedPair );
+
+    /* A candidate pair before it is removed. */
+    Ice_RemoveCandidatePair( &( context ),
+                             0 );
+
+    TEST_ASSERT_EQUAL_PTR( &( context.pCandidatePairs[ 1 ] ),
+                           context.pNominatedPair );
+    TEST_ASSERT_EQUAL_PTR( &( remoteCandidates[ 1 ] ),
+                           context.pNominatedPair->pRemoteCandidate );
+
+    /* The nominated candidate pair itself is removed. */
+    Ice_RemoveCandidatePair( &( context ),
+                             1 );
+
+    TEST_ASSERT_NULL( context.pNominatedPair );
+    TEST_ASSERT_EQUAL( 1,
+                       context.numCandidatePairs );
 }
 
 /*-----------------------------------------------------------*/
@@ -733,7 +1203,7 @@ void test_iceCreateRequestForConnectivityCheck_ResponseAlreadyReceived( void )
                        result );
 
     /* Assume that this candidate pair has sent binding request and received binding success response before calling Ice_CreateRequestForConnectivityCheck. */
-    context.pCandidatePairs[ 0 ].connectivityCheckFlags |= ICE_STUN_REQUEST_SENT_FLAG | ICE_STUN_RESPONSE_RECEIVED_FLAG;
+    context.pCandidatePairs[ 0 ].flags |= ICE_STUN_REQUEST_SENT_FLAG | ICE_STUN_RESPONSE_RECEIVED_FLAG;
 
     result = Ice_CreateRequestForConnectivityCheck( &( context ),
                                                     &( context.pCandidatePairs[ 0 ] ),
@@ -1070,8 +1540,8 @@ void test_iceCreateRequestForConnectivityCheck_TurnChannelHeader( void )
     TEST_ASSERT_EQUAL( ICE_RESULT_OK,
                        result );
 
-    context.cryptoFunctions.hmacFxn = testHmacFxn_FixedFF;
-    context.cryptoFunctions.crc32Fxn = testCrc32Fxn_Fixed;
+    context.config.cryptoFunctions.hmacFxn = testHmacFxn_FixedFF;
+    context.config.cryptoFunctions.crc32Fxn = testCrc32Fxn_Fixed;
 
     endpoint.isPointToPoint = 1;
     endpoint.transportAddress.family = 0;
@@ -1402,8 +1872,8 @@ void test_iceCreateRequestForNominatingCandidatePair_TurnChannelHeader( void )
     TEST_ASSERT_EQUAL( ICE_RESULT_OK,
                        result );
 
-    context.cryptoFunctions.hmacFxn = testHmacFxn_FixedFF;
-    context.cryptoFunctions.crc32Fxn = testCrc32Fxn_Fixed;
+    context.config.cryptoFunctions.hmacFxn = testHmacFxn_FixedFF;
+    context.config.cryptoFunctions.crc32Fxn = testCrc32Fxn_Fixed;
 
     endpoint.isPointToPoint = 1;
     endpoint.transportAddress.family = 0;
@@ -1564,14 +2034,16 @@ void test_iceCreateRequestForNominatingCandidatePair_StunBufferTooSmallToAddUser
     memset( &( localCandidate ), 0, sizeof( IceCandidate_t ) );
     context.numTurnServers = 1;
     localCandidate.pTurnServer = &( context.pTurnServers[ 0 ] );
-    memcpy( &( localCandidate.pTurnServer->userName[ 0 ] ),
-            pUsername,
-            usernameLength );
-    localCandidate.pTurnServer->userNameLength = usernameLength;
-    memcpy( &( localCandidate.pTurnServer->password[ 0 ] ),
-            pPassword,
-            passwordLength );
-    localCandidate.pTurnServer->passwordLength = passwordLength;
+    Set_Turn_Server_Credential( &( context ),
+                                localCandidate.pTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_USER_NAME,
+                                pUsername,
+                                usernameLength );
+    Set_Turn_Server_Credential( &( context ),
+                                localCandidate.pTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_PASSWORD,
+                                pPassword,
+                                passwordLength );
 
     result = Ice_CreateRefreshRequest( &( context ),
                                        &( localCandidate ),
@@ -1614,22 +2086,26 @@ void test_iceCreateRequestForNominatingCandidatePair_StunBufferTooSmallToAddReal
     memset( &( localCandidate ), 0, sizeof( IceCandidate_t ) );
     context.numTurnServers = 1;
     localCandidate.pTurnServer = &( context.pTurnServers[ 0 ] );
-    memcpy( &( localCandidate.pTurnServer->userName[ 0 ] ),
-            pUsername,
-            usernameLength );
-    localCandidate.pTurnServer->userNameLength = usernameLength;
-    memcpy( &( localCandidate.pTurnServer->password[ 0 ] ),
-            pPassword,
-            passwordLength );
-    localCandidate.pTurnServer->passwordLength = passwordLength;
-    memcpy( &( localCandidate.pTurnServer->realm[ 0 ] ),
-            pRealm,
-            realmLength );
-    localCandidate.pTurnServer->realmLength = realmLength;
-    memcpy( &( localCandidate.pTurnServer->nonce[ 0 ] ),
-            pNonce,
-            nonceLength );
-    localCandidate.pTurnServer->nonceLength = nonceLength;
+    Set_Turn_Server_Credential( &( context ),
+                                localCandidate.pTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_USER_NAME,
+                                pUsername,
+                                usernameLength );
+    Set_Turn_Server_Credential( &( context ),
+                                localCandidate.pTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_PASSWORD,
+                                pPassword,
+                                passwordLength );
+    Set_Turn_Server_Credential( &( context ),
+                                localCandidate.pTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_REALM,
+                                pRealm,
+                                realmLength );
+    Set_Turn_Server_Credential( &( context ),
+                                localCandidate.pTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_NONCE,
+                                pNonce,
+                                nonceLength );
 
     result = Ice_CreateRefreshRequest( &( context ),
                                        &( localCandidate ),
@@ -1672,22 +2148,26 @@ void test_iceCreateRequestForNominatingCandidatePair_StunBufferTooSmallToAddNonc
     memset( &( localCandidate ), 0, sizeof( IceCandidate_t ) );
     context.numTurnServers = 1;
     localCandidate.pTurnServer = &( context.pTurnServers[ 0 ] );
-    memcpy( &( localCandidate.pTurnServer->userName[ 0 ] ),
-            pUsername,
-            usernameLength );
-    localCandidate.pTurnServer->userNameLength = usernameLength;
-    memcpy( &( localCandidate.pTurnServer->password[ 0 ] ),
-            pPassword,
-            passwordLength );
-    localCandidate.pTurnServer->passwordLength = passwordLength;
-    memcpy( &( localCandidate.pTurnServer->realm[ 0 ] ),
-            pRealm,
-            realmLength );
-    localCandidate.pTurnServer->realmLength = realmLength;
-    memcpy( &( localCandidate.pTurnServer->nonce[ 0 ] ),
-            pNonce,
-            nonceLength );
-    localCandidate.pTurnServer->nonceLength = nonceLength;
+    Set_Turn_Server_Credential( &( context ),
+                                localCandidate.pTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_USER_NAME,
+                                pUsername,
+                                usernameLength );
+    Set_Turn_Server_Credential( &( context ),
+                                localCandidate.pTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_PASSWORD,
+                                pPassword,
+                                passwordLength );
+    Set_Turn_Server_Credential( &( context ),
+                                localCandidate.pTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_REALM,
+                                pRealm,
+                                realmLength );
+    Set_Turn_Server_Credential( &( context ),
+                                localCandidate.pTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_NONCE,
+                                pNonce,
+                                nonceLength );
 
     result = Ice_CreateRefreshRequest( &( context ),
                                        &( localCandidate ),
@@ -2004,3 +2484,181 @@ void test_iceComputeCandidatePriority_Relayed( void )
 }
 
 /*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that the credentials of a TURN server are kept together in
+ * the credential pool when they are replaced.
+ */
+void test_iceSetTurnServerCredential( void )
+{
+    IceContext_t context = { 0 };
+    IceTurnServer_t * pFirstTurnServer;
+    IceTurnServer_t * pSecondTurnServer;
+    uint8_t longNonce[ ICE_TURN_SERVER_CREDENTIALS_RESERVE_LENGTH + 1 ];
+    IceResult_t result;
+
+    memset( &( longNonce[ 0 ] ),
+            'n',
+            sizeof( longNonce ) );
+
+    result = Ice_Init( &( context ),
+                       &( initInfo ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    pFirstTurnServer = &( context.pTurnServers[ 0 ] );
+    pSecondTurnServer = &( context.pTurnServers[ 1 ] );
+    context.numTurnServers = 2;
+
+    Set_Turn_Server_Credential( &( context ),
+                                pFirstTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_USER_NAME,
+                                "user",
+                                strlen( "user" ) );
+    Set_Turn_Server_Credential( &( context ),
+                                pFirstTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_NONCE,
+                                "nonce",
+                                strlen( "nonce" ) );
+    Set_Turn_Server_Credential( &( context ),
+                                pSecondTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_USER_NAME,
+                                "second",
+                                strlen( "second" ) );
+
+    /* The first server fits in its reserved space. */
+    TEST_ASSERT_EQUAL( 0,
+                       pFirstTurnServer->credentialsOffset );
+    TEST_ASSERT_EQUAL( strlen( "user" ) + ICE_TURN_SERVER_CREDENTIALS_RESERVE_LENGTH,
+                       pFirstTurnServer->credentialsCapacity );
+    TEST_ASSERT_EQUAL( pFirstTurnServer->credentialsCapacity,
+                       pSecondTurnServer->credentialsOffset );
+
+    /* Inserting the realm moves the nonce after it. */
+    Set_Turn_Server_Credential( &( context ),
+                                pFirstTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_REALM,
+                                "realm",
+                                strlen( "realm" ) );
+
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( "userrealmnonce",
+                                   Ice_GetTurnServerCredential( &( context ), pFirstTurnServer, ICE_TURN_SERVER_CREDENTIAL_USER_NAME ),
+                                   strlen( "userrealmnonce" ) );
+
+    /* A nonce larger than the reserved space moves the first server to the
+     * end of the pool. */
+    Set_Turn_Server_Credential( &( context ),
+                                pFirstTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_NONCE,
+                                &( longNonce[ 0 ] ),
+                                sizeof( longNonce ) );
+
+    TEST_ASSERT_EQUAL( pSecondTurnServer->credentialsOffset + pSecondTurnServer->credentialsCapacity,
+                       pFirstTurnServer->credentialsOffset );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( "userrealm",
+                                   Ice_GetTurnServerCredential( &( context ), pFirstTurnServer, ICE_TURN_SERVER_CREDENTIAL_USER_NAME ),
+                                   strlen( "userrealm" ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &( longNonce[ 0 ] ),
+                                   Ice_GetTurnServerCredential( &( context ), pFirstTurnServer, ICE_TURN_SERVER_CREDENTIAL_NONCE ),
+                                   sizeof( longNonce ) );
+
+    /* The last server in the pool grows in place. */
+    Set_Turn_Server_Credential( &( context ),
+                                pFirstTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_PASSWORD,
+                                &( longNonce[ 0 ] ),
+                                sizeof( longNonce ) );
+
+    TEST_ASSERT_EQUAL( pSecondTurnServer->credentialsOffset + pSecondTurnServer->credentialsCapacity,
+                       pFirstTurnServer->credentialsOffset );
+    TEST_ASSERT_EQUAL( context.credentialPoolUsed,
+                       pFirstTurnServer->credentialsOffset + pFirstTurnServer->credentialsCapacity );
+
+    /* The pool is full. */
+    result = Ice_SetTurnServerCredential( &( context ),
+                                          pSecondTurnServer,
+                                          ICE_TURN_SERVER_CREDENTIAL_PASSWORD,
+                                          &( credentialPool[ 0 ] ),
+                                          CREDENTIAL_POOL_SIZE );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OUT_OF_MEMORY,
+                       result );
+    TEST_ASSERT_EQUAL( 0,
+                       pSecondTurnServer->credentialLengths[ ICE_TURN_SERVER_CREDENTIAL_PASSWORD ] );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that the credential pool is compacted when a TURN server
+ * outgrows its space and the end of the pool is reached.
+ */
+void test_iceSetTurnServerCredential_CompactCredentialPool( void )
+{
+    IceContext_t context = { 0 };
+    IceTurnServer_t * pFirstTurnServer;
+    IceTurnServer_t * pSecondTurnServer;
+    uint8_t longNonce[ ICE_TURN_SERVER_CREDENTIALS_RESERVE_LENGTH + 1 ];
+    size_t poolLength;
+    IceResult_t result;
+
+    memset( &( longNonce[ 0 ] ),
+            'n',
+            sizeof( longNonce ) );
+
+    /* Room for both usernames with their reserved space but not for the long
+     * nonce at the end. */
+    poolLength = strlen( "first" ) + strlen( "second" ) + ( 2 * ICE_TURN_SERVER_CREDENTIALS_RESERVE_LENGTH ) + sizeof( longNonce ) - 1;
+    initInfo.credentialPoolBufferLength = poolLength;
+
+    result = Ice_Init( &( context ),
+                       &( initInfo ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    pFirstTurnServer = &( context.pTurnServers[ 0 ] );
+    pSecondTurnServer = &( context.pTurnServers[ 1 ] );
+    context.numTurnServers = 2;
+
+    Set_Turn_Server_Credential( &( context ),
+                                pFirstTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_USER_NAME,
+                                "first",
+                                strlen( "first" ) );
+    Set_Turn_Server_Credential( &( context ),
+                                pSecondTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_USER_NAME,
+                                "second",
+                                strlen( "second" ) );
+
+    /* The nonce fits neither in the space of the first server nor at the end
+     * of the pool. Compaction trims both servers to their credentials and the
+     * first server then moves after the second one. */
+    Set_Turn_Server_Credential( &( context ),
+                                pFirstTurnServer,
+                                ICE_TURN_SERVER_CREDENTIAL_NONCE,
+                                &( longNonce[ 0 ] ),
+                                sizeof( longNonce ) );
+
+    TEST_ASSERT_EQUAL( strlen( "first" ),
+                       pSecondTurnServer->credentialsOffset );
+    TEST_ASSERT_EQUAL( strlen( "second" ),
+                       pSecondTurnServer->credentialsCapacity );
+    TEST_ASSERT_EQUAL( strlen( "first" ) + strlen( "second" ),
+                       pFirstTurnServer->credentialsOffset );
+    TEST_ASSERT_EQUAL( context.credentialPoolUsed,
+                       pFirstTurnServer->credentialsOffset + pFirstTurnServer->credentialsCapacity );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( "second",
+                                   Ice_GetTurnServerCredential( &( context ), pSecondTurnServer, ICE_TURN_SERVER_CREDENTIAL_USER_NAME ),
+                                   strlen( "second" ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( "first",
+                                   Ice_GetTurnServerCredential( &( context ), pFirstTurnServer, ICE_TURN_SERVER_CREDENTIAL_USER_NAME ),
+                                   strlen( "first" ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &( longNonce[ 0 ] ),
+                                   Ice_GetTurnServerCredential( &( context ), pFirstTurnServer, ICE_TURN_SERVER_CREDENTIAL_NONCE ),
+                                   sizeof( longNonce ) );
+}
+
+/*-----------------------------------------------------------*/
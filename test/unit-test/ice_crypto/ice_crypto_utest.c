@@ -0,0 +1,947 @@
+/* Unity includes. */
+#include "unity.h"
+#include "catch_assert.h"
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+
+/* API includes. */
+#include "ice_crypto.h"
+
+/* ===========================  EXTERN VARIABLES    =========================== */
+
+/*
+ * Length of the generated message used in the streaming tests. The message is
+ * generated as pMessage[ i ] = i % 251.
+ */
+#define TEST_STREAMING_MESSAGE_LENGTH    ( 1000 )
+
+/*
+ * SHA-1 implementations to exercise. Implementations not supported by the
+ * host are skipped.
+ */
+static const IceCryptoSha1Implementation_t sha1Implementations[] =
+{
+    ICE_CRYPTO_SHA1_IMPLEMENTATION_PORTABLE,
+    ICE_CRYPTO_SHA1_IMPLEMENTATION_X86_SHA_NI,
+    ICE_CRYPTO_SHA1_IMPLEMENTATION_ARMV8_SHA1
+};
+
+/* ===========================  EXTERN FUNCTIONS   =========================== */
+
+static void GenerateStreamingMessage( uint8_t * pMessage )
+{
+    size_t i;
+
+    for( i = 0; i < TEST_STREAMING_MESSAGE_LENGTH; i++ )
+    {
+        pMessage[ i ] = ( uint8_t ) ( i % 251 );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+void tearDown( void )
+{
+    ( void ) IceCrypto_SetSha1Implementation( ICE_CRYPTO_SHA1_IMPLEMENTATION_AUTO );
+}
+
+/* ==============================  Test Cases  ============================== */
+
+/**
+ * @brief Validate that the SHA-1 implementation is selected on first use.
+ */
+void test_iceCrypto_GetSha1Implementation_SelectedOnFirstUse( void )
+{
+    IceCryptoSha1Implementation_t implementation;
+
+    implementation = IceCrypto_GetSha1Implementation();
+
+    TEST_ASSERT_NOT_EQUAL( ICE_CRYPTO_SHA1_IMPLEMENTATION_AUTO,
+                           implementation );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that the portable SHA-1 implementation can always be
+ * selected.
+ */
+void test_iceCrypto_SetSha1Implementation_Portable( void )
+{
+    IceResult_t result;
+
+    result = IceCrypto_SetSha1Implementation( ICE_CRYPTO_SHA1_IMPLEMENTATION_PORTABLE );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL( ICE_CRYPTO_SHA1_IMPLEMENTATION_PORTABLE,
+                       IceCrypto_GetSha1Implementation() );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that automatic selection resolves to a concrete
+ * implementation.
+ */
+void test_iceCrypto_SetSha1Implementation_Auto( void )
+{
+    IceResult_t result;
+
+    result = IceCrypto_SetSha1Implementation( ICE_CRYPTO_SHA1_IMPLEMENTATION_AUTO );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_NOT_EQUAL( ICE_CRYPTO_SHA1_IMPLEMENTATION_AUTO,
+                           IceCrypto_GetSha1Implementation() );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that selecting an unknown implementation fails and keeps the
+ * current selection.
+ */
+void test_iceCrypto_SetSha1Implementation_NotSupported( void )
+{
+    IceResult_t result;
+
+    result = IceCrypto_SetSha1Implementation( ICE_CRYPTO_SHA1_IMPLEMENTATION_PORTABLE );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    result = IceCrypto_SetSha1Implementation( ( IceCryptoSha1Implementation_t ) 0xFF );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_CRYPTO_IMPLEMENTATION_NOT_SUPPORTED,
+                       result );
+    TEST_ASSERT_EQUAL( ICE_CRYPTO_SHA1_IMPLEMENTATION_PORTABLE,
+                       IceCrypto_GetSha1Implementation() );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate SHA-1 fail functionality for Bad Parameters.
+ */
+void test_iceCrypto_Sha1_BadParams( void )
+{
+    IceCryptoSha1Context_t sha1Context;
+    uint8_t digest[ ICE_CRYPTO_SHA1_DIGEST_LENGTH ];
+    uint16_t digestLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH;
+    IceResult_t result;
+
+    result = IceCrypto_Sha1Init( NULL );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Sha1Init( &( sha1Context ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    result = IceCrypto_Sha1Update( NULL,
+                                   &( digest[ 0 ] ),
+                                   1 );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Sha1Update( &( sha1Context ),
+                                   NULL,
+                                   1 );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Sha1Final( NULL,
+                                  &( digest[ 0 ] ),
+                                  &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Sha1Final( &( sha1Context ),
+                                  NULL,
+                                  &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Sha1Final( &( sha1Context ),
+                                  &( digest[ 0 ] ),
+                                  NULL );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    digestLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH - 1;
+
+    result = IceCrypto_Sha1Final( &( sha1Context ),
+                                  &( digest[ 0 ] ),
+                                  &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate SHA-1 against the FIPS 180 test vectors with every SHA-1
+ * implementation supported by the host.
+ */
+void test_iceCrypto_Sha1_KnownVectors( void )
+{
+    IceCryptoSha1Context_t sha1Context;
+    uint8_t digest[ ICE_CRYPTO_SHA1_DIGEST_LENGTH ];
+    uint16_t digestLength;
+    IceResult_t result;
+    size_t i;
+    const char * pMessageAbc = "abc";
+    const char * pMessage448Bits = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    uint8_t expectedDigestAbc[] =
+    {
+        0xA9, 0x99, 0x3E, 0x36, 0x47, 0x06, 0x81, 0x6A,
+        0xBA, 0x3E, 0x25, 0x71, 0x78, 0x50, 0xC2, 0x6C,
+        0x9C, 0xD0, 0xD8, 0x9D,
+    };
+    uint8_t expectedDigestEmpty[] =
+    {
+        0xDA, 0x39, 0xA3, 0xEE, 0x5E, 0x6B, 0x4B, 0x0D,
+        0x32, 0x55, 0xBF, 0xEF, 0x95, 0x60, 0x18, 0x90,
+        0xAF, 0xD8, 0x07, 0x09,
+    };
+    uint8_t expectedDigest448Bits[] =
+    {
+        0x84, 0x98, 0x3E, 0x44, 0x1C, 0x3B, 0xD2, 0x6E,
+        0xBA, 0xAE, 0x4A, 0xA1, 0xF9, 0x51, 0x29, 0xE5,
+        0xE5, 0x46, 0x70, 0xF1,
+    };
+
+    for( i = 0; i < sizeof( sha1Implementations ) / sizeof( sha1Implementations[ 0 ] ); i++ )
+    {
+        if( IceCrypto_SetSha1Implementation( sha1Implementations[ i ] ) != ICE_RESULT_OK )
+        {
+            continue;
+        }
+
+        /* "abc". */
+        digestLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH;
+        result = IceCrypto_Sha1Init( &( sha1Context ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        result = IceCrypto_Sha1Update( &( sha1Context ),
+                                       ( const uint8_t * ) pMessageAbc,
+                                       strlen( pMessageAbc ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        result = IceCrypto_Sha1Final( &( sha1Context ),
+                                      &( digest[ 0 ] ),
+                                      &( digestLength ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        TEST_ASSERT_EQUAL( ICE_CRYPTO_SHA1_DIGEST_LENGTH,
+                           digestLength );
+        TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedDigestAbc[ 0 ] ),
+                                       &( digest[ 0 ] ),
+                                       ICE_CRYPTO_SHA1_DIGEST_LENGTH );
+
+        /* Empty message. */
+        result = IceCrypto_Sha1Init( &( sha1Context ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        result = IceCrypto_Sha1Update( &( sha1Context ),
+                                       NULL,
+                                       0 );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        result = IceCrypto_Sha1Final( &( sha1Context ),
+                                      &( digest[ 0 ] ),
+                                      &( digestLength ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedDigestEmpty[ 0 ] ),
+                                       &( digest[ 0 ] ),
+                                       ICE_CRYPTO_SHA1_DIGEST_LENGTH );
+
+        /* 56 byte message - the length field does not fit in the last block. */
+        result = IceCrypto_Sha1Init( &( sha1Context ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        result = IceCrypto_Sha1Update( &( sha1Context ),
+                                       ( const uint8_t * ) pMessage448Bits,
+                                       strlen( pMessage448Bits ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        result = IceCrypto_Sha1Final( &( sha1Context ),
+                                      &( digest[ 0 ] ),
+                                      &( digestLength ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedDigest448Bits[ 0 ] ),
+                                       &( digest[ 0 ] ),
+                                       ICE_CRYPTO_SHA1_DIGEST_LENGTH );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that SHA-1 produces the same digest regardless of how the
+ * input is split across updates, and that Final clears the context.
+ */
+void test_iceCrypto_Sha1_Streaming( void )
+{
+    IceCryptoSha1Context_t sha1Context;
+    IceCryptoSha1Context_t zeroContext;
+    uint8_t message[ TEST_STREAMING_MESSAGE_LENGTH ];
+    uint8_t digest[ ICE_CRYPTO_SHA1_DIGEST_LENGTH ];
+    uint16_t digestLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH;
+    size_t chunkLengths[] = { 1, 7, 63, 64, 65, 128, 200 };
+    size_t i, j, offset, chunkLength;
+    IceResult_t result;
+    uint8_t expectedDigest[] =
+    {
+        0xC9, 0xC9, 0x60, 0xA0, 0xB9, 0x25, 0x47, 0x4F,
+        0xAB, 0x83, 0x94, 0x2C, 0xC2, 0x7D, 0x50, 0x4F,
+        0xC2, 0x4A, 0xC3, 0x7B,
+    };
+
+    GenerateStreamingMessage( &( message[ 0 ] ) );
+
+    for( i = 0; i < sizeof( sha1Implementations ) / sizeof( sha1Implementations[ 0 ] ); i++ )
+    {
+        if( IceCrypto_SetSha1Implementation( sha1Implementations[ i ] ) != ICE_RESULT_OK )
+        {
+            continue;
+        }
+
+        result = IceCrypto_Sha1Init( &( sha1Context ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+
+        offset = 0;
+        j = 0;
+
+        while( offset < TEST_STREAMING_MESSAGE_LENGTH )
+        {
+            chunkLength = chunkLengths[ j % ( sizeof( chunkLengths ) / sizeof( chunkLengths[ 0 ] ) ) ];
+            chunkLength = ( chunkLength < ( TEST_STREAMING_MESSAGE_LENGTH - offset ) ) ? chunkLength :
+                          ( TEST_STREAMING_MESSAGE_LENGTH - offset );
+
+            result = IceCrypto_Sha1Update( &( sha1Context ),
+                                           &( message[ offset ] ),
+                                           chunkLength );
+            TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                               result );
+
+            offset += chunkLength;
+            j++;
+        }
+
+        result = IceCrypto_Sha1Final( &( sha1Context ),
+                                      &( digest[ 0 ] ),
+                                      &( digestLength ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedDigest[ 0 ] ),
+                                       &( digest[ 0 ] ),
+                                       ICE_CRYPTO_SHA1_DIGEST_LENGTH );
+
+        /* The hashed data is dropped from the context. */
+        memset( &( zeroContext ),
+                0,
+                sizeof( zeroContext ) );
+        TEST_ASSERT_EQUAL_UINT8_ARRAY( ( const uint8_t * ) &( zeroContext ),
+                                       ( const uint8_t * ) &( sha1Context ),
+                                       sizeof( zeroContext ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate MD5 fail functionality for Bad Parameters.
+ */
+void test_iceCrypto_Md5_BadParams( void )
+{
+    IceCryptoMd5Context_t md5Context;
+    uint8_t digest[ ICE_CRYPTO_MD5_DIGEST_LENGTH ];
+    uint16_t digestLength = ICE_CRYPTO_MD5_DIGEST_LENGTH;
+    IceResult_t result;
+
+    result = IceCrypto_Md5Init( NULL );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Md5Init( &( md5Context ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    result = IceCrypto_Md5Update( NULL,
+                                  &( digest[ 0 ] ),
+                                  1 );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Md5Update( &( md5Context ),
+                                  NULL,
+                                  1 );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Md5Final( NULL,
+                                 &( digest[ 0 ] ),
+                                 &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Md5Final( &( md5Context ),
+                                 NULL,
+                                 &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Md5Final( &( md5Context ),
+                                 &( digest[ 0 ] ),
+                                 NULL );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    digestLength = ICE_CRYPTO_MD5_DIGEST_LENGTH - 1;
+
+    result = IceCrypto_Md5Final( &( md5Context ),
+                                 &( digest[ 0 ] ),
+                                 &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Md5( NULL,
+                            1,
+                            &( digest[ 0 ] ),
+                            &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_Md5( ( const uint8_t * ) "abc",
+                            3,
+                            NULL,
+                            &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate MD5 against the RFC 1321 test vectors.
+ */
+void test_iceCrypto_Md5_KnownVectors( void )
+{
+    uint8_t digest[ ICE_CRYPTO_MD5_DIGEST_LENGTH ];
+    uint16_t digestLength = ICE_CRYPTO_MD5_DIGEST_LENGTH;
+    IceResult_t result;
+    const char * pMessageAbc = "abc";
+    const char * pMessage80 = "12345678901234567890123456789012345678901234567890123456789012345678901234567890";
+    uint8_t message56[ 56 ];
+    uint8_t expectedDigestEmpty[] =
+    {
+        0xD4, 0x1D, 0x8C, 0xD9, 0x8F, 0x00, 0xB2, 0x04,
+        0xE9, 0x80, 0x09, 0x98, 0xEC, 0xF8, 0x42, 0x7E,
+    };
+    uint8_t expectedDigestAbc[] =
+    {
+        0x90, 0x01, 0x50, 0x98, 0x3C, 0xD2, 0x4F, 0xB0,
+        0xD6, 0x96, 0x3F, 0x7D, 0x28, 0xE1, 0x7F, 0x72,
+    };
+    uint8_t expectedDigest80[] =
+    {
+        0x57, 0xED, 0xF4, 0xA2, 0x2B, 0xE3, 0xC9, 0x55,
+        0xAC, 0x49, 0xDA, 0x2E, 0x21, 0x07, 0xB6, 0x7A,
+    };
+    /* MD5 of 56 'a' characters - the length field does not fit in the last
+     * block. */
+    uint8_t expectedDigest56[] =
+    {
+        0x3B, 0x0C, 0x8A, 0xC7, 0x03, 0xF8, 0x28, 0xB0,
+        0x4C, 0x6C, 0x19, 0x70, 0x06, 0xD1, 0x72, 0x18,
+    };
+
+    result = IceCrypto_Md5( NULL,
+                            0,
+                            &( digest[ 0 ] ),
+                            &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL( ICE_CRYPTO_MD5_DIGEST_LENGTH,
+                       digestLength );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedDigestEmpty[ 0 ] ),
+                                   &( digest[ 0 ] ),
+                                   ICE_CRYPTO_MD5_DIGEST_LENGTH );
+
+    result = IceCrypto_Md5( ( const uint8_t * ) pMessageAbc,
+                            strlen( pMessageAbc ),
+                            &( digest[ 0 ] ),
+                            &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedDigestAbc[ 0 ] ),
+                                   &( digest[ 0 ] ),
+                                   ICE_CRYPTO_MD5_DIGEST_LENGTH );
+
+    result = IceCrypto_Md5( ( const uint8_t * ) pMessage80,
+                            strlen( pMessage80 ),
+                            &( digest[ 0 ] ),
+                            &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedDigest80[ 0 ] ),
+                                   &( digest[ 0 ] ),
+                                   ICE_CRYPTO_MD5_DIGEST_LENGTH );
+
+    memset( &( message56[ 0 ] ),
+            'a',
+            sizeof( message56 ) );
+
+    result = IceCrypto_Md5( &( message56[ 0 ] ),
+                            sizeof( message56 ),
+                            &( digest[ 0 ] ),
+                            &( digestLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedDigest56[ 0 ] ),
+                                   &( digest[ 0 ] ),
+                                   ICE_CRYPTO_MD5_DIGEST_LENGTH );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that MD5 produces the same digest regardless of how the
+ * input is split across updates, and that Final clears the context.
+ */
+void test_iceCrypto_Md5_Streaming( void )
+{
+    IceCryptoMd5Context_t md5Context;
+    IceCryptoMd5Context_t zeroContext;
+    uint8_t message[ TEST_STREAMING_MESSAGE_LENGTH ];
+    uint8_t digest[ ICE_CRYPTO_MD5_DIGEST_LENGTH ];
+    uint16_t digestLength = ICE_CRYPTO_MD5_DIGEST_LENGTH;
+    size_t chunkLengths[] = { 1, 7, 63, 64, 65, 128, 200 };
+    size_t j, offset, chunkLength;
+    IceResult_t result;
+    uint8_t expectedDigest[] =
+    {
+        0xA2, 0x4F, 0x1E, 0x3E, 0xF6, 0x69, 0x50, 0xE1,
+        0x32, 0x7F, 0x21, 0x0E, 0x39, 0x97, 0xBA, 0x2C,
+    };
+
+    GenerateStreamingMessage( &( message[ 0 ] ) );
+
+    result = IceCrypto_Md5Init( &( md5Context ) );
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    offset = 0;
+    j = 0;
+
+    while( offset < TEST_STREAMING_MESSAGE_LENGTH )
+    {
+        chunkLength = chunkLengths[ j % ( sizeof( chunkLengths ) / sizeof( chunkLengths[ 0 ] ) ) ];
+        chunkLength = ( chunkLength < ( TEST_STREAMING_MESSAGE_LENGTH - offset ) ) ? chunkLength :
+                      ( TEST_STREAMING_MESSAGE_LENGTH - offset );
+
+        result = IceCrypto_Md5Update( &( md5Context ),
+                                      &( message[ offset ] ),
+                                      chunkLength );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+
+        offset += chunkLength;
+        j++;
+    }
+
+    result = IceCrypto_Md5Final( &( md5Context ),
+                                 &( digest[ 0 ] ),
+                                 &( digestLength ) );
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedDigest[ 0 ] ),
+                                   &( digest[ 0 ] ),
+                                   ICE_CRYPTO_MD5_DIGEST_LENGTH );
+
+    /* The hashed data, e.g. username:realm:password, is dropped from the
+     * context. */
+    memset( &( zeroContext ),
+            0,
+            sizeof( zeroContext ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( ( const uint8_t * ) &( zeroContext ),
+                                   ( const uint8_t * ) &( md5Context ),
+                                   sizeof( zeroContext ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate HMAC-SHA1 fail functionality for Bad Parameters.
+ */
+void test_iceCrypto_HmacSha1_BadParams( void )
+{
+    IceCryptoHmacSha1Context_t hmacContext;
+    uint8_t hmac[ ICE_CRYPTO_SHA1_DIGEST_LENGTH ];
+    uint16_t hmacLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH;
+    const uint8_t * pKey = ( const uint8_t * ) "key";
+    const uint8_t * pMessage = ( const uint8_t * ) "message";
+    IceResult_t result;
+
+    result = IceCrypto_HmacSha1( NULL,
+                                 3,
+                                 pMessage,
+                                 7,
+                                 &( hmac[ 0 ] ),
+                                 &( hmacLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_HmacSha1( pKey,
+                                 3,
+                                 NULL,
+                                 7,
+                                 &( hmac[ 0 ] ),
+                                 &( hmacLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_HmacSha1( pKey,
+                                 3,
+                                 pMessage,
+                                 7,
+                                 NULL,
+                                 &( hmacLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_HmacSha1( pKey,
+                                 3,
+                                 pMessage,
+                                 7,
+                                 &( hmac[ 0 ] ),
+                                 NULL );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    hmacLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH - 1;
+
+    result = IceCrypto_HmacSha1( pKey,
+                                 3,
+                                 pMessage,
+                                 7,
+                                 &( hmac[ 0 ] ),
+                                 &( hmacLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_HmacSha1Init( NULL,
+                                     pKey,
+                                     3 );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_HmacSha1Init( &( hmacContext ),
+                                     NULL,
+                                     3 );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_HmacSha1Update( NULL,
+                                       pMessage,
+                                       7 );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+
+    result = IceCrypto_HmacSha1Final( NULL,
+                                      &( hmac[ 0 ] ),
+                                      &( hmacLength ) );
+
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that HMAC-SHA1 produces the same result regardless of how
+ * the input is split across updates, and that Final clears the key.
+ */
+void test_iceCrypto_HmacSha1_Streaming( void )
+{
+    IceCryptoHmacSha1Context_t hmacContext;
+    uint8_t message[ TEST_STREAMING_MESSAGE_LENGTH ];
+    uint8_t hmac[ ICE_CRYPTO_SHA1_DIGEST_LENGTH ];
+    uint8_t expectedHmac[ ICE_CRYPTO_SHA1_DIGEST_LENGTH ];
+    uint8_t zeroKey[ ICE_CRYPTO_SHA1_BLOCK_LENGTH ];
+    IceCryptoSha1Context_t zeroContext;
+    uint16_t hmacLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH;
+    const uint8_t * pKey = ( const uint8_t * ) "key";
+    size_t chunkLengths[] = { 1, 7, 63, 64, 65, 128, 200 };
+    size_t j, offset, chunkLength;
+    IceResult_t result;
+
+    GenerateStreamingMessage( &( message[ 0 ] ) );
+
+    result = IceCrypto_HmacSha1( pKey,
+                                 3,
+                                 &( message[ 0 ] ),
+                                 TEST_STREAMING_MESSAGE_LENGTH,
+                                 &( expectedHmac[ 0 ] ),
+                                 &( hmacLength ) );
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    result = IceCrypto_HmacSha1Init( &( hmacContext ),
+                                     pKey,
+                                     3 );
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    offset = 0;
+    j = 0;
+
+    while( offset < TEST_STREAMING_MESSAGE_LENGTH )
+    {
+        chunkLength = chunkLengths[ j % ( sizeof( chunkLengths ) / sizeof( chunkLengths[ 0 ] ) ) ];
+        chunkLength = ( chunkLength < ( TEST_STREAMING_MESSAGE_LENGTH - offset ) ) ? chunkLength :
+                      ( TEST_STREAMING_MESSAGE_LENGTH - offset );
+
+        result = IceCrypto_HmacSha1Update( &( hmacContext ),
+                                           &( message[ offset ] ),
+                                           chunkLength );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+
+        offset += chunkLength;
+        j++;
+    }
+
+    result = IceCrypto_HmacSha1Final( &( hmacContext ),
+                                      &( hmac[ 0 ] ),
+                                      &( hmacLength ) );
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedHmac[ 0 ] ),
+                                   &( hmac[ 0 ] ),
+                                   ICE_CRYPTO_SHA1_DIGEST_LENGTH );
+
+    /* The key is dropped from the context once the HMAC is computed. */
+    memset( &( zeroKey[ 0 ] ),
+            0,
+            sizeof( zeroKey ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &( zeroKey[ 0 ] ),
+                                   &( hmacContext.key[ 0 ] ),
+                                   sizeof( zeroKey ) );
+
+    /* So are the outer pad and the inner digest hashed last. */
+    memset( &( zeroContext ),
+            0,
+            sizeof( zeroContext ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( ( const uint8_t * ) &( zeroContext ),
+                                   ( const uint8_t * ) &( hmacContext.sha1Context ),
+                                   sizeof( zeroContext ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that HMAC-SHA1 over two segments matches HMAC-SHA1 over
+ * their concatenation.
+ */
+void test_iceCrypto_HmacSha1Segments( void )
+{
+    uint8_t message[ TEST_STREAMING_MESSAGE_LENGTH ];
+    uint8_t hmac[ ICE_CRYPTO_SHA1_DIGEST_LENGTH ];
+    uint8_t expectedHmac[ ICE_CRYPTO_SHA1_DIGEST_LENGTH ];
+    uint16_t hmacLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH;
+    const uint8_t * pKey = ( const uint8_t * ) "key";
+    IceResult_t result;
+
+    GenerateStreamingMessage( &( message[ 0 ] ) );
+
+    result = IceCrypto_HmacSha1( pKey,
+                                 3,
+                                 &( message[ 0 ] ),
+                                 TEST_STREAMING_MESSAGE_LENGTH,
+                                 &( expectedHmac[ 0 ] ),
+                                 &( hmacLength ) );
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+
+    result = IceCrypto_HmacSha1Segments( pKey,
+                                         3,
+                                         &( message[ 0 ] ),
+                                         20,
+                                         &( message[ 20 ] ),
+                                         TEST_STREAMING_MESSAGE_LENGTH - 20,
+                                         &( hmac[ 0 ] ),
+                                         &( hmacLength ) );
+    TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedHmac[ 0 ] ),
+                                   &( hmac[ 0 ] ),
+                                   ICE_CRYPTO_SHA1_DIGEST_LENGTH );
+
+    result = IceCrypto_HmacSha1Segments( NULL,
+                                         3,
+                                         &( message[ 0 ] ),
+                                         20,
+                                         &( message[ 20 ] ),
+                                         TEST_STREAMING_MESSAGE_LENGTH - 20,
+                                         &( hmac[ 0 ] ),
+                                         &( hmacLength ) );
+    TEST_ASSERT_EQUAL( ICE_RESULT_BAD_PARAM,
+                       result );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate HMAC-SHA1 against the RFC 2202 test vectors with every SHA-1
+ * implementation supported by the host.
+ */
+void test_iceCrypto_HmacSha1_KnownVectors( void )
+{
+    uint8_t hmac[ ICE_CRYPTO_SHA1_DIGEST_LENGTH ];
+    uint16_t hmacLength;
+    uint8_t key1[ 20 ];
+    uint8_t longKey[ 80 ];
+    const char * pMessage1 = "Hi There";
+    const char * pKey2 = "Jefe";
+    const char * pMessage2 = "what do ya want for nothing?";
+    const char * pLongKeyMessage = "Test Using Larger Than Block-Size Key - Hash Key First";
+    IceResult_t result;
+    size_t i;
+    uint8_t expectedHmac1[] =
+    {
+        0xB6, 0x17, 0x31, 0x86, 0x55, 0x05, 0x72, 0x64,
+        0xE2, 0x8B, 0xC0, 0xB6, 0xFB, 0x37, 0x8C, 0x8E,
+        0xF1, 0x46, 0xBE, 0x00,
+    };
+    uint8_t expectedHmac2[] =
+    {
+        0xEF, 0xFC, 0xDF, 0x6A, 0xE5, 0xEB, 0x2F, 0xA2,
+        0xD2, 0x74, 0x16, 0xD5, 0xF1, 0x84, 0xDF, 0x9C,
+        0x25, 0x9A, 0x7C, 0x79,
+    };
+    uint8_t expectedHmacLongKey[] =
+    {
+        0xAA, 0x4A, 0xE5, 0xE1, 0x52, 0x72, 0xD0, 0x0E,
+        0x95, 0x70, 0x56, 0x37, 0xCE, 0x8A, 0x3B, 0x55,
+        0xED, 0x40, 0x21, 0x12,
+    };
+    uint8_t expectedHmacEmpty[] =
+    {
+        0xFB, 0xDB, 0x1D, 0x1B, 0x18, 0xAA, 0x6C, 0x08,
+        0x32, 0x4B, 0x7D, 0x64, 0xB7, 0x1F, 0xB7, 0x63,
+        0x70, 0x69, 0x0E, 0x1D,
+    };
+
+    memset( &( key1[ 0 ] ),
+            0x0B,
+            sizeof( key1 ) );
+    memset( &( longKey[ 0 ] ),
+            0xAA,
+            sizeof( longKey ) );
+
+    for( i = 0; i < sizeof( sha1Implementations ) / sizeof( sha1Implementations[ 0 ] ); i++ )
+    {
+        if( IceCrypto_SetSha1Implementation( sha1Implementations[ i ] ) != ICE_RESULT_OK )
+        {
+            continue;
+        }
+
+        hmacLength = ICE_CRYPTO_SHA1_DIGEST_LENGTH;
+        result = IceCrypto_HmacSha1( &( key1[ 0 ] ),
+                                     sizeof( key1 ),
+                                     ( const uint8_t * ) pMessage1,
+                                     strlen( pMessage1 ),
+                                     &( hmac[ 0 ] ),
+                                     &( hmacLength ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        TEST_ASSERT_EQUAL( ICE_CRYPTO_SHA1_DIGEST_LENGTH,
+                           hmacLength );
+        TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedHmac1[ 0 ] ),
+                                       &( hmac[ 0 ] ),
+                                       ICE_CRYPTO_SHA1_DIGEST_LENGTH );
+
+        result = IceCrypto_HmacSha1( ( const uint8_t * ) pKey2,
+                                     strlen( pKey2 ),
+                                     ( const uint8_t * ) pMessage2,
+                                     strlen( pMessage2 ),
+                                     &( hmac[ 0 ] ),
+                                     &( hmacLength ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedHmac2[ 0 ] ),
+                                       &( hmac[ 0 ] ),
+                                       ICE_CRYPTO_SHA1_DIGEST_LENGTH );
+
+        result = IceCrypto_HmacSha1( &( longKey[ 0 ] ),
+                                     sizeof( longKey ),
+                                     ( const uint8_t * ) pLongKeyMessage,
+                                     strlen( pLongKeyMessage ),
+                                     &( hmac[ 0 ] ),
+                                     &( hmacLength ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedHmacLongKey[ 0 ] ),
+                                       &( hmac[ 0 ] ),
+                                       ICE_CRYPTO_SHA1_DIGEST_LENGTH );
+
+        result = IceCrypto_HmacSha1( NULL,
+                                     0,
+                                     NULL,
+                                     0,
+                                     &( hmac[ 0 ] ),
+                                     &( hmacLength ) );
+        TEST_ASSERT_EQUAL( ICE_RESULT_OK,
+                           result );
+        TEST_ASSERT_EQUAL_UINT8_ARRAY( &( expectedHmacEmpty[ 0 ] ),
+                                       &( hmac[ 0 ] ),
+                                       ICE_CRYPTO_SHA1_DIGEST_LENGTH );
+    }
+}
+
+/*-----------------------------------------------------------*/
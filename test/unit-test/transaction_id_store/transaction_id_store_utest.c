@@ -68,7 +68,7 @@ void test_iceTransactionIdStore_Init_BadParams( void )
 void test_iceTransactionIdStore_Insert_BadParams( void )
 {
     TransactionIdStore_t transactionIdStore;
-    uint8_t transactionID[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+    uint8_t transactionID[ STUN_HEADER_TRANSACTION_ID_LENGTH ] = { 0 };
     TransactionIdStoreResult_t result;
 
     result = TransactionIdStore_Insert( NULL,
@@ -92,7 +92,7 @@ void test_iceTransactionIdStore_Insert_BadParams( void )
 void test_iceTransactionIdStore_HasId_BadParams( void )
 {
     TransactionIdStore_t transactionIdStore;
-    uint8_t transactionID[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+    uint8_t transactionID[ STUN_HEADER_TRANSACTION_ID_LENGTH ] = { 0 };
     TransactionIdStoreResult_t result;
 
     result = TransactionIdStore_HasId( NULL,
@@ -116,7 +116,7 @@ void test_iceTransactionIdStore_HasId_BadParams( void )
 void test_iceTransactionIdStore_Remove_BadParams( void )
 {
     TransactionIdStore_t transactionIdStore;
-    uint8_t transactionID[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+    uint8_t transactionID[ STUN_HEADER_TRANSACTION_ID_LENGTH ] = { 0 };
     TransactionIdStoreResult_t result;
 
     result = TransactionIdStore_Remove( NULL,
@@ -176,3 +176,111 @@ void test_iceTransactionIdStore_Remove_TransactionIDNotFound( void )
 }
 
 /*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that the high-water mark of the store follows the most slots
+ * in use at a time.
+ */
+void test_iceTransactionIdStore_Insert_HighWaterMark( void )
+{
+    TransactionIdStore_t transactionIdStore;
+    TransactionIdSlot_t transactionIdSlots[ 4 ];
+    uint8_t transactionId1[ STUN_HEADER_TRANSACTION_ID_LENGTH ] = { 0x01 };
+    uint8_t transactionId2[ STUN_HEADER_TRANSACTION_ID_LENGTH ] = { 0x02 };
+    TransactionIdStoreResult_t result;
+
+    result = TransactionIdStore_Init( &( transactionIdStore ),
+                                      &( transactionIdSlots[ 0 ] ),
+                                      4 );
+
+    TEST_ASSERT_EQUAL( TRANSACTION_ID_STORE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL( 0,
+                       transactionIdStore.highWaterMark );
+
+    result = TransactionIdStore_Insert( &( transactionIdStore ),
+                                        &( transactionId1[ 0 ] ) );
+
+    TEST_ASSERT_EQUAL( TRANSACTION_ID_STORE_RESULT_OK,
+                       result );
+
+    result = TransactionIdStore_Insert( &( transactionIdStore ),
+                                        &( transactionId2[ 0 ] ) );
+
+    TEST_ASSERT_EQUAL( TRANSACTION_ID_STORE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL( 2,
+                       transactionIdStore.highWaterMark );
+
+    /* The freed slot is taken again. */
+    result = TransactionIdStore_Remove( &( transactionIdStore ),
+                                        &( transactionId1[ 0 ] ) );
+
+    TEST_ASSERT_EQUAL( TRANSACTION_ID_STORE_RESULT_OK,
+                       result );
+
+    result = TransactionIdStore_Insert( &( transactionIdStore ),
+                                        &( transactionId1[ 0 ] ) );
+
+    TEST_ASSERT_EQUAL( TRANSACTION_ID_STORE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL( 2,
+                       transactionIdStore.highWaterMark );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate that the slots do not need to be cleared before
+ * TransactionIdStore_Init.
+ */
+void test_iceTransactionIdStore_Init_UninitializedSlots( void )
+{
+    TransactionIdStore_t transactionIdStore;
+    TransactionIdSlot_t transactionIdSlots[ 4 ];
+    uint8_t transactionId[ STUN_HEADER_TRANSACTION_ID_LENGTH ];
+    TransactionIdStoreResult_t result;
+
+    memset( &( transactionIdSlots[ 0 ] ),
+            0x01,
+            sizeof( transactionIdSlots ) );
+    memset( &( transactionId[ 0 ] ),
+            0x01,
+            sizeof( transactionId ) );
+
+    result = TransactionIdStore_Init( &( transactionIdStore ),
+                                      &( transactionIdSlots[ 0 ] ),
+                                      4 );
+
+    TEST_ASSERT_EQUAL( TRANSACTION_ID_STORE_RESULT_OK,
+                       result );
+
+    /* The stale slots look in use and hold the same transaction ID. */
+    result = TransactionIdStore_HasId( &( transactionIdStore ),
+                                       &( transactionId[ 0 ] ) );
+
+    TEST_ASSERT_EQUAL( TRANSACTION_ID_STORE_RESULT_ID_NOT_FOUND,
+                       result );
+
+    result = TransactionIdStore_Insert( &( transactionIdStore ),
+                                        &( transactionId[ 0 ] ) );
+
+    TEST_ASSERT_EQUAL( TRANSACTION_ID_STORE_RESULT_OK,
+                       result );
+    TEST_ASSERT_EQUAL( 1,
+                       transactionIdStore.highWaterMark );
+
+    result = TransactionIdStore_Remove( &( transactionIdStore ),
+                                        &( transactionId[ 0 ] ) );
+
+    TEST_ASSERT_EQUAL( TRANSACTION_ID_STORE_RESULT_OK,
+                       result );
+
+    result = TransactionIdStore_HasId( &( transactionIdStore ),
+                                       &( transactionId[ 0 ] ) );
+
+    TEST_ASSERT_EQUAL( TRANSACTION_ID_STORE_RESULT_ID_NOT_FOUND,
+                       result );
+}
+
+/*-----------------------------------------------------------*/